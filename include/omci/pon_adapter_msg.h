@@ -37,6 +37,8 @@ extern "C" {
  * @{
  */
 
+struct pa_msg_ring;
+
 /** OMCI message operations */
 struct pa_msg_ops {
 	/** OMCI message reception callback registration
@@ -75,6 +77,31 @@ struct pa_msg_ops {
 					   const uint8_t *msg,
 					   const uint16_t len,
 					   const uint32_t *crc);
+
+	/** OMCI message reception ring (optional), alternative to
+	 *  msg_rx_cb_register
+	 *
+	 *  The lower layer writes received messages into a ring owned by it
+	 *  (see pon_adapter_msg_ring.h) instead of calling a receive callback.
+	 *  The higher layer polls the ring and processes the messages in
+	 *  place. The ring stays valid until msg_rx_cb_clear is called.
+	 *
+	 *  This member was appended after v1.18.0. A lower layer built
+	 *  against an older version of this header provides a shorter
+	 *  structure without it, the higher layer must only use it with
+	 *  lower layers built against this version or later.
+	 *
+	 *  \param[in]  ll_handle        Lower layer context pointer
+	 *  \param[in]  hl_handle        Higher layer context pointer
+	 *  \param[out] ring             Receive ring
+	 *
+	 *  \return
+	 *    - PON_ADAPTER_SUCCESS            Ring available
+	 *    - PON_ADAPTER_ERR_NOT_SUPPORTED  Use msg_rx_cb_register
+	 */
+	enum pon_adapter_errno (*msg_rx_ring_get)(void *ll_handle,
+						  void *hl_handle,
+						  struct pa_msg_ring **ring);
 };
 
 /** OMCI integrity key operations */
@@ -17,6 +17,7 @@
 #define _palib_crc_h
 
 #include "pon_adapter_base.h"
+#include "pon_adapter_errno.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -47,6 +48,138 @@ uint32_t pa_omci_crc32(uint32_t crc,
 		       const uint8_t *data,
 		       size_t data_size);
 
+/** Update the CRC-32 of several independent messages
+ *
+ *  Gives the same results as calling \ref pa_omci_crc32 for every message,
+ *  but processes groups of messages interleaved, which is faster for short
+ *  messages such as OMCI baseline messages.
+ *
+ *  \param[in]     msgs       Messages
+ *  \param[in]     lens       Message sizes
+ *  \param[in,out] crcs       Initial CRC values (0xFFFFFFFF), replaced by
+ *                            the calculated CRCs
+ *  \param[in]     n          Number of messages
+ */
+void pa_omci_crc32_batch(const uint8_t *msgs[],
+			 const size_t lens[],
+			 uint32_t crcs[],
+			 size_t n);
+
+/** Copy data and update CRC-32 over it in the same pass
+ *
+ *  Equivalent to copying the data and calling \ref pa_omci_crc32 on it,
+ *  but touches the data only once. The result can be given directly as the
+ *  crc argument of pa_msg_ops.msg_send.
+ *
+ *  \param[out] dst           Destination, must not overlap the source
+ *  \param[in]  src           Source data
+ *  \param[in]  len           Data size
+ *  \param[in]  crc           Initial CRC value (0xFFFFFFFF)
+ *
+ *  \return Returns calculated CRC
+ */
+uint32_t pa_omci_copy_crc32(uint8_t *dst,
+			    const uint8_t *src,
+			    size_t len,
+			    uint32_t crc);
+
+/** Combine the CRCs of two consecutive data blocks
+ *
+ *  Returns the same value as pa_omci_crc32(crc_a, b, len_b), without
+ *  access to the data of the second block. Takes O(log len_b) time.
+ *
+ *  \param[in]  crc_a         CRC of the first block, including its initial
+ *                            value
+ *  \param[in]  crc_b         CRC of the second block, calculated with the
+ *                            initial value 0
+ *  \param[in]  len_b         Size of the second block, 64 bit also on
+ *                            32 bit targets
+ *
+ *  \return Returns the CRC of both blocks
+ */
+uint32_t pa_omci_crc32_combine(uint32_t crc_a, uint32_t crc_b,
+			       uint64_t len_b);
+
+/** Streaming CRC-32 context */
+struct pa_omci_crc32_ctx {
+	/** Current CRC value */
+	uint32_t crc;
+	/** Number of bytes processed */
+	uint64_t len;
+};
+
+/** Start a streaming CRC-32 calculation
+ *
+ *  \param[out] ctx           Context
+ *  \param[in]  crc           Initial CRC value (0xFFFFFFFF), 0 for blocks
+ *                            to be appended by \ref pa_omci_crc32_append
+ */
+void pa_omci_crc32_init(struct pa_omci_crc32_ctx *ctx, uint32_t crc);
+
+/** Add data to a streaming CRC-32 calculation
+ *
+ *  \param[in,out] ctx        Context
+ *  \param[in]     data       Data
+ *  \param[in]     data_size  Data size
+ */
+void pa_omci_crc32_update(struct pa_omci_crc32_ctx *ctx,
+			  const uint8_t *data,
+			  size_t data_size);
+
+/** Append the data of another streaming CRC-32 calculation
+ *
+ *  Allows to calculate the CRCs of blocks independently, for example of
+ *  software image windows received out of order, and to merge them in the
+ *  order of the blocks afterwards.
+ *
+ *  \param[in,out] ctx        Context of the preceding data
+ *  \param[in]     next       Context of the following data, initialized
+ *                            with the CRC value 0
+ */
+void pa_omci_crc32_append(struct pa_omci_crc32_ctx *ctx,
+			  const struct pa_omci_crc32_ctx *next);
+
+/** Retrieve the result of a streaming CRC-32 calculation
+ *
+ *  \param[in]  ctx           Context
+ *
+ *  \return Returns the CRC of all data, as \ref pa_omci_crc32 over the
+ *          whole data would
+ */
+uint32_t pa_omci_crc32_final(const struct pa_omci_crc32_ctx *ctx);
+
+/** Calculate the CRC-32 of a file, for example of a downloaded software
+ *  image.
+ *
+ *  The file is mapped into memory and its blocks are processed in parallel
+ *  by up to thread_num threads. Where the file can't be mapped, it is read
+ *  sequentially.
+ *
+ *  The threads are created for the call and joined before it returns, there
+ *  is no pool kept between calls. Every thread gets a block of at least
+ *  PA_CRC_FILE_BLOCK_MIN bytes, whose CRC takes far longer than starting
+ *  the thread, and the function is called once per software download.
+ *
+ *  \param[in]  filepath      File path
+ *  \param[in]  crc           Initial CRC value (0xFFFFFFFF)
+ *  \param[in]  thread_num    Maximum number of threads, 0 for the number of
+ *                            online CPUs
+ *  \param[out] file_crc      Calculated CRC, as \ref pa_omci_crc32 over the
+ *                            file content would return
+ *  \param[out] file_size     File size, may be NULL
+ *
+ *  \return
+ *    - PON_ADAPTER_SUCCESS          CRC calculated
+ *    - PON_ADAPTER_ERR_PTR_INVALID  filepath or file_crc is NULL
+ *    - PON_ADAPTER_ERR_NO_MEMORY    Out of memory
+ *    - PON_ADAPTER_ERROR            File can't be read
+ */
+enum pon_adapter_errno pa_omci_crc32_file(const char *filepath,
+					  uint32_t crc,
+					  unsigned int thread_num,
+					  uint32_t *file_crc,
+					  uint64_t *file_size);
+
 /** @} */ /* PON_ADAPTER_CRC */
 /** @} */ /* PON_ADAPTER */
 
@@ -92,6 +92,8 @@ enum pon_adapter_errno {
 	PON_ADAPTER_ERR_MEM_ACCESS				= -28,
 	/** OMCI Message received with invalid TCI header */
 	PON_ADAPTER_ERR_OMCI_MSG_INVALID_TCI			= -29,
+	/** The MIC check was not successful */
+	PON_ADAPTER_ERR_MIC					= -30,
 };
 
 /** @} */ /* PON_ADAPTER */
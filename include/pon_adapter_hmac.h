@@ -0,0 +1,168 @@
+/******************************************************************************
+ *
+ *  Copyright (c) 2024 MaxLinear, Inc.
+ *
+ * For licensing information, see the file 'LICENSE' in the root folder of
+ * this software module.
+ *
+ ******************************************************************************/
+
+/**
+ * \file pon_adapter_hmac.h
+ *
+ * This is the PON adapter header file for HMAC-SHA-256 and HMAC-SHA-512.
+ */
+
+#ifndef _palib_hmac_h
+#define _palib_hmac_h
+
+#include "pon_adapter.h"
+#include "omci/me/pon_adapter_enhanced_security_control.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** \addtogroup PON_ADAPTER
+ *  @{
+ */
+
+/** \defgroup PON_ADAPTER_HMAC PON Adapter HMAC-SHA-256 and HMAC-SHA-512
+ *
+ * These functions calculate the SHA-256 and SHA-512 hashes (FIPS 180-4) and
+ * the HMACs (RFC 2104) used by the enhanced security control authentication
+ * of ITU-T G.988 for the algorithms \ref ENC_HMAC_SHA_256 and
+ * \ref ENC_HMAC_SHA_512.
+ *
+ * The hash states after the inner and outer padded key are calculated once
+ * per key, so every HMAC needs two compressions less. The SHA-256
+ * instructions of the CPU are used where available.
+ *
+ * @{
+ */
+
+/** Length of a SHA-256 hash */
+#define PA_SHA256_LEN 32
+
+/** Length of a SHA-512 hash */
+#define PA_SHA512_LEN 64
+
+/** Maximum length of a hash or HMAC */
+#define PA_HMAC_MAX_LEN PA_SHA512_LEN
+
+/** SHA-2 hash state */
+union pa_sha2_state {
+	/** SHA-256 state words */
+	uint32_t h256[8];
+	/** SHA-512 state words */
+	uint64_t h512[8];
+};
+
+/** HMAC key, caches the hash states of the padded key */
+struct pa_hmac_key {
+	/** Hash algorithm, \ref ENC_HMAC_SHA_256 or \ref ENC_HMAC_SHA_512 */
+	enum pon_adapter_enh_sec_ctrl_enc alg;
+	/** HMAC length */
+	size_t len;
+	/** Hash state after the key XOR ipad block */
+	union pa_sha2_state inner;
+	/** Hash state after the key XOR opad block */
+	union pa_sha2_state outer;
+	/** A key was set */
+	bool valid;
+};
+
+/** Get the hash or HMAC length of an algorithm
+ *
+ *  \param[in]  alg           Algorithm
+ *
+ *  \return Length in bytes, 0 if the algorithm is not an HMAC algorithm
+ */
+size_t pa_hmac_len(enum pon_adapter_enh_sec_ctrl_enc alg);
+
+/** Calculate the SHA-256 or SHA-512 hash of data
+ *
+ *  \param[in]  alg           Algorithm, \ref ENC_HMAC_SHA_256 or
+ *                            \ref ENC_HMAC_SHA_512
+ *  \param[in]  data          Data
+ *  \param[in]  len           Data size
+ *  \param[out] digest        Hash, \ref pa_hmac_len bytes
+ *
+ *  \return
+ *    - PON_ADAPTER_SUCCESS            Hash calculated
+ *    - PON_ADAPTER_ERR_PTR_INVALID    A pointer is NULL
+ *    - PON_ADAPTER_ERR_NOT_SUPPORTED  Algorithm is not supported
+ */
+enum pon_adapter_errno pa_sha2(enum pon_adapter_enh_sec_ctrl_enc alg,
+			       const uint8_t *data,
+			       size_t len,
+			       uint8_t *digest);
+
+/** Set the key of an HMAC
+ *
+ *  Keys longer than the hash block size are hashed first (RFC 2104).
+ *
+ *  \param[out] key           HMAC key
+ *  \param[in]  alg           Algorithm, \ref ENC_HMAC_SHA_256 or
+ *                            \ref ENC_HMAC_SHA_512
+ *  \param[in]  k             Key
+ *  \param[in]  k_len         Key size
+ *
+ *  \return
+ *    - PON_ADAPTER_SUCCESS            Key set
+ *    - PON_ADAPTER_ERR_PTR_INVALID    A pointer is NULL
+ *    - PON_ADAPTER_ERR_NOT_SUPPORTED  Algorithm is not supported
+ */
+enum pon_adapter_errno pa_hmac_key_set(struct pa_hmac_key *key,
+				       enum pon_adapter_enh_sec_ctrl_enc alg,
+				       const uint8_t *k,
+				       size_t k_len);
+
+/** Calculate the HMAC of data
+ *
+ *  \param[in]  key           HMAC key
+ *  \param[in]  data          Data
+ *  \param[in]  len           Data size
+ *  \param[out] mac           HMAC, key->len bytes
+ *
+ *  \return
+ *    - PON_ADAPTER_SUCCESS          HMAC calculated
+ *    - PON_ADAPTER_ERR_PTR_INVALID  A pointer is NULL
+ *    - PON_ADAPTER_ERR_NOT_AVAIL    No key set
+ */
+enum pon_adapter_errno pa_hmac(const struct pa_hmac_key *key,
+			       const uint8_t *data,
+			       size_t len,
+			       uint8_t *mac);
+
+/** Calculate the HMAC of the concatenation of several data parts
+ *
+ *  Gives the same result as \ref pa_hmac over the concatenated parts, for
+ *  example the challenges and the selected algorithm of the authentication
+ *  messages, without copying them.
+ *
+ *  \param[in]  key           HMAC key
+ *  \param[in]  parts         Data parts
+ *  \param[in]  lens          Part sizes
+ *  \param[in]  n             Number of parts
+ *  \param[out] mac           HMAC, key->len bytes
+ *
+ *  \return
+ *    - PON_ADAPTER_SUCCESS          HMAC calculated
+ *    - PON_ADAPTER_ERR_PTR_INVALID  A pointer is NULL
+ *    - PON_ADAPTER_ERR_NOT_AVAIL    No key set
+ */
+enum pon_adapter_errno pa_hmac_parts(const struct pa_hmac_key *key,
+				     const uint8_t *parts[],
+				     const size_t lens[],
+				     size_t n,
+				     uint8_t *mac);
+
+/** @} */ /* PON_ADAPTER_HMAC */
+/** @} */ /* PON_ADAPTER */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
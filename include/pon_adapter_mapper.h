@@ -37,6 +37,29 @@ extern "C" {
  /** Index mapper */
 struct mapper;
 
+/** List node arena, shared by the mappers of a set */
+struct mapper_arena;
+
+/** Mapper iteration cursor, see \ref mapper_cursor_init.
+ *  The members besides lo and hi are internal.
+ */
+struct mapper_cursor {
+	/** Lowest ID to return */
+	uint32_t lo;
+	/** Highest ID to return */
+	uint32_t hi;
+	/** Iteration state */
+	uint32_t state;
+	/** Last returned ID */
+	uint32_t last;
+	/** Mapper modification counter at the last step */
+	uint32_t gen;
+	/** Backend position of the last returned ID */
+	uint32_t pos;
+	/** Backend node of the last returned ID */
+	void *node;
+};
+
 /** Key type definition */
 enum mapper_key_type {
 	/** Key type */
@@ -47,6 +70,77 @@ enum mapper_key_type {
 	KEY_TYPE_NUM
 };
 
+/** Mapping handle, see \ref mapper_handle_map_or_get.
+ *  The members are internal.
+ */
+struct mapper_handle {
+	/** Mapped keys */
+	uint32_t key[KEY_TYPE_NUM];
+	/** Backend node of the mapping */
+	void *node;
+	/** Handle refers to a mapping */
+	bool mapped;
+};
+
+/** Mapper statistics, see \ref mapper_stats_get */
+struct mapper_stats {
+	/** Number of mappings */
+	uint32_t live;
+	/** Highest number of mappings */
+	uint32_t peak;
+	/** Failed mappings because no key was free or memory was missing */
+	uint32_t alloc_fail;
+	/** Average search steps per lookup (visited list nodes or hash
+	 *  slots), rounded
+	 */
+	uint32_t search_avg;
+	/** Maximum search steps of one lookup */
+	uint32_t search_max;
+	/** Number of created mappings */
+	uint64_t map;
+	/** Number of removed mappings, including cleanup and reset */
+	uint64_t unmap;
+	/** Number of lookups by \ref mapper_index_get, \ref mapper_id_get,
+	 *  \ref mapper_index_get_batch and \ref mapper_index_map_or_get.
+	 *  The lock-free lookups of \ref MAPPER_FLAG_CONCURRENT mappers are
+	 *  not counted, so that readers don't write shared memory.
+	 */
+	uint64_t lookup;
+	/** Sum of the search steps of all lookups */
+	uint64_t search_steps;
+};
+
+/** Index mapper entry flags */
+enum mapper_flags {
+	/** Use a hash table instead of a sorted list if a key range is too
+	 *  large for direct-indexed tables. This suits sparse key spaces,
+	 *  such as IDs using the full 32 bit range.
+	 */
+	MAPPER_FLAG_HASH = 0x0001,
+	/** Allow lookups from several threads while the mapper is modified.
+	 *  The mapper is protected like a sequence lock:
+	 *  \ref mapper_index_get and \ref mapper_id_get take no lock and
+	 *  repeat the search if a writer modified the mapper meanwhile, but
+	 *  wait while a modification is in progress. A writer preempted
+	 *  during a modification therefore delays all lookups. All other
+	 *  functions are serialized by a mapper internal lock, only the
+	 *  modifying ones make lookups retry.
+	 *  Large key ranges use a hash table, the sorted list is never
+	 *  selected. \ref mapper_free must not run concurrently to any other
+	 *  call. Only available for GCC compatible compilers with POSIX
+	 *  threads, the mapper creation fails otherwise.
+	 */
+	MAPPER_FLAG_CONCURRENT = 0x0002,
+	/** Remember the index of every mapped ID, also across
+	 *  \ref mapper_cleanup and \ref pa_mapper_reset.
+	 *  \ref mapper_id_map and \ref mapper_index_map_or_get return the
+	 *  previous index of an ID again if it is still free, instead of the
+	 *  lowest free index. The hints take memory for every ID ever
+	 *  mapped until \ref mapper_sticky_clear is called.
+	 */
+	MAPPER_FLAG_STICKY = 0x0004
+};
+
 /** Index mapper data entry */
 struct mapper_entry {
 	/** Item type */
@@ -57,6 +151,30 @@ struct mapper_entry {
 	uint32_t max_key[KEY_TYPE_NUM];
 	/** Item type name */
 	const char *name;
+	/** Mapper flags, see \ref mapper_flags */
+	uint32_t flags;
+};
+
+/** Maximum number of key types of a multi-key mapper */
+#define MAPPER_MULTI_KEY_MAX 4
+
+/** Multi-key mapper, maps up to \ref MAPPER_MULTI_KEY_MAX keys to each
+ *  other, for example ME ID, GEM port ID and hardware index
+ */
+struct mapper_multi;
+
+/** Multi-key mapper data entry */
+struct mapper_multi_entry {
+	/** Item type */
+	int32_t type;
+	/** Number of key types, 1 to \ref MAPPER_MULTI_KEY_MAX */
+	uint32_t key_num;
+	/** Key minimum value per key type */
+	uint32_t min_key[MAPPER_MULTI_KEY_MAX];
+	/** Key maximum value per key type */
+	uint32_t max_key[MAPPER_MULTI_KEY_MAX];
+	/** Item type name */
+	const char *name;
 };
 
 /** Allocate a mapper element
@@ -68,6 +186,48 @@ struct mapper_entry {
  */
 struct mapper *mapper_alloc(const struct mapper_entry *m_entry);
 
+/** Allocate a list node arena
+ *
+ * All list nodes of the mappers which are created with the arena are taken
+ * from chunks of the arena. \ref pa_mapper_reset and
+ * \ref pa_mapper_shutdown drop these nodes all at once instead of releasing
+ * them one by one.
+ *
+ * \param[in] chunk_nodes Number of nodes per chunk, 0 for the default
+ *
+ * \return
+ *    New allocated arena or NULL on error.
+ */
+struct mapper_arena *mapper_arena_alloc(uint32_t chunk_nodes);
+
+/** Release a list node arena and all of its nodes
+ *
+ * \param[in] arena     Arena
+ *
+ * \remark Call this only after \ref pa_mapper_shutdown of the mapper set
+ * which uses the arena.
+ */
+void mapper_arena_free(struct mapper_arena *arena);
+
+/** Forget the previous indexes of all IDs, see \ref MAPPER_FLAG_STICKY
+ *
+ * \param[in]  m       Pointer to mapper
+ */
+enum pon_adapter_errno mapper_sticky_clear(struct mapper *m);
+
+/** Retrieve the statistics of a mapper
+ *
+ * The counters are always maintained and cost a few increments per call.
+ * Lookups therefore write to the mapper unless it is a
+ * \ref MAPPER_FLAG_CONCURRENT mapper, lookups of other mappers must not
+ * run in parallel.
+ *
+ * \param[in]  m       Pointer to mapper
+ * \param[out] stats   Return statistics
+ */
+enum pon_adapter_errno mapper_stats_get(struct mapper *m,
+					struct mapper_stats *stats);
+
 /** Cleanup stored mappers
  *
  * \param[in]  m       Pointer to mapper
@@ -111,6 +271,8 @@ enum pon_adapter_errno mapper_index_map(struct mapper *m,
 					uint32_t idx);
 
 /** Retrieve ID for the given index
+ *
+ * Updates the lookup statistics, see \ref mapper_stats_get.
  *
  * \param[in]  m       Pointer to mapper
  * \param[out] id      Return mapped ID
@@ -121,6 +283,8 @@ enum pon_adapter_errno mapper_id_get(struct mapper *m,
 				     uint32_t idx);
 
 /** Retrieve index for the given ID
+ *
+ * Updates the lookup statistics, see \ref mapper_stats_get.
  *
  * \param[in]  m       Pointer to mapper
  * \param[in]  id      ID
@@ -182,6 +346,343 @@ enum pon_adapter_errno mapper_id_remove(struct mapper *m,
 enum pon_adapter_errno mapper_index_remove(struct mapper *m,
 					   uint32_t idx);
 
+/** Map several IDs to indexes
+ *
+ * The indexes are allocated in the same way as by consecutive calls of
+ * \ref mapper_id_map. If one ID can't be mapped, the mappings of the other
+ * IDs are removed again. Ascending IDs are mapped in a single pass over the
+ * mapper. A list mapper with an arena (see \ref pa_mapper_init_arena) takes
+ * the nodes of all IDs from one arena allocation, without an arena the
+ * nodes are allocated one by one because they are freed one by one.
+ *
+ * \param[in]  m       Pointer to mapper
+ * \param[in]  id      IDs to map
+ * \param[in]  num     Number of IDs
+ * \param[out] idx     Return mapped indexes, one per ID
+ */
+enum pon_adapter_errno mapper_id_map_batch(struct mapper *m,
+					   const uint32_t *id,
+					   uint32_t num,
+					   uint32_t *idx);
+
+/** Retrieve the indexes of several IDs
+ *
+ * Ascending IDs are searched in a single pass over the mapper.
+ *
+ * \param[in]  m       Pointer to mapper
+ * \param[in]  id      IDs
+ * \param[in]  num     Number of IDs
+ * \param[out] idx     Return mapped indexes, one per ID. Only valid if
+ *                     all IDs are mapped.
+ */
+enum pon_adapter_errno mapper_index_get_batch(struct mapper *m,
+					      const uint32_t *id,
+					      uint32_t num,
+					      uint32_t *idx);
+
+/** Remove several IDs from the mapping
+ *
+ * All mapped IDs are removed, PON_ADAPTER_ERR_NOT_FOUND is returned if any
+ * of them was not mapped. Ascending IDs are removed in a single pass over
+ * the mapper.
+ *
+ * \param[in] m       Pointer to mapper
+ * \param[in] id      IDs to remove
+ * \param[in] num     Number of IDs
+ */
+enum pon_adapter_errno mapper_id_remove_batch(struct mapper *m,
+					      const uint32_t *id,
+					      uint32_t num);
+
+/** Map consecutive IDs to a block of consecutive indexes
+ *
+ * The IDs id to id + num - 1 are mapped to the indexes first_idx to
+ * first_idx + num - 1. The block is the lowest free one whose first index is
+ * a multiple of align. Either all IDs are mapped or none. Requires an index
+ * range with a bitmap (see PA_MAPPER_BITMAP_RANGE_MAX).
+ *
+ * \param[in]  m          Pointer to mapper
+ * \param[in]  id         First ID
+ * \param[in]  num        Number of IDs and indexes
+ * \param[in]  align      Alignment of the first index, 0 or 1 for none
+ * \param[out] first_idx  Return first index of the block
+ */
+enum pon_adapter_errno mapper_id_map_range(struct mapper *m,
+					   uint32_t id,
+					   uint32_t num,
+					   uint32_t align,
+					   uint32_t *first_idx);
+
+/** Remove consecutive IDs from the mapping
+ *
+ * Releases a block which was mapped by \ref mapper_id_map_range. Nothing is
+ * removed and PON_ADAPTER_ERR_NOT_FOUND is returned if any of the IDs is
+ * not mapped.
+ *
+ * \param[in] m       Pointer to mapper
+ * \param[in] id      First ID
+ * \param[in] num     Number of IDs
+ */
+enum pon_adapter_errno mapper_id_remove_range(struct mapper *m,
+					      uint32_t id,
+					      uint32_t num);
+
+/** Prepare a cursor to iterate over the mappings with IDs in [lo, hi]
+ *
+ * \param[out] c       Cursor
+ * \param[in]  lo      Lowest ID
+ * \param[in]  hi      Highest ID
+ */
+void mapper_cursor_init(struct mapper_cursor *c, uint32_t lo, uint32_t hi);
+
+/** Retrieve the next mapping of a cursor in ascending ID order
+ *
+ * No memory is allocated per step. The mapper may be modified between two
+ * steps, the iteration continues with the lowest ID above the last returned
+ * one. Unchanged list and direct-indexed mappers are iterated in linear time.
+ *
+ * \param[in]     m       Pointer to mapper
+ * \param[in,out] c       Cursor, see \ref mapper_cursor_init
+ * \param[out]    id      Return mapped ID, may be NULL
+ * \param[out]    idx     Return mapped index, may be NULL
+ *
+ * \return
+ *    - PON_ADAPTER_SUCCESS       Mapping was returned
+ *    - PON_ADAPTER_ERR_NOT_FOUND No more mappings in the range
+ */
+enum pon_adapter_errno mapper_cursor_next(struct mapper *m,
+					  struct mapper_cursor *c,
+					  uint32_t *id,
+					  uint32_t *idx);
+
+/** Retrieve the mapping of an ID as handle, map the ID if not mapped yet
+ *
+ * The handle stays valid until the mapping is removed by
+ * \ref mapper_handle_remove. It must not be used anymore after the ID was
+ * removed by any other function, or the mapper was cleaned up or reset.
+ *
+ * \param[in]  m       Pointer to mapper
+ * \param[in]  id      ID
+ * \param[out] h       Return mapping handle
+ */
+enum pon_adapter_errno mapper_handle_map_or_get(struct mapper *m,
+						uint32_t id,
+						struct mapper_handle *h);
+
+/** Retrieve the ID of a mapping handle, without a search
+ *
+ * \param[in]  h       Mapping handle
+ * \param[out] id      Return mapped ID
+ */
+enum pon_adapter_errno mapper_handle_id_get(const struct mapper_handle *h,
+					    uint32_t *id);
+
+/** Retrieve the index of a mapping handle, without a search
+ *
+ * \param[in]  h       Mapping handle
+ * \param[out] idx     Return mapped index
+ */
+enum pon_adapter_errno mapper_handle_index_get(const struct mapper_handle *h,
+					       uint32_t *idx);
+
+/** Remove the mapping of a handle
+ *
+ * List nodes are unlinked without a search, the other backends remove the
+ * mapping by its key in constant time.
+ *
+ * \param[in]     m       Pointer to mapper
+ * \param[in,out] h       Mapping handle, no longer refers to a mapping
+ */
+enum pon_adapter_errno mapper_handle_remove(struct mapper *m,
+					    struct mapper_handle *h);
+
+/** Allocate a multi-key mapper
+ *
+ * \param[in] m_entry	Multi-key mapper entry, must stay valid until the
+ *			mapper is released
+ *
+ * \return
+ *    New allocated mapper or NULL on error.
+ */
+struct mapper_multi *
+mapper_multi_alloc(const struct mapper_multi_entry *m_entry);
+
+/** Release a multi-key mapper and all of its mappings
+ *
+ * \param[in] m       Pointer to multi-key mapper
+ */
+enum pon_adapter_errno mapper_multi_free(struct mapper_multi *m);
+
+/** Remove all mappings of a multi-key mapper
+ *
+ * \param[in] m       Pointer to multi-key mapper
+ */
+enum pon_adapter_errno mapper_multi_cleanup(struct mapper_multi *m);
+
+/** Add a mapping of all keys of a multi-key mapper
+ *
+ * The mapping is added for all keys or, on error, for none of them.
+ * Keys to allocate get the lowest free key of their range, this is
+ * supported for key ranges with a bitmap (see PA_MAPPER_BITMAP_RANGE_MAX).
+ *
+ * \param[in]     m       Pointer to multi-key mapper
+ * \param[in,out] keys    One key per key type, allocated keys are returned
+ * \param[in]     alloc   Bit mask of the key types to allocate
+ *
+ * \return
+ *    - PON_ADAPTER_SUCCESS       Mapping was added
+ *    - PON_ADAPTER_ERR_NO_MEMORY Not enough memory
+ *    - PON_ADAPTER_ERROR         A key is out of range or already mapped,
+ *                                or no key is free
+ */
+enum pon_adapter_errno mapper_multi_map(struct mapper_multi *m,
+					uint32_t *keys,
+					uint32_t alloc);
+
+/** Find a mapping of a multi-key mapper by any of its keys
+ *
+ * \param[in]  m        Pointer to multi-key mapper
+ * \param[in]  key_type Key type of the given key
+ * \param[in]  key      Key
+ * \param[out] keys     Return all keys of the mapping, one per key type
+ */
+enum pon_adapter_errno mapper_multi_get(const struct mapper_multi *m,
+					uint32_t key_type,
+					uint32_t key,
+					uint32_t *keys);
+
+/** Remove a mapping of a multi-key mapper for all of its keys
+ *
+ * \param[in] m        Pointer to multi-key mapper
+ * \param[in] key_type Key type of the given key
+ * \param[in] key      Key
+ */
+enum pon_adapter_errno mapper_multi_remove(struct mapper_multi *m,
+					   uint32_t key_type,
+					   uint32_t key);
+
+/** Number of 64 bit words of static storage taken by the hash table state
+ *  of a mapper, the table pointer, two counters and 32 replaced tables
+ */
+#define PA_MAPPER_STATIC_HASH_WORDS (3 + 32)
+
+/** Number of 64 bit words of static storage taken by a used key bitmap,
+ *  the geometry and one pointer for each of the 6 levels
+ */
+#define PA_MAPPER_STATIC_BITMAP_WORDS (1 + 3 + 6)
+
+/** Number of 64 bit words of static storage reserved for the writer lock,
+ *  enough for the pthread_mutex_t of the supported targets
+ */
+#define PA_MAPPER_STATIC_LOCK_WORDS 8
+
+/** Number of 64 bit words of static storage taken by a mapper itself
+ *
+ * One word per pointer, counter or pair of 32 bit fields of the mapper:
+ * three hash table states (ID, index and sticky hints), two used key
+ * bitmaps, the writer lock and 20 words for the remaining fields. The
+ * mapper implementation checks at compile time that it fits.
+ */
+#define PA_MAPPER_STATIC_HDR_WORDS \
+	(3 * PA_MAPPER_STATIC_HASH_WORDS + \
+	 2 * PA_MAPPER_STATIC_BITMAP_WORDS + \
+	 PA_MAPPER_STATIC_LOCK_WORDS + 20)
+
+/** Largest key range (maximum minus minimum plus one) of a static mapper,
+ *  only mappers using the direct backend can be placed in static storage
+ */
+#define PA_MAPPER_STATIC_RANGE_MAX 4096
+
+/** Number of 64 bit words of static storage taken by one key type,
+ *  the direct table and the used key bitmap
+ */
+#define PA_MAPPER_STATIC_KEY_WORDS(min, max) \
+	(((max) - (min)) / 2 + 1 + ((max) - (min)) / 64 + 2)
+
+/** Number of 64 bit words of static storage taken by a mapper */
+#define PA_MAPPER_STATIC_WORDS(id_min, id_max, idx_min, idx_max) \
+	(PA_MAPPER_STATIC_HDR_WORDS + \
+	 PA_MAPPER_STATIC_KEY_WORDS(id_min, id_max) + \
+	 PA_MAPPER_STATIC_KEY_WORDS(idx_min, idx_max))
+
+/** \ref PA_MAPPER_STATIC_SET list element: mapper entry */
+#define PA_MAPPER_STATIC_ENTRY(type, name, id_min, id_max, idx_min, idx_max, \
+			       flags) \
+	{ type, { id_min, idx_min }, { id_max, idx_max }, name, flags },
+
+/** \ref PA_MAPPER_STATIC_SET list element: storage words */
+#define PA_MAPPER_STATIC_ENTRY_WORDS(type, name, id_min, id_max, idx_min, \
+				     idx_max, flags) \
+	+ PA_MAPPER_STATIC_WORDS(id_min, id_max, idx_min, idx_max)
+
+/** \ref PA_MAPPER_STATIC_SET list element: true for invalid key ranges */
+#define PA_MAPPER_STATIC_ENTRY_BAD(type, name, id_min, id_max, idx_min, \
+				   idx_max, flags) \
+	|| (id_min) > (id_max) || (idx_min) > (idx_max) || \
+	(id_max) - (id_min) >= PA_MAPPER_STATIC_RANGE_MAX || \
+	(idx_max) - (idx_min) >= PA_MAPPER_STATIC_RANGE_MAX
+
+/** Define a mapper set with static storage
+ *
+ * The set is described by a list macro, which calls its argument once per
+ * mapper as X(type, name, id_min, id_max, idx_min, idx_max, flags), with
+ * the types numbered from 0:
+ *
+ * \code
+ * #define GEM_MAPPERS(X) \
+ *	X(MAPPER_GEM_PORT, "gem", 0, 4095, 0, 255, 0) \
+ *	X(MAPPER_QUEUE, "queue", 0x8000, 0x80ff, 0, 127, 0)
+ *
+ * PA_MAPPER_STATIC_SET(gem_mappers, GEM_MAPPERS);
+ * \endcode
+ *
+ * This defines the mapper entry array set_entry[], the storage set_storage[]
+ * and the mapper pointer array set[]. Key ranges which exceed
+ * \ref PA_MAPPER_STATIC_RANGE_MAX fail to compile.
+ *
+ * Only the memory is reserved at compile time. The mappers are set up in
+ * the storage by \ref PA_MAPPER_STATIC_SET_INIT at startup, before set[]
+ * is used.
+ */
+#define PA_MAPPER_STATIC_SET(set, LIST) \
+	typedef char set##_range_check[ \
+		(0 LIST(PA_MAPPER_STATIC_ENTRY_BAD)) ? -1 : 1]; \
+	static const struct mapper_entry set##_entry[] = { \
+		LIST(PA_MAPPER_STATIC_ENTRY) \
+	}; \
+	static uint64_t set##_storage[0 LIST(PA_MAPPER_STATIC_ENTRY_WORDS)]; \
+	static struct mapper *set[sizeof(set##_entry) / sizeof(set##_entry[0])]
+
+/** Initialize a mapper set defined by \ref PA_MAPPER_STATIC_SET
+ *
+ * Clears the storage and sets up the mappers, their tables and bitmaps
+ * in it at run time, see \ref pa_mapper_init_static.
+ */
+#define PA_MAPPER_STATIC_SET_INIT(set) \
+	pa_mapper_init_static(set, \
+			      sizeof(set##_entry) / sizeof(set##_entry[0]), \
+			      set##_entry, set##_storage, sizeof(set##_storage))
+
+/** Initialize mapper generic function, using caller provided storage
+ *
+ * All mappers are placed in the storage instead of the heap, which
+ * requires key ranges up to \ref PA_MAPPER_STATIC_RANGE_MAX and no
+ * \ref MAPPER_FLAG_STICKY. \ref pa_mapper_shutdown leaves the storage to
+ * the caller. See \ref PA_MAPPER_STATIC_SET for sets in static storage.
+ *
+ * \param[in] m		Mapper pointer
+ * \param[in] size	Size of m_entry array
+ * \param[in] m_entry	m_entry array pointer
+ * \param[in] storage	Storage of at least \ref PA_MAPPER_STATIC_WORDS
+ *			words per mapper
+ * \param[in] storage_size Size of the storage in bytes
+ */
+enum pon_adapter_errno pa_mapper_init_static(struct mapper **m,
+					     size_t size,
+					     const struct mapper_entry *m_entry,
+					     uint64_t *storage,
+					     size_t storage_size);
+
 /** Initialize mapper generic function
  *
  * \param[in] m		Mapper pointer
@@ -192,6 +693,21 @@ enum pon_adapter_errno pa_mapper_init(struct mapper **m,
 				      size_t size,
 				      const struct mapper_entry *m_entry);
 
+/** Initialize mapper generic function, using a list node arena
+ *
+ * \param[in] m		Mapper pointer
+ * \param[in] size	Size of m_entry array
+ * \param[in] m_entry	m_entry array pointer
+ * \param[in] arena	List node arena (see \ref mapper_arena_alloc), NULL
+ *			to allocate list nodes from the heap
+ *
+ * \remark An arena must only be used by a single mapper set.
+ */
+enum pon_adapter_errno pa_mapper_init_arena(struct mapper **m,
+					    size_t size,
+					    const struct mapper_entry *m_entry,
+					    struct mapper_arena *arena);
+
 /** Shutdown mapper generic function
  *
  * \param[in] m		Mapper pointer
@@ -208,6 +724,58 @@ enum pon_adapter_errno pa_mapper_shutdown(struct mapper **m,
 enum pon_adapter_errno pa_mapper_reset(struct mapper **m,
 				       size_t size);
 
+/** Save the mappings of a mapper set into a snapshot file
+ *
+ * The file is versioned, protected by a CRC and replaced only after it was
+ * written completely. Its layout uses 32 bit words in host byte order.
+ * Except on Windows, the new file and its directory entry are synced to the
+ * storage, so that a power loss leaves either the old or the new snapshot.
+ *
+ * \param[in] m		Mapper pointer
+ * \param[in] size	Size of m_entry array
+ * \param[in] m_entry	m_entry array pointer
+ * \param[in] path	Snapshot file name
+ */
+enum pon_adapter_errno pa_mapper_snapshot_save(struct mapper **m,
+					       size_t size,
+					       const struct mapper_entry *m_entry,
+					       const char *path);
+
+/** Restore the mappings of a mapper set from a snapshot file
+ *
+ * The snapshot must have been saved for the same m_entry array, every
+ * mapping is checked against the key ranges. On success the current
+ * mappings of the set are replaced, on error they are either unchanged
+ * (invalid file) or removed (mappings can't be restored).
+ *
+ * \param[in] m		Mapper pointer
+ * \param[in] size	Size of m_entry array
+ * \param[in] m_entry	m_entry array pointer
+ * \param[in] path	Snapshot file name
+ *
+ * \return
+ *    - PON_ADAPTER_SUCCESS             Mappings were restored
+ *    - PON_ADAPTER_ERR_NOT_FOUND       No snapshot file
+ *    - PON_ADAPTER_ERR_INVALID_VAL     Invalid or corrupted file
+ *    - PON_ADAPTER_ERR_CONFIG_MISMATCH Snapshot doesn't match the set
+ */
+enum pon_adapter_errno pa_mapper_snapshot_load(struct mapper **m,
+					       size_t size,
+					       const struct mapper_entry *m_entry,
+					       const char *path);
+
+/** Retrieve the statistics of a mapper set
+ *
+ * \param[in]  m		Mapper pointer
+ * \param[in]  size	Size of m_entry array
+ * \param[in]  m_entry	m_entry array pointer
+ * \param[out] stats	Return statistics, one per m_entry element
+ */
+enum pon_adapter_errno pa_mapper_stats_get(struct mapper **m,
+					   size_t size,
+					   const struct mapper_entry *m_entry,
+					   struct mapper_stats *stats);
+
 /** Dump mapper generic function
  *
  * \param[in] m		Mapper pointer
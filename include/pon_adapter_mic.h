@@ -0,0 +1,183 @@
+/******************************************************************************
+ *
+ *  Copyright (c) 2024 MaxLinear, Inc.
+ *
+ * For licensing information, see the file 'LICENSE' in the root folder of
+ * this software module.
+ *
+ ******************************************************************************/
+
+/**
+ * \file pon_adapter_mic.h
+ *
+ * This is the PON adapter header file for the OMCI message integrity check.
+ */
+
+#ifndef _palib_mic_h
+#define _palib_mic_h
+
+#include "pon_adapter.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** \addtogroup PON_ADAPTER
+ *  @{
+ */
+
+/** \defgroup PON_ADAPTER_MIC PON Adapter OMCI message integrity check
+ *
+ * These functions calculate and check the message integrity check (MIC) of
+ * OMCI messages as defined in ITU-T G.987.3 and G.9807.1, an AES-CMAC over
+ * the direction code and the OMCI message, keyed by the OMCI-IK.
+ *
+ * The AES instructions of the CPU are used where available.
+ *
+ * @{
+ */
+
+/** Length of the OMCI MIC */
+#define PA_OMCI_MIC_LEN 4
+
+/** Length of an AES-CMAC */
+#define PA_OMCI_CMAC_LEN 16
+
+/** Part of a baseline OMCI message covered by the MIC */
+#define PA_OMCI_MIC_BASELINE_LEN 44
+
+/** Direction code of the OMCI MIC calculation */
+enum pa_omci_mic_dir {
+	/** Message sent by the OLT */
+	PA_OMCI_MIC_DOWNSTREAM = 0x01,
+	/** Message sent by the ONU */
+	PA_OMCI_MIC_UPSTREAM = 0x02
+};
+
+/** OMCI MIC context, caches the expanded OMCI-IK */
+struct pa_omci_mic_ctx {
+	/** OMCI-IK of the expanded key */
+	struct pa_omci_ik ik;
+	/** AES-128 round keys */
+	uint8_t round_key[11][16];
+	/** CMAC subkey K1 */
+	uint8_t k1[16];
+	/** CMAC subkey K2 */
+	uint8_t k2[16];
+	/** A key was set */
+	bool valid;
+};
+
+/** Set the OMCI-IK of a MIC context
+ *
+ *  The AES key schedule and the CMAC subkeys are calculated only if the key
+ *  differs from the one set before, so this can be called for every
+ *  omci_ik_update event or every pa_integrity_ops.key_get result.
+ *
+ *  \param[in,out] ctx        MIC context, zero initialized before first use
+ *  \param[in]     ik         OMCI-IK
+ *
+ *  \return
+ *    - PON_ADAPTER_SUCCESS          Key set
+ *    - PON_ADAPTER_EUNCHANGED       Key is already set
+ *    - PON_ADAPTER_ERR_PTR_INVALID  ctx or ik is NULL
+ */
+enum pon_adapter_errno pa_omci_mic_key_set(struct pa_omci_mic_ctx *ctx,
+					   const struct pa_omci_ik *ik);
+
+/** Calculate the AES-CMAC of data as defined in RFC 4493
+ *
+ *  \param[in]  ctx           MIC context
+ *  \param[in]  data          Data
+ *  \param[in]  len           Data size
+ *  \param[out] mac           AES-CMAC
+ *
+ *  \return
+ *    - PON_ADAPTER_SUCCESS          AES-CMAC calculated
+ *    - PON_ADAPTER_ERR_PTR_INVALID  A pointer is NULL
+ *    - PON_ADAPTER_ERR_NOT_AVAIL    No key set
+ */
+enum pon_adapter_errno pa_omci_cmac(const struct pa_omci_mic_ctx *ctx,
+				    const uint8_t *data,
+				    size_t len,
+				    uint8_t mac[PA_OMCI_CMAC_LEN]);
+
+/** Calculate the MIC of an OMCI message
+ *
+ *  \param[in]  ctx           MIC context
+ *  \param[in]  dir           Direction of the message
+ *  \param[in]  msg           OMCI message
+ *  \param[in]  len           Message size without the MIC,
+ *                            \ref PA_OMCI_MIC_BASELINE_LEN for baseline
+ *                            messages
+ *  \param[out] mic           MIC, the most significant byte is transmitted
+ *                            first
+ *
+ *  \return
+ *    - PON_ADAPTER_SUCCESS          MIC calculated
+ *    - PON_ADAPTER_ERR_PTR_INVALID  A pointer is NULL
+ *    - PON_ADAPTER_ERR_NOT_AVAIL    No key set
+ *    - PON_ADAPTER_ERR_INVALID_VAL  Invalid direction
+ */
+enum pon_adapter_errno pa_omci_mic(const struct pa_omci_mic_ctx *ctx,
+				   enum pa_omci_mic_dir dir,
+				   const uint8_t *msg,
+				   size_t len,
+				   uint32_t *mic);
+
+/** Check the MIC of a received OMCI message
+ *
+ *  \param[in]  ctx           MIC context
+ *  \param[in]  dir           Direction of the message
+ *  \param[in]  msg           OMCI message
+ *  \param[in]  len           Message size without the MIC
+ *  \param[in]  mic           Received MIC, the most significant byte is
+ *                            transmitted first
+ *
+ *  \return
+ *    - PON_ADAPTER_SUCCESS          MIC is correct
+ *    - PON_ADAPTER_ERR_MIC          MIC is wrong
+ *    - PON_ADAPTER_ERR_PTR_INVALID  A pointer is NULL
+ *    - PON_ADAPTER_ERR_NOT_AVAIL    No key set
+ *    - PON_ADAPTER_ERR_INVALID_VAL  Invalid direction
+ */
+enum pon_adapter_errno pa_omci_mic_check(const struct pa_omci_mic_ctx *ctx,
+					 enum pa_omci_mic_dir dir,
+					 const uint8_t *msg,
+					 size_t len,
+					 uint32_t mic);
+
+/** Calculate the MICs of several OMCI messages of the same direction
+ *
+ *  Gives the same results as calling \ref pa_omci_mic for every message,
+ *  but encrypts the blocks of several messages interleaved where the AES
+ *  instructions are used, for example for the MIB upload.
+ *
+ *  \param[in]  ctx           MIC context
+ *  \param[in]  dir           Direction of the messages
+ *  \param[in]  msgs          OMCI messages
+ *  \param[in]  lens          Message sizes without the MIC
+ *  \param[out] mics          MICs
+ *  \param[in]  n             Number of messages
+ *
+ *  \return
+ *    - PON_ADAPTER_SUCCESS          MICs calculated
+ *    - PON_ADAPTER_ERR_PTR_INVALID  A pointer is NULL
+ *    - PON_ADAPTER_ERR_NOT_AVAIL    No key set
+ *    - PON_ADAPTER_ERR_INVALID_VAL  Invalid direction
+ */
+enum pon_adapter_errno pa_omci_mic_batch(const struct pa_omci_mic_ctx *ctx,
+					 enum pa_omci_mic_dir dir,
+					 const uint8_t *msgs[],
+					 const size_t lens[],
+					 uint32_t mics[],
+					 size_t n);
+
+/** @} */ /* PON_ADAPTER_MIC */
+/** @} */ /* PON_ADAPTER */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
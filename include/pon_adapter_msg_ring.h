@@ -0,0 +1,209 @@
+/******************************************************************************
+ *
+ *  Copyright (c) 2024 MaxLinear, Inc.
+ *
+ * For licensing information, see the file 'LICENSE' in the root folder of
+ * this software module.
+ *
+ ******************************************************************************/
+
+/**
+ * \file pon_adapter_msg_ring.h
+ *
+ * This is the PON adapter header file for the OMCI message receive ring.
+ */
+
+#ifndef _palib_msg_ring_h
+#define _palib_msg_ring_h
+
+#include "pon_adapter.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** \addtogroup PON_ADAPTER
+ *  @{
+ */
+
+/** \defgroup PON_ADAPTER_MSG_RING PON Adapter OMCI message receive ring
+ *
+ * Single producer, single consumer ring of fixed-size OMCI message slots.
+ * The lower layer owns the ring and writes received messages into it,
+ * the higher layer polls the ring and processes the messages in place,
+ * see pa_msg_ops.msg_rx_ring_get.
+ *
+ * The ring contains no pointers, so it can be placed in memory shared
+ * between processes. One thread may produce and one thread may consume
+ * at a time, without locking.
+ *
+ * Producer:
+ * - \ref pa_msg_ring_slot_get returns the next free slot, the message is
+ *   written into it
+ * - \ref pa_msg_ring_slot_push makes the slot visible to the consumer
+ * - or \ref pa_msg_ring_put copies a message into the ring
+ *
+ * Consumer:
+ * - \ref pa_msg_ring_poll returns the received slots in order
+ * - \ref pa_msg_ring_release returns processed slots to the producer
+ *
+ * @{
+ */
+
+/** Size of a ring slot */
+#define PA_MSG_RING_SLOT_SIZE 2048
+
+/** Maximum OMCI message size of a ring slot, enough for an extended OMCI
+ *  message
+ */
+#define PA_MSG_RING_MSG_MAX (PA_MSG_RING_SLOT_SIZE - 8)
+
+/** Slot flag, the CRC field is valid */
+#define PA_MSG_RING_SLOT_CRC 0x0001
+
+/** OMCI message ring slot */
+struct pa_msg_ring_slot {
+	/** Message size */
+	uint16_t len;
+	/** Slot flags, PA_MSG_RING_SLOT_* */
+	uint16_t flags;
+	/** CRC of the message as given by the lower layer, valid if
+	 *  PA_MSG_RING_SLOT_CRC is set
+	 */
+	uint32_t crc;
+	/** OMCI message */
+	uint8_t msg[PA_MSG_RING_MSG_MAX];
+};
+
+/** OMCI message ring */
+struct pa_msg_ring;
+
+/** Get the memory size of a ring
+ *
+ *  \param[in]  slot_num      Number of slots, a power of two
+ *
+ *  \return Ring size in bytes, 0 if slot_num is invalid
+ */
+size_t pa_msg_ring_size(uint32_t slot_num);
+
+/** Initialize a ring in caller provided memory, for example shared memory
+ *
+ *  \param[in]  mem           Memory for the ring, 64 byte aligned
+ *  \param[in]  size          Memory size, at least \ref pa_msg_ring_size
+ *  \param[in]  slot_num      Number of slots, a power of two
+ *  \param[out] ring          Ring
+ *
+ *  \return
+ *    - PON_ADAPTER_SUCCESS          Ring initialized
+ *    - PON_ADAPTER_ERR_PTR_INVALID  A pointer is NULL or mem is not aligned
+ *    - PON_ADAPTER_ERR_INVALID_VAL  slot_num is invalid
+ *    - PON_ADAPTER_ERR_SIZE         size is too small
+ */
+enum pon_adapter_errno pa_msg_ring_init(void *mem, size_t size,
+					uint32_t slot_num,
+					struct pa_msg_ring **ring);
+
+/** Attach to a ring initialized by \ref pa_msg_ring_init, for example in
+ *  shared memory mapped by another process
+ *
+ *  \param[in]  mem           Memory of the ring
+ *  \param[in]  size          Memory size
+ *  \param[out] ring          Ring
+ *
+ *  \return
+ *    - PON_ADAPTER_SUCCESS          Ring attached
+ *    - PON_ADAPTER_ERR_PTR_INVALID  A pointer is NULL or mem is not aligned
+ *    - PON_ADAPTER_ERR_NOT_FOUND    mem contains no ring
+ *    - PON_ADAPTER_ERR_SIZE         size is too small for the ring
+ */
+enum pon_adapter_errno pa_msg_ring_attach(void *mem, size_t size,
+					  struct pa_msg_ring **ring);
+
+/** Allocate and initialize a ring
+ *
+ *  \param[in]  slot_num      Number of slots, a power of two
+ *  \param[out] ring          Ring, freed by \ref pa_msg_ring_destroy
+ *
+ *  \return
+ *    - PON_ADAPTER_SUCCESS          Ring created
+ *    - PON_ADAPTER_ERR_PTR_INVALID  ring is NULL
+ *    - PON_ADAPTER_ERR_INVALID_VAL  slot_num is invalid
+ *    - PON_ADAPTER_ERR_NO_MEMORY    Out of memory
+ */
+enum pon_adapter_errno pa_msg_ring_create(uint32_t slot_num,
+					  struct pa_msg_ring **ring);
+
+/** Free a ring allocated by \ref pa_msg_ring_create
+ *
+ *  \param[in]  ring          Ring
+ */
+void pa_msg_ring_destroy(struct pa_msg_ring *ring);
+
+/** Get the next free slot, producer side
+ *
+ *  The same slot is returned until it is pushed.
+ *
+ *  \param[in]  ring          Ring
+ *
+ *  \return Free slot, NULL if the ring is full
+ */
+struct pa_msg_ring_slot *pa_msg_ring_slot_get(struct pa_msg_ring *ring);
+
+/** Pass the slot returned by \ref pa_msg_ring_slot_get to the consumer,
+ *  producer side
+ *
+ *  \param[in]  ring          Ring
+ */
+void pa_msg_ring_slot_push(struct pa_msg_ring *ring);
+
+/** Copy a message into the next free slot and pass it to the consumer,
+ *  producer side
+ *
+ *  \param[in]  ring          Ring
+ *  \param[in]  msg           OMCI message
+ *  \param[in]  len           Message size
+ *  \param[in]  crc           (optional) CRC of the message
+ *
+ *  \return
+ *    - PON_ADAPTER_SUCCESS                Message added
+ *    - PON_ADAPTER_ERR_PTR_INVALID        A pointer is NULL
+ *    - PON_ADAPTER_ERR_SIZE               Message is too long
+ *    - PON_ADAPTER_ERR_OMCI_MSG_FIFO_FULL Ring is full
+ */
+enum pon_adapter_errno pa_msg_ring_put(struct pa_msg_ring *ring,
+				       const uint8_t *msg,
+				       uint16_t len,
+				       const uint32_t *crc);
+
+/** Get the received slots, consumer side
+ *
+ *  The slots stay valid until they are released by
+ *  \ref pa_msg_ring_release. Slots returned before and not released yet
+ *  are returned again.
+ *
+ *  \param[in]  ring          Ring
+ *  \param[out] slots         Received slots, oldest first
+ *  \param[in]  max           Size of slots
+ *
+ *  \return Number of received slots
+ */
+uint32_t pa_msg_ring_poll(struct pa_msg_ring *ring,
+			  const struct pa_msg_ring_slot *slots[],
+			  uint32_t max);
+
+/** Return processed slots to the producer, consumer side
+ *
+ *  \param[in]  ring          Ring
+ *  \param[in]  num           Number of the oldest slots to release, at most
+ *                            the number returned by \ref pa_msg_ring_poll
+ */
+void pa_msg_ring_release(struct pa_msg_ring *ring, uint32_t num);
+
+/** @} */ /* PON_ADAPTER_MSG_RING */
+/** @} */ /* PON_ADAPTER */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,58 @@
+/******************************************************************************
+ *
+ *  Copyright (c) 2024 MaxLinear, Inc.
+ *
+ * For licensing information, see the file 'LICENSE' in the root folder of
+ * this software module.
+ *
+ ******************************************************************************/
+
+/**
+ * \file bench_common.h
+ *
+ * Random numbers, time measurement and result output shared by the
+ * benchmark programs.
+ */
+
+#ifndef _bench_common_h
+#define _bench_common_h
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+
+/** State of bench_rand(), seeded by main() */
+static uint64_t rand_state;
+
+/** xorshift64*, reproducible across C libraries */
+static inline uint32_t bench_rand(void)
+{
+	rand_state ^= rand_state >> 12;
+	rand_state ^= rand_state << 25;
+	rand_state ^= rand_state >> 27;
+
+	return (uint32_t)((rand_state * 0x2545f4914f6cdd1dULL) >> 32);
+}
+
+/** Monotonic time in ns */
+static inline uint64_t time_ns(void)
+{
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+
+	return (uint64_t)t.tv_sec * 1000000000ULL + (uint64_t)t.tv_nsec;
+}
+
+/** Print a check result, returns the number of failures */
+static inline unsigned int check_print(const char *name, unsigned long cases,
+				       unsigned int failed)
+{
+	printf("%-20s %8lu cases %s\n", name, cases, failed ? "FAILED" : "OK");
+
+	return failed;
+}
+
+#endif
@@ -0,0 +1,700 @@
+/******************************************************************************
+ *
+ *  Copyright (c) 2024 MaxLinear, Inc.
+ *
+ * For licensing information, see the file 'LICENSE' in the root folder of
+ * this software module.
+ *
+ ******************************************************************************/
+
+/**
+ * \file crc_bench.c
+ *
+ * OMCI CRC, MIC and HMAC conformance test and benchmark.
+ *
+ * Checks all CRC functions of the library against a byte-wise reference
+ * built from the polynomial on random data, then reports their throughput
+ * for OMCI baseline and extended message sizes and for software image
+ * sizes. The buffer sizes of the checks cover every size threshold of
+ * pa_omci_crc32(), so each implementation selected by size is verified on
+ * the CPU running the test. The AES-CMAC of the OMCI MIC is checked against
+ * the RFC 4493 test vectors, HMAC-SHA-256 and HMAC-SHA-512 against the
+ * RFC 4231 test vectors. Run by "make bench".
+ *
+ * Usage: crc_bench [-c] [-f MHz] [-s seed]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "pon_adapter_crc.h"
+#include "pon_adapter_mic.h"
+#include "pon_adapter_hmac.h"
+#include "bench_common.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#define BENCH_TSC 1
+#else
+#define BENCH_TSC 0
+#endif
+
+/** Polynomial of ITU-T I.363.5, without the x^32 term */
+#define REF_POLY 0x04c11db7
+
+/** Number of bytes processed per measurement */
+#define BENCH_BYTES (256UL * 1024 * 1024)
+
+/** Number of messages per call of pa_omci_crc32_batch() */
+#define BENCH_BATCH 64
+
+/** Largest buffer of the random checks */
+#define CHECK_SIZE_MAX (1024 * 1024)
+
+static const size_t sizes[] = { 48, 1980, 4 * 1024 * 1024,
+				32 * 1024 * 1024 };
+
+static uint32_t ref_table[256];
+
+/** CPU clock in MHz given by -f, used where no time stamp counter exists */
+static double cpu_mhz;
+
+static void rand_fill(uint8_t *buf, size_t size)
+{
+	size_t i;
+
+	for (i = 0; i < size; i++)
+		buf[i] = (uint8_t)bench_rand();
+}
+
+/** Build the reference table bit by bit from the polynomial */
+static void ref_init(void)
+{
+	uint32_t crc, i, bit;
+
+	for (i = 0; i < 256; i++) {
+		crc = i << 24;
+		for (bit = 0; bit < 8; bit++)
+			crc = (crc & 0x80000000) ? (crc << 1) ^ REF_POLY :
+				crc << 1;
+		ref_table[i] = crc;
+	}
+}
+
+/** Reference CRC, byte by byte */
+static uint32_t ref_crc32(uint32_t crc, const uint8_t *data, size_t size)
+{
+	size_t i;
+
+	for (i = 0; i < size; i++)
+		crc = (crc << 8) ^ ref_table[(crc >> 24) ^ data[i]];
+
+	return crc;
+}
+
+static uint64_t cycles(void)
+{
+#if BENCH_TSC
+	return __rdtsc();
+#else
+	return 0;
+#endif
+}
+
+/** Every size up to a few times the thresholds, at every alignment */
+static unsigned int check_sizes(uint8_t *buf)
+{
+	unsigned int failed = 0;
+	unsigned long cases = 0;
+	size_t size, off;
+	uint32_t crc;
+
+	rand_fill(buf, 1100 + 8);
+	for (size = 0; size <= 1100; size++) {
+		for (off = 0; off < 8; off++, cases++) {
+			crc = bench_rand();
+			if (pa_omci_crc32(crc, buf + off, size) !=
+			    ref_crc32(crc, buf + off, size))
+				failed++;
+		}
+	}
+
+	return check_print("pa_omci_crc32", cases, failed);
+}
+
+/** Random sizes up to CHECK_SIZE_MAX, processed in random pieces */
+static unsigned int check_random(uint8_t *buf)
+{
+	struct pa_omci_crc32_ctx ctx, part;
+	unsigned int failed = 0, i;
+	size_t size, pos, len;
+	uint32_t crc, ref;
+
+	for (i = 0; i < 64; i++) {
+		size = bench_rand() % CHECK_SIZE_MAX;
+		rand_fill(buf, size);
+		crc = bench_rand();
+		ref = ref_crc32(crc, buf, size);
+
+		if (pa_omci_crc32(crc, buf, size) != ref)
+			failed++;
+
+		/* chained, streamed and combined in the same pieces */
+		pa_omci_crc32_init(&ctx, crc);
+		for (pos = 0; pos < size; pos += len) {
+			len = bench_rand() % (size - pos + 1);
+			if (i & 1)
+				len %= 300;
+			pa_omci_crc32_init(&part, 0);
+			pa_omci_crc32_update(&part, buf + pos, len);
+			pa_omci_crc32_append(&ctx, &part);
+		}
+		if (pa_omci_crc32_final(&ctx) != ref || ctx.len != size)
+			failed++;
+	}
+
+	return check_print("pa_omci_crc32_append", i, failed);
+}
+
+static unsigned int check_combine(uint8_t *buf)
+{
+	unsigned int failed = 0, i;
+	uint64_t zero_a, zero_b;
+	uint32_t crc, a, b;
+	size_t len_a, len_b;
+
+	rand_fill(buf, 65536);
+	for (i = 0; i < 4096; i++) {
+		len_a = bench_rand() % 32768;
+		len_b = i < 64 ? i : bench_rand() % 32768;
+		crc = bench_rand();
+		a = ref_crc32(crc, buf, len_a);
+		b = ref_crc32(0, buf + len_a, len_b);
+		if (pa_omci_crc32_combine(a, b, len_b) !=
+		    ref_crc32(crc, buf, len_a + len_b))
+			failed++;
+	}
+
+	/* lengths beyond 4 GiB, zero blocks have the CRC 0 when started
+	 * with 0, so shifting over both parts equals shifting over the sum
+	 */
+	for (; i < 4096 + 64; i++) {
+		zero_a = ((uint64_t)bench_rand() << 8) + bench_rand();
+		zero_b = ((uint64_t)bench_rand() << 8) + bench_rand();
+		crc = bench_rand();
+		a = pa_omci_crc32_combine(crc, 0, zero_a);
+		if (pa_omci_crc32_combine(a, 0, zero_b) !=
+		    pa_omci_crc32_combine(crc, 0, zero_a + zero_b))
+			failed++;
+	}
+
+	return check_print("pa_omci_crc32_combine", i, failed);
+}
+
+static unsigned int check_batch(uint8_t *buf)
+{
+	const uint8_t *msgs[BENCH_BATCH];
+	size_t lens[BENCH_BATCH];
+	uint32_t crcs[BENCH_BATCH], init[BENCH_BATCH];
+	unsigned int failed = 0, i, j, n;
+	unsigned long cases = 0;
+
+	rand_fill(buf, 65536 + 4096);
+	for (i = 0; i < 1000; i++) {
+		n = bench_rand() % (BENCH_BATCH + 1);
+		for (j = 0; j < n; j++) {
+			msgs[j] = buf + bench_rand() % 65536;
+			/* mostly OMCI message sizes, some long ones */
+			lens[j] = bench_rand() % 8 ? bench_rand() % 2048 :
+				bench_rand() % 4096;
+			crcs[j] = init[j] = bench_rand();
+		}
+		pa_omci_crc32_batch(msgs, lens, crcs, n);
+		for (j = 0; j < n; j++, cases++)
+			if (crcs[j] != ref_crc32(init[j], msgs[j], lens[j]))
+				failed++;
+	}
+
+	return check_print("pa_omci_crc32_batch", cases, failed);
+}
+
+static unsigned int check_copy(uint8_t *buf)
+{
+	uint8_t *src = buf, *dst = buf + CHECK_SIZE_MAX / 2;
+	unsigned int failed = 0, i;
+	size_t size, off;
+	uint32_t crc;
+
+	rand_fill(src, CHECK_SIZE_MAX / 2);
+	for (i = 0; i < 4096; i++) {
+		size = bench_rand() % (i & 1 ? 2048 : CHECK_SIZE_MAX / 4);
+		off = bench_rand() % 16;
+		crc = bench_rand();
+		memset(dst, 0xa5, size + 32);
+		if (pa_omci_copy_crc32(dst + off, src + i % 16, size, crc) !=
+		    ref_crc32(crc, src + i % 16, size) ||
+		    memcmp(dst + off, src + i % 16, size) ||
+		    (off && dst[off - 1] != 0xa5) || dst[off + size] != 0xa5)
+			failed++;
+	}
+
+	return check_print("pa_omci_copy_crc32", i, failed);
+}
+
+/** Write the buffer to a new temporary file, path is the mkstemp() template */
+static int file_create(char *path, const uint8_t *buf, size_t size)
+{
+	int fd;
+
+	fd = mkstemp(path);
+	if (fd < 0)
+		return -1;
+	if (write(fd, buf, size) != (ssize_t)size) {
+		close(fd);
+		unlink(path);
+		return -1;
+	}
+	close(fd);
+
+	return 0;
+}
+
+static unsigned int check_file(uint8_t *buf)
+{
+	char path[] = "/tmp/crc_benchXXXXXX";
+	unsigned int failed = 0, threads;
+	size_t size = CHECK_SIZE_MAX - 3;
+	uint64_t file_size;
+	uint32_t crc;
+
+	rand_fill(buf, size);
+	if (file_create(path, buf, size)) {
+		printf("%-20s can't create %s\n", "pa_omci_crc32_file", path);
+		return 1;
+	}
+
+	for (threads = 0; threads <= 4; threads++) {
+		if (pa_omci_crc32_file(path, 0xFFFFFFFF, threads, &crc,
+				       &file_size) != PON_ADAPTER_SUCCESS ||
+		    crc != ref_crc32(0xFFFFFFFF, buf, size) ||
+		    file_size != size)
+			failed++;
+	}
+	unlink(path);
+
+	return check_print("pa_omci_crc32_file", threads, failed);
+}
+
+/** RFC 4493 test vectors */
+static const struct {
+	size_t len;
+	uint8_t mac[PA_OMCI_CMAC_LEN];
+} cmac_vectors[] = {
+	{ 0, { 0xbb, 0x1d, 0x69, 0x29, 0xe9, 0x59, 0x37, 0x28,
+	       0x7f, 0xa3, 0x7d, 0x12, 0x9b, 0x75, 0x67, 0x46 } },
+	{ 16, { 0x07, 0x0a, 0x16, 0xb4, 0x6b, 0x4d, 0x41, 0x44,
+		0xf7, 0x9b, 0xdd, 0x9d, 0xd0, 0x4a, 0x28, 0x7c } },
+	{ 40, { 0xdf, 0xa6, 0x67, 0x47, 0xde, 0x9a, 0xe6, 0x30,
+		0x30, 0xca, 0x32, 0x61, 0x14, 0x97, 0xc8, 0x27 } },
+	{ 64, { 0x51, 0xf0, 0xbe, 0xbf, 0x7e, 0x3b, 0x9d, 0x92,
+		0xfc, 0x49, 0x74, 0x17, 0x79, 0x36, 0x3c, 0xfe } },
+};
+
+static const struct pa_omci_ik cmac_key = { {
+	0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+	0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c } };
+
+static const uint8_t cmac_msg[64] = {
+	0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96,
+	0xe9, 0x3d, 0x7e, 0x11, 0x73, 0x93, 0x17, 0x2a,
+	0xae, 0x2d, 0x8a, 0x57, 0x1e, 0x03, 0xac, 0x9c,
+	0x9e, 0xb7, 0x6f, 0xac, 0x45, 0xaf, 0x8e, 0x51,
+	0x30, 0xc8, 0x1c, 0x46, 0xa3, 0x5c, 0xe4, 0x11,
+	0xe5, 0xfb, 0xc1, 0x19, 0x1a, 0x0a, 0x52, 0xef,
+	0xf6, 0x9f, 0x24, 0x45, 0xdf, 0x4f, 0x9b, 0x17,
+	0xad, 0x2b, 0x41, 0x7b, 0xe6, 0x6c, 0x37, 0x10
+};
+
+static struct pa_omci_mic_ctx mic_ctx;
+
+/** AES-CMAC test vectors, then MICs against the AES-CMAC of the direction
+ *  code and the message
+ */
+static unsigned int check_mic(uint8_t *buf)
+{
+	const uint8_t *msgs[BENCH_BATCH];
+	size_t lens[BENCH_BATCH];
+	uint32_t mics[BENCH_BATCH], mic;
+	uint8_t mac[PA_OMCI_CMAC_LEN], *prefixed = buf + 8192;
+	unsigned int failed = 0, ret, i;
+
+	if (pa_omci_mic_key_set(&mic_ctx, &cmac_key) != PON_ADAPTER_SUCCESS)
+		failed++;
+	for (i = 0; i < ARRAY_SIZE(cmac_vectors); i++) {
+		if (pa_omci_cmac(&mic_ctx, cmac_msg, cmac_vectors[i].len,
+				 mac) != PON_ADAPTER_SUCCESS ||
+		    memcmp(mac, cmac_vectors[i].mac, sizeof(mac)))
+			failed++;
+	}
+	ret = check_print("pa_omci_cmac", i, failed);
+
+	failed = 0;
+	rand_fill(buf, 4096);
+	for (i = 0; i < BENCH_BATCH; i++) {
+		msgs[i] = buf + bench_rand() % 1024;
+		lens[i] = i % 4 ? PA_OMCI_MIC_BASELINE_LEN :
+			bench_rand() % 2048;
+	}
+	if (pa_omci_mic_batch(&mic_ctx, PA_OMCI_MIC_UPSTREAM, msgs, lens,
+			      mics, BENCH_BATCH) != PON_ADAPTER_SUCCESS)
+		failed++;
+
+	for (i = 0; i < BENCH_BATCH; i++) {
+		/* the direction code precedes the message */
+		prefixed[0] = PA_OMCI_MIC_UPSTREAM;
+		memcpy(prefixed + 1, msgs[i], lens[i]);
+		if (pa_omci_cmac(&mic_ctx, prefixed, lens[i] + 1, mac) !=
+		    PON_ADAPTER_SUCCESS ||
+		    mics[i] != ((uint32_t)mac[0] << 24 | (uint32_t)mac[1] << 16 |
+				(uint32_t)mac[2] << 8 | mac[3]))
+			failed++;
+		if (pa_omci_mic(&mic_ctx, PA_OMCI_MIC_UPSTREAM, msgs[i],
+				lens[i], &mic) != PON_ADAPTER_SUCCESS ||
+		    mic != mics[i] ||
+		    pa_omci_mic_check(&mic_ctx, PA_OMCI_MIC_DOWNSTREAM, msgs[i],
+				      lens[i], mic) != PON_ADAPTER_ERR_MIC)
+			failed++;
+	}
+
+	return ret + check_print("pa_omci_mic", i, failed);
+}
+
+/** RFC 4231 test cases 2 and 6, the second one with a key longer than the
+ *  SHA-256 block
+ */
+static const struct {
+	const char *key;
+	size_t key_len;
+	const char *data;
+	uint8_t mac256[PA_SHA256_LEN];
+	uint8_t mac512[PA_SHA512_LEN];
+} hmac_vectors[] = {
+	{ "Jefe", 4, "what do ya want for nothing?",
+	  { 0x5b, 0xdc, 0xc1, 0x46, 0xbf, 0x60, 0x75, 0x4e,
+	    0x6a, 0x04, 0x24, 0x26, 0x08, 0x95, 0x75, 0xc7,
+	    0x5a, 0x00, 0x3f, 0x08, 0x9d, 0x27, 0x39, 0x83,
+	    0x9d, 0xec, 0x58, 0xb9, 0x64, 0xec, 0x38, 0x43 },
+	  { 0x16, 0x4b, 0x7a, 0x7b, 0xfc, 0xf8, 0x19, 0xe2,
+	    0xe3, 0x95, 0xfb, 0xe7, 0x3b, 0x56, 0xe0, 0xa3,
+	    0x87, 0xbd, 0x64, 0x22, 0x2e, 0x83, 0x1f, 0xd6,
+	    0x10, 0x27, 0x0c, 0xd7, 0xea, 0x25, 0x05, 0x54,
+	    0x97, 0x58, 0xbf, 0x75, 0xc0, 0x5a, 0x99, 0x4a,
+	    0x6d, 0x03, 0x4f, 0x65, 0xf8, 0xf0, 0xe6, 0xfd,
+	    0xca, 0xea, 0xb1, 0xa3, 0x4d, 0x4a, 0x6b, 0x4b,
+	    0x63, 0x6e, 0x07, 0x0a, 0x38, 0xbc, 0xe7, 0x37 } },
+	{ NULL, 131, "Test Using Larger Than Block-Size Key - Hash Key First",
+	  { 0x60, 0xe4, 0x31, 0x59, 0x1e, 0xe0, 0xb6, 0x7f,
+	    0x0d, 0x8a, 0x26, 0xaa, 0xcb, 0xf5, 0xb7, 0x7f,
+	    0x8e, 0x0b, 0xc6, 0x21, 0x37, 0x28, 0xc5, 0x14,
+	    0x05, 0x46, 0x04, 0x0f, 0x0e, 0xe3, 0x7f, 0x54 },
+	  { 0x80, 0xb2, 0x42, 0x63, 0xc7, 0xc1, 0xa3, 0xeb,
+	    0xb7, 0x14, 0x93, 0xc1, 0xdd, 0x7b, 0xe8, 0xb4,
+	    0x9b, 0x46, 0xd1, 0xf4, 0x1b, 0x4a, 0xee, 0xc1,
+	    0x12, 0x1b, 0x01, 0x37, 0x83, 0xf8, 0xf3, 0x52,
+	    0x6b, 0x56, 0xd0, 0x37, 0xe0, 0x5f, 0x25, 0x98,
+	    0xbd, 0x0f, 0xd2, 0x21, 0x5d, 0x6a, 0x1e, 0x52,
+	    0x95, 0xe6, 0x4f, 0x73, 0xf6, 0x3f, 0x0a, 0xec,
+	    0x8b, 0x91, 0x5a, 0x98, 0x5d, 0x78, 0x65, 0x98 } },
+};
+
+static struct pa_hmac_key hmac_key[2];
+
+/** HMAC test vectors, then HMACs of split random data against the HMAC of
+ *  the whole data
+ */
+static unsigned int check_hmac(uint8_t *buf)
+{
+	enum pon_adapter_enh_sec_ctrl_enc alg;
+	uint8_t key[131], mac[PA_HMAC_MAX_LEN], part_mac[PA_HMAC_MAX_LEN];
+	const uint8_t *parts[3], *k_data;
+	size_t lens[3], len;
+	unsigned int failed = 0, ret, i, k;
+
+	memset(key, 0xaa, sizeof(key));
+	for (i = 0; i < ARRAY_SIZE(hmac_vectors); i++) {
+		k_data = hmac_vectors[i].key ?
+			(const uint8_t *)hmac_vectors[i].key : key;
+		for (k = 0; k < 2; k++) {
+			alg = k ? ENC_HMAC_SHA_512 : ENC_HMAC_SHA_256;
+			if (pa_hmac_key_set(&hmac_key[k], alg, k_data,
+					    hmac_vectors[i].key_len) !=
+			    PON_ADAPTER_SUCCESS ||
+			    pa_hmac(&hmac_key[k],
+				    (const uint8_t *)hmac_vectors[i].data,
+				    strlen(hmac_vectors[i].data), mac) !=
+			    PON_ADAPTER_SUCCESS ||
+			    memcmp(mac, k ? hmac_vectors[i].mac512 :
+				   hmac_vectors[i].mac256, pa_hmac_len(alg)))
+				failed++;
+		}
+	}
+	ret = check_print("pa_hmac", 2 * i, failed);
+
+	failed = 0;
+	rand_fill(buf, 4096);
+	for (i = 0; i < 1000; i++) {
+		k = i % 2;
+		len = bench_rand() % 4096;
+		parts[0] = buf;
+		lens[0] = len ? bench_rand() % len : 0;
+		parts[1] = buf + lens[0];
+		lens[1] = len - lens[0] ? bench_rand() % (len - lens[0]) : 0;
+		parts[2] = parts[1] + lens[1];
+		lens[2] = len - lens[0] - lens[1];
+		if (pa_hmac(&hmac_key[k], buf, len, mac) !=
+		    PON_ADAPTER_SUCCESS ||
+		    pa_hmac_parts(&hmac_key[k], parts, lens, 3, part_mac) !=
+		    PON_ADAPTER_SUCCESS ||
+		    memcmp(mac, part_mac, hmac_key[k].len))
+			failed++;
+	}
+
+	return ret + check_print("pa_hmac_parts", i, failed);
+}
+
+static unsigned int check_all(uint8_t *buf)
+{
+	unsigned int failed = 0;
+	uint8_t check[9] = "123456789";
+
+	/* check value of CRC-32/BZIP2, which uses the same polynomial */
+	failed += check_print("check value", 1,
+			      (pa_omci_crc32(0xFFFFFFFF, check, 9) ^
+			       0xFFFFFFFF) != 0xfc891918);
+	failed += check_sizes(buf);
+	failed += check_random(buf);
+	failed += check_combine(buf);
+	failed += check_batch(buf);
+	failed += check_copy(buf);
+	failed += check_file(buf);
+	failed += check_mic(buf);
+	failed += check_hmac(buf);
+
+	return failed;
+}
+
+/** Functions to benchmark */
+enum bench_func {
+	FUNC_REF,
+	FUNC_CRC,
+	FUNC_BATCH,
+	FUNC_COPY,
+	FUNC_FILE,
+	FUNC_MIC,
+	FUNC_MIC_BATCH,
+	FUNC_HMAC_SHA_256,
+	FUNC_HMAC_SHA_512,
+	FUNC_NUM
+};
+
+static const char * const func_names[FUNC_NUM] = {
+	"reference", "pa_omci_crc32", "pa_omci_crc32_batch",
+	"pa_omci_copy_crc32", "pa_omci_crc32_file", "pa_omci_mic",
+	"pa_omci_mic_batch", "pa_hmac SHA-256", "pa_hmac SHA-512"
+};
+
+static void result_print(enum bench_func func, size_t size,
+			 unsigned long calls, uint64_t ns, uint64_t cyc)
+{
+	double bytes = (double)size * (double)calls;
+	char cpb[16] = "n/a";
+
+	if (!ns)
+		ns = 1;
+	if (BENCH_TSC)
+		snprintf(cpb, sizeof(cpb), "%.3f", (double)cyc / bytes);
+	else if (cpu_mhz > 0)
+		snprintf(cpb, sizeof(cpb), "%.3f",
+			 (double)ns * cpu_mhz / 1000.0 / bytes);
+
+	printf("%-20s %9zu %12.1f %9.2f %9s\n", func_names[func], size,
+	       (double)ns / (double)calls, bytes / (double)ns, cpb);
+}
+
+/** Run one function repeatedly over buffers of one size */
+static void bench_func(enum bench_func func, size_t size, uint8_t *buf,
+		       uint8_t *dst, const char *path)
+{
+	const uint8_t *msgs[BENCH_BATCH];
+	size_t lens[BENCH_BATCH];
+	uint32_t crcs[BENCH_BATCH];
+	unsigned long calls, i, n = 1;
+	volatile uint32_t sink = 0;
+	uint64_t ns, cyc;
+	unsigned int j;
+
+	if (func == FUNC_BATCH || func == FUNC_MIC_BATCH) {
+		/* the messages follow each other in memory, as in a queue */
+		n = BENCH_BATCH;
+		for (j = 0; j < BENCH_BATCH; j++) {
+			msgs[j] = buf + (j * size) % (CHECK_SIZE_MAX - size);
+			lens[j] = size;
+		}
+	}
+
+	calls = BENCH_BYTES / (size * n);
+	if (!calls)
+		calls = 1;
+	/* the slow functions are measured over less data */
+	if ((func == FUNC_REF || func >= FUNC_MIC) && calls > 4)
+		calls /= 4;
+
+	ns = time_ns();
+	cyc = cycles();
+	for (i = 0; i < calls; i++) {
+		switch (func) {
+		case FUNC_REF:
+			sink ^= ref_crc32(0xFFFFFFFF, buf, size);
+			break;
+		case FUNC_CRC:
+			sink ^= pa_omci_crc32(0xFFFFFFFF, buf, size);
+			break;
+		case FUNC_BATCH:
+			for (j = 0; j < BENCH_BATCH; j++)
+				crcs[j] = 0xFFFFFFFF;
+			pa_omci_crc32_batch(msgs, lens, crcs, BENCH_BATCH);
+			sink ^= crcs[0];
+			break;
+		case FUNC_COPY:
+			sink ^= pa_omci_copy_crc32(dst, buf, size,
+						   0xFFFFFFFF);
+			break;
+		case FUNC_FILE:
+			if (pa_omci_crc32_file(path, 0xFFFFFFFF, 0,
+					       &crcs[0], NULL) ==
+			    PON_ADAPTER_SUCCESS)
+				sink ^= crcs[0];
+			break;
+		case FUNC_MIC:
+			if (pa_omci_mic(&mic_ctx, PA_OMCI_MIC_UPSTREAM, buf,
+					size, &crcs[0]) == PON_ADAPTER_SUCCESS)
+				sink ^= crcs[0];
+			break;
+		case FUNC_MIC_BATCH:
+			if (pa_omci_mic_batch(&mic_ctx, PA_OMCI_MIC_UPSTREAM,
+					      msgs, lens, crcs, BENCH_BATCH) ==
+			    PON_ADAPTER_SUCCESS)
+				sink ^= crcs[0];
+			break;
+		case FUNC_HMAC_SHA_256:
+		case FUNC_HMAC_SHA_512:
+			if (pa_hmac(&hmac_key[func - FUNC_HMAC_SHA_256], buf,
+				    size, dst) == PON_ADAPTER_SUCCESS)
+				sink ^= dst[0];
+			break;
+		default:
+			break;
+		}
+	}
+	cyc = cycles() - cyc;
+	ns = time_ns() - ns;
+
+	result_print(func, size, calls * n, ns, cyc);
+}
+
+static int bench_all(uint8_t *buf, uint8_t *dst)
+{
+	char path[] = "/tmp/crc_benchXXXXXX";
+	enum bench_func func;
+	unsigned int s;
+	int ret = 0;
+
+	printf("%-20s %9s %12s %9s %9s\n", "function", "size", "ns/call",
+	       "GB/s", "cycles/B");
+
+	for (s = 0; s < ARRAY_SIZE(sizes); s++) {
+		rand_fill(buf, sizes[s]);
+		for (func = FUNC_REF; func < FUNC_NUM; func++) {
+			/* batches, MICs and HMACs are meant for messages,
+			 * files for images
+			 */
+			if (func >= FUNC_MIC && sizes[s] > CHECK_SIZE_MAX / 2)
+				continue;
+			if (func == FUNC_BATCH && sizes[s] > CHECK_SIZE_MAX / 2)
+				continue;
+			if (func == FUNC_FILE) {
+				if (sizes[s] < CHECK_SIZE_MAX)
+					continue;
+				strcpy(path, "/tmp/crc_benchXXXXXX");
+				if (file_create(path, buf, sizes[s])) {
+					ret = 1;
+					continue;
+				}
+			}
+			bench_func(func, sizes[s], buf, dst, path);
+			if (func == FUNC_FILE)
+				unlink(path);
+		}
+	}
+
+	return ret;
+}
+
+static void usage(const char *name)
+{
+	printf("Usage: %s [-c] [-f MHz] [-s seed]\n"
+	       "  -c  conformance checks only\n"
+	       "  -f  CPU clock for cycles/B without time stamp counter\n",
+	       name);
+}
+
+int main(int argc, char **argv)
+{
+	bool check_only = false;
+	uint8_t *buf, *dst;
+	size_t size;
+	int ret = 0, opt;
+
+	rand_state = 0x9e3779b97f4a7c15ULL;
+
+	while ((opt = getopt(argc, argv, "cf:s:h")) != -1) {
+		switch (opt) {
+		case 'c':
+			check_only = true;
+			break;
+		case 'f':
+			cpu_mhz = strtod(optarg, NULL);
+			break;
+		case 's':
+			rand_state = strtoull(optarg, NULL, 0) | 1;
+			break;
+		default:
+			usage(argv[0]);
+			return opt == 'h' ? 0 : 1;
+		}
+	}
+
+	size = sizes[ARRAY_SIZE(sizes) - 1];
+	buf = malloc(size);
+	dst = malloc(size);
+	if (!buf || !dst) {
+		free(buf);
+		free(dst);
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+
+	ref_init();
+	if (check_all(buf))
+		ret = 1;
+	if (!check_only && !ret) {
+		printf("\n");
+		ret = bench_all(buf, dst);
+	}
+
+	free(buf);
+	free(dst);
+
+	return ret;
+}
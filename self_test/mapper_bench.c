@@ -0,0 +1,1219 @@
+/******************************************************************************
+ *
+ *  Copyright (c) 2024 MaxLinear, Inc.
+ *
+ * For licensing information, see the file 'LICENSE' in the root folder of
+ * this software module.
+ *
+ ******************************************************************************/
+
+/**
+ * \file mapper_bench.c
+ *
+ * Index mapper micro-benchmark.
+ *
+ * Checks the results of every backend and mapping function against a
+ * simple array model first, and concurrent mappers with reader threads
+ * against a writer. Then times the mapper operations for every backend over
+ * several key ranges and access patterns and reports the time and the
+ * number of heap allocations per operation. For concurrent mappers the
+ * get_<n>t rows report the lookup rate of n reader threads, get_<n>t_wr
+ * with a writer at the same time. Run by "make bench".
+ *
+ * Usage: mapper_bench [-c] [-r range] [-b backend] [-p pattern] [-s seed]
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "pon_adapter.h"
+#include "pon_adapter_mapper.h"
+#include "bench_common.h"
+
+/** Minimum number of operations per measurement, small ranges repeat */
+#define BENCH_OPS_MIN 65536
+
+/** Maximum number of timed lookups per fill and of churn steps, limits the
+ *  run time of the list backend for large ranges
+ */
+#define BENCH_SAMPLE_MAX 16384
+
+/** Largest range of the direct backend, PA_MAPPER_DIRECT_RANGE_MAX default */
+#define BENCH_DIRECT_RANGE_MAX 4096
+
+/** Number of heap allocations, counted where the C library allows it */
+static unsigned long alloc_num;
+
+#if defined(__GLIBC__)
+#define BENCH_ALLOC_COUNT 1
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t num, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+
+void *malloc(size_t size)
+{
+	alloc_num++;
+	return __libc_malloc(size);
+}
+
+void *calloc(size_t num, size_t size)
+{
+	alloc_num++;
+	return __libc_calloc(num, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+	alloc_num++;
+	return __libc_realloc(ptr, size);
+}
+#else
+#define BENCH_ALLOC_COUNT 0
+#endif
+
+/** Benchmarked backend configuration */
+struct bench_backend {
+	/** Name as shown and selected by -b */
+	const char *name;
+	/** Mapper flags */
+	uint32_t flags;
+	/** Use a list node arena */
+	bool arena;
+	/** ID range restricted to the index range (direct backend) */
+	bool small;
+};
+
+static const struct bench_backend backends[] = {
+	{ "list", 0, false, false },
+	{ "arena", 0, true, false },
+	{ "hash", MAPPER_FLAG_HASH, false, false },
+	{ "concurrent", MAPPER_FLAG_CONCURRENT, false, false },
+	{ "direct", 0, false, true },
+};
+
+static const uint32_t ranges[] = { 256, 4096, 65536 };
+
+/** Access patterns */
+enum bench_pattern {
+	/** Ascending IDs */
+	PATTERN_SEQ,
+	/** Shuffled IDs */
+	PATTERN_RANDOM,
+	/** Remove and map random IDs in a half full mapper */
+	PATTERN_CHURN,
+	PATTERN_NUM
+};
+
+static const char * const pattern_names[PATTERN_NUM] = {
+	"seq", "random", "churn"
+};
+
+/** One measurement */
+struct bench_result {
+	/** Elapsed time in ns */
+	uint64_t ns;
+	/** Number of operations */
+	uint64_t ops;
+	/** Number of heap allocations */
+	unsigned long allocs;
+};
+
+/** State of a running measurement */
+struct bench_timer {
+	uint64_t start;
+	unsigned long allocs;
+};
+
+/** Cost of an empty measurement in ns, subtracted from every measurement */
+static uint64_t timer_cost;
+
+static void shuffle(uint32_t *keys, uint32_t num)
+{
+	uint32_t i, j, tmp;
+
+	for (i = num - 1; i > 0; i--) {
+		j = bench_rand() % (i + 1);
+		tmp = keys[i];
+		keys[i] = keys[j];
+		keys[j] = tmp;
+	}
+}
+
+static void timer_start(struct bench_timer *t)
+{
+	t->allocs = alloc_num;
+	t->start = time_ns();
+}
+
+static void timer_stop(const struct bench_timer *t, struct bench_result *r,
+		       uint64_t ops)
+{
+	uint64_t ns = time_ns() - t->start;
+
+	r->ns += ns > timer_cost ? ns - timer_cost : 0;
+	r->ops += ops;
+	r->allocs += alloc_num - t->allocs;
+}
+
+/** Measure the cost of the time measurement itself */
+static void timer_calibrate(void)
+{
+	struct bench_result r = { 0 };
+	struct bench_timer t;
+	uint32_t i;
+
+	for (i = 0; i < 1000; i++) {
+		timer_start(&t);
+		timer_stop(&t, &r, 1);
+	}
+	timer_cost = r.ns / r.ops;
+}
+
+static void result_print(const struct bench_backend *b, uint32_t range,
+			 enum bench_pattern pattern, const char *op,
+			 const struct bench_result *r)
+{
+	char allocs[16] = "n/a";
+
+	if (!r->ops)
+		return;
+
+	if (BENCH_ALLOC_COUNT)
+		snprintf(allocs, sizeof(allocs), "%.3f",
+			 (double)r->allocs / (double)r->ops);
+
+	printf("%-10s %6u %-6s %-10s %12.1f %10s\n", b->name, range,
+	       pattern_names[pattern], op, (double)r->ns / (double)r->ops,
+	       allocs);
+}
+
+/** Describe a mapper of the backend for IDs and indexes below range */
+static void entry_init(const struct bench_backend *b, uint32_t range,
+		       struct mapper_entry *entry)
+{
+	memset(entry, 0, sizeof(*entry));
+	entry->min_key[KEY_TYPE_ID] = 0;
+	entry->max_key[KEY_TYPE_ID] = b->small ? range - 1 : 0xFFFFFFFF;
+	entry->min_key[KEY_TYPE_INDEX] = 0;
+	entry->max_key[KEY_TYPE_INDEX] = range - 1;
+	entry->name = b->name;
+	entry->flags = b->flags;
+}
+
+/** Create a single mapper set from the entry */
+static enum pon_adapter_errno set_init(const struct bench_backend *b,
+				       const struct mapper_entry *entry,
+				       struct mapper **m,
+				       struct mapper_arena **arena)
+{
+	*arena = NULL;
+	if (b->arena) {
+		*arena = mapper_arena_alloc(0);
+		if (!*arena)
+			return PON_ADAPTER_ERR_NO_MEMORY;
+	}
+
+	return pa_mapper_init_arena(m, 1, entry, *arena);
+}
+
+/** Create a single mapper set for the backend and range */
+static enum pon_adapter_errno bench_init(const struct bench_backend *b,
+					 uint32_t range,
+					 struct mapper_entry *entry,
+					 struct mapper **m,
+					 struct mapper_arena **arena)
+{
+	entry_init(b, range, entry);
+
+	return set_init(b, entry, m, arena);
+}
+
+static void bench_exit(struct mapper **m, struct mapper_arena *arena)
+{
+	pa_mapper_shutdown(m, 1);
+	if (arena)
+		mapper_arena_free(arena);
+}
+
+static enum pon_adapter_errno map_all(struct mapper *m, const uint32_t *ids,
+				      uint32_t num)
+{
+	uint32_t i, idx;
+
+	for (i = 0; i < num; i++)
+		if (mapper_id_map(m, ids[i], &idx) != PON_ADAPTER_SUCCESS)
+			return PON_ADAPTER_ERROR;
+
+	return PON_ADAPTER_SUCCESS;
+}
+
+/** Fill, search, list, empty and reset a mapper in the given key order */
+static enum pon_adapter_errno bench_fill(const struct bench_backend *b,
+					 uint32_t range,
+					 enum bench_pattern pattern,
+					 uint32_t *ids, uint32_t *order)
+{
+	struct bench_result map = { 0 }, get = { 0 }, array = { 0 },
+			    rm = { 0 }, reset = { 0 };
+	struct mapper_entry entry;
+	struct mapper_arena *arena;
+	struct mapper *m[1];
+	struct bench_timer t;
+	uint32_t *keys, num, idx, i, rep, reps, sample;
+
+	reps = range < BENCH_OPS_MIN ? BENCH_OPS_MIN / range : 1;
+	sample = range < BENCH_SAMPLE_MAX ? range : BENCH_SAMPLE_MAX;
+
+	if (bench_init(b, range, &entry, m, &arena) != PON_ADAPTER_SUCCESS) {
+		fprintf(stderr, "%s: mapper init failed\n", b->name);
+		return PON_ADAPTER_ERROR;
+	}
+
+	for (rep = 0; rep < reps; rep++) {
+		if (pattern == PATTERN_RANDOM) {
+			shuffle(ids, range);
+			memcpy(order, ids, range * sizeof(*order));
+			shuffle(order, range);
+		}
+
+		timer_start(&t);
+		if (map_all(m[0], ids, range) != PON_ADAPTER_SUCCESS) {
+			fprintf(stderr, "%s: map failed\n", b->name);
+			bench_exit(m, arena);
+			return PON_ADAPTER_ERROR;
+		}
+		timer_stop(&t, &map, range);
+
+		timer_start(&t);
+		for (i = 0; i < sample; i++)
+			(void)mapper_index_get(m[0], order[i], &idx);
+		timer_stop(&t, &get, sample);
+
+		timer_start(&t);
+		if (mapper_id_array_get(m[0], &keys, &num) ==
+		    PON_ADAPTER_SUCCESS)
+			free(keys);
+		timer_stop(&t, &array, 1);
+
+		timer_start(&t);
+		for (i = 0; i < range; i++)
+			(void)mapper_id_remove(m[0], order[i]);
+		timer_stop(&t, &rm, range);
+
+		(void)map_all(m[0], ids, range);
+		timer_start(&t);
+		(void)pa_mapper_reset(m, 1);
+		timer_stop(&t, &reset, 1);
+	}
+
+	bench_exit(m, arena);
+
+	result_print(b, range, pattern, "map", &map);
+	result_print(b, range, pattern, "index_get", &get);
+	result_print(b, range, pattern, "remove", &rm);
+	result_print(b, range, pattern, "array_get", &array);
+	result_print(b, range, pattern, "reset", &reset);
+
+	return PON_ADAPTER_SUCCESS;
+}
+
+/** Replace random IDs in a half full mapper, looking up a live ID each time */
+static enum pon_adapter_errno bench_churn(const struct bench_backend *b,
+					  uint32_t range, uint32_t *ids)
+{
+	struct bench_result map = { 0 }, get = { 0 }, rm = { 0 };
+	struct mapper_entry entry;
+	struct mapper_arena *arena;
+	struct mapper *m[1];
+	struct bench_timer t;
+	uint32_t live = range / 2, idx, i, j, k, tmp;
+
+	if (bench_init(b, range, &entry, m, &arena) != PON_ADAPTER_SUCCESS) {
+		fprintf(stderr, "%s: mapper init failed\n", b->name);
+		return PON_ADAPTER_ERROR;
+	}
+
+	/* ids[0 .. live - 1] are mapped, the rest is free */
+	shuffle(ids, range);
+	(void)map_all(m[0], ids, live);
+
+	for (i = 0; i < BENCH_SAMPLE_MAX; i++) {
+		j = bench_rand() % live;
+		k = live + bench_rand() % (range - live);
+
+		timer_start(&t);
+		(void)mapper_id_remove(m[0], ids[j]);
+		timer_stop(&t, &rm, 1);
+
+		timer_start(&t);
+		(void)mapper_id_map(m[0], ids[k], &idx);
+		timer_stop(&t, &map, 1);
+
+		tmp = ids[j];
+		ids[j] = ids[k];
+		ids[k] = tmp;
+
+		timer_start(&t);
+		(void)mapper_index_get(m[0], ids[bench_rand() % live], &idx);
+		timer_stop(&t, &get, 1);
+	}
+
+	bench_exit(m, arena);
+
+	result_print(b, range, PATTERN_CHURN, "map", &map);
+	result_print(b, range, PATTERN_CHURN, "index_get", &get);
+	result_print(b, range, PATTERN_CHURN, "remove", &rm);
+
+	return PON_ADAPTER_SUCCESS;
+}
+
+static enum pon_adapter_errno bench_run(const struct bench_backend *b,
+					uint32_t range,
+					enum bench_pattern pattern)
+{
+	enum pon_adapter_errno ret;
+	uint32_t *ids, *order, i;
+
+	ids = malloc(range * sizeof(*ids));
+	order = malloc(range * sizeof(*order));
+	if (!ids || !order) {
+		free(ids);
+		free(order);
+		return PON_ADAPTER_ERR_NO_MEMORY;
+	}
+
+	for (i = 0; i < range; i++) {
+		ids[i] = i;
+		order[i] = i;
+	}
+
+	if (pattern == PATTERN_CHURN)
+		ret = bench_churn(b, range, ids);
+	else
+		ret = bench_fill(b, range, pattern, ids, order);
+
+	free(ids);
+	free(order);
+
+	return ret;
+}
+
+/** Unmapped key in the check model */
+#define CHECK_NONE 0xFFFFFFFF
+
+/** Number of IDs per block of MODE_RANGE, also the block alignment */
+#define CHECK_BLOCK 4
+
+/** Largest number of IDs per call of MODE_BATCH */
+#define CHECK_BATCH 8
+
+/** Number of churn steps, the whole state is checked every
+ *  CHECK_CHURN_STEPS / 4 steps
+ */
+#define CHECK_CHURN_STEPS 4096
+
+/** Key ranges of the checks, up to two bitmap levels */
+static const uint32_t check_ranges[] = { 64, 1024 };
+
+/** Mapping functions checked against the model */
+enum check_mode {
+	/** mapper_id_map() and mapper_id_remove() */
+	MODE_SINGLE,
+	/** mapper_id_map_batch() and mapper_id_remove_batch() */
+	MODE_BATCH,
+	/** mapper_handle_map_or_get() and mapper_handle_remove() */
+	MODE_HANDLE,
+	/** mapper_id_map_range() and mapper_id_remove_range() */
+	MODE_RANGE,
+	/** mapper_id_map() of a mapper with MAPPER_FLAG_STICKY */
+	MODE_STICKY,
+	/** mapper_id_map() with an index range too large for a used key
+	 *  bitmap, the backend searches the free index
+	 */
+	MODE_WIDE,
+	MODE_NUM
+};
+
+static const char * const mode_names[MODE_NUM] = {
+	"single", "batch", "handle", "range", "sticky", "wide"
+};
+
+/** Reference model of a mapper with IDs and indexes below range */
+struct check_model {
+	/** Mapping functions */
+	enum check_mode mode;
+	/** Number of IDs and indexes */
+	uint32_t range;
+	/** Index per ID, CHECK_NONE if not mapped */
+	uint32_t *idx;
+	/** ID per index, CHECK_NONE if free */
+	uint32_t *id;
+	/** Last index per ID, CHECK_NONE if never mapped */
+	uint32_t *hint;
+	/** Handle per ID (MODE_HANDLE) */
+	struct mapper_handle *h;
+	/** Number of mappings */
+	uint32_t live;
+	/** Number of checked results */
+	unsigned long cases;
+};
+
+/** Number of IDs mapped and removed together */
+static uint32_t model_width(const struct check_model *c)
+{
+	return c->mode == MODE_RANGE ? CHECK_BLOCK : 1;
+}
+
+/** Index the mapper allocates for an ID: the previous index of a sticky
+ *  mapper if it is free, the lowest free index otherwise
+ */
+static uint32_t model_idx_next(const struct check_model *c, uint32_t id)
+{
+	uint32_t i;
+
+	if (c->mode == MODE_STICKY && c->hint[id] != CHECK_NONE &&
+	    c->id[c->hint[id]] == CHECK_NONE)
+		return c->hint[id];
+
+	for (i = 0; i < c->range; i++)
+		if (c->id[i] == CHECK_NONE)
+			return i;
+
+	return CHECK_NONE;
+}
+
+/** First index of the lowest free aligned block */
+static uint32_t model_block_next(const struct check_model *c)
+{
+	uint32_t i, j;
+
+	for (i = 0; i + CHECK_BLOCK <= c->range; i += CHECK_BLOCK) {
+		for (j = 0; j < CHECK_BLOCK; j++)
+			if (c->id[i + j] != CHECK_NONE)
+				break;
+		if (j == CHECK_BLOCK)
+			return i;
+	}
+
+	return CHECK_NONE;
+}
+
+static void model_map(struct check_model *c, uint32_t id, uint32_t idx)
+{
+	c->idx[id] = idx;
+	c->id[idx] = id;
+	c->hint[id] = idx;
+	c->live++;
+}
+
+static void model_unmap(struct check_model *c, uint32_t id)
+{
+	c->id[c->idx[id]] = CHECK_NONE;
+	c->idx[id] = CHECK_NONE;
+	c->live--;
+}
+
+static void model_clear(struct check_model *c)
+{
+	uint32_t i;
+
+	for (i = 0; i < c->range; i++) {
+		c->idx[i] = CHECK_NONE;
+		c->id[i] = CHECK_NONE;
+	}
+	c->live = 0;
+}
+
+/** Map units (single IDs or blocks) and compare the allocated indexes with
+ *  the model
+ */
+static enum pon_adapter_errno check_map(struct mapper *m,
+					struct check_model *c,
+					const uint32_t *units, uint32_t num)
+{
+	uint32_t id[CHECK_BATCH], idx[CHECK_BATCH], expect[CHECK_BATCH];
+	uint32_t w = model_width(c), i, j, got;
+
+	for (i = 0; i < num; i += j) {
+		c->cases++;
+		switch (c->mode) {
+		case MODE_BATCH:
+			/* predicted like consecutive single mappings */
+			for (j = 0; j < CHECK_BATCH && i + j < num; j++) {
+				id[j] = units[i + j];
+				expect[j] = model_idx_next(c, id[j]);
+				model_map(c, id[j], expect[j]);
+			}
+			if (mapper_id_map_batch(m, id, j, idx) !=
+			    PON_ADAPTER_SUCCESS ||
+			    memcmp(idx, expect, j * sizeof(*idx)))
+				return PON_ADAPTER_ERROR;
+			break;
+		case MODE_HANDLE:
+			j = 1;
+			id[0] = units[i];
+			expect[0] = model_idx_next(c, id[0]);
+			if (mapper_handle_map_or_get(m, id[0], &c->h[id[0]]) !=
+			    PON_ADAPTER_SUCCESS ||
+			    mapper_handle_index_get(&c->h[id[0]], &idx[0]) !=
+			    PON_ADAPTER_SUCCESS ||
+			    mapper_handle_id_get(&c->h[id[0]], &got) !=
+			    PON_ADAPTER_SUCCESS ||
+			    idx[0] != expect[0] || got != id[0])
+				return PON_ADAPTER_ERROR;
+			model_map(c, id[0], expect[0]);
+			break;
+		case MODE_RANGE:
+			j = 1;
+			id[0] = units[i] * w;
+			expect[0] = model_block_next(c);
+			if (mapper_id_map_range(m, id[0], w, w, &idx[0]) !=
+			    PON_ADAPTER_SUCCESS || idx[0] != expect[0])
+				return PON_ADAPTER_ERROR;
+			for (got = 0; got < w; got++)
+				model_map(c, id[0] + got, expect[0] + got);
+			break;
+		default:
+			j = 1;
+			id[0] = units[i];
+			expect[0] = model_idx_next(c, id[0]);
+			if (mapper_id_map(m, id[0], &idx[0]) !=
+			    PON_ADAPTER_SUCCESS || idx[0] != expect[0])
+				return PON_ADAPTER_ERROR;
+			model_map(c, id[0], expect[0]);
+			break;
+		}
+	}
+
+	return PON_ADAPTER_SUCCESS;
+}
+
+/** Remove mapped units */
+static enum pon_adapter_errno check_unmap(struct mapper *m,
+					  struct check_model *c,
+					  const uint32_t *units, uint32_t num)
+{
+	enum pon_adapter_errno ret;
+	uint32_t w = model_width(c), i, j;
+
+	c->cases++;
+	if (c->mode == MODE_BATCH && num) {
+		if (mapper_id_remove_batch(m, units, num) !=
+		    PON_ADAPTER_SUCCESS)
+			return PON_ADAPTER_ERROR;
+		for (i = 0; i < num; i++)
+			model_unmap(c, units[i]);
+		return PON_ADAPTER_SUCCESS;
+	}
+
+	for (i = 0; i < num; i++) {
+		if (c->mode == MODE_HANDLE)
+			ret = mapper_handle_remove(m, &c->h[units[i]]);
+		else if (c->mode == MODE_RANGE)
+			ret = mapper_id_remove_range(m, units[i] * w, w);
+		else
+			ret = mapper_id_remove(m, units[i]);
+		if (ret != PON_ADAPTER_SUCCESS)
+			return PON_ADAPTER_ERROR;
+		for (j = 0; j < w; j++)
+			model_unmap(c, units[i] * w + j);
+	}
+
+	return PON_ADAPTER_SUCCESS;
+}
+
+static int key_cmp(const void *a, const void *b)
+{
+	uint32_t ka = *(const uint32_t *)a, kb = *(const uint32_t *)b;
+
+	return ka < kb ? -1 : ka > kb;
+}
+
+/** Iterate over the IDs in [lo, hi] and compare with the model */
+static enum pon_adapter_errno check_cursor(struct mapper *m,
+					   struct check_model *c,
+					   uint32_t lo, uint32_t hi)
+{
+	struct mapper_cursor cur;
+	uint32_t id, idx, next = lo;
+
+	mapper_cursor_init(&cur, lo, hi);
+	while (mapper_cursor_next(m, &cur, &id, &idx) == PON_ADAPTER_SUCCESS) {
+		c->cases++;
+		while (next < c->range && next <= hi &&
+		       c->idx[next] == CHECK_NONE)
+			next++;
+		if (id != next || next > hi || next >= c->range ||
+		    idx != c->idx[next])
+			return PON_ADAPTER_ERROR;
+		next++;
+	}
+
+	/* all mappings in the range were returned */
+	while (next < c->range && next <= hi) {
+		if (c->idx[next] != CHECK_NONE)
+			return PON_ADAPTER_ERROR;
+		next++;
+	}
+
+	return PON_ADAPTER_SUCCESS;
+}
+
+/** Compare every lookup, the ID array, the cursor and the number of
+ *  mappings with the model
+ */
+static enum pon_adapter_errno check_state(struct mapper *m,
+					  struct check_model *c)
+{
+	struct mapper_stats stats;
+	uint32_t *keys, num, key, i, j;
+	enum pon_adapter_errno ret;
+
+	for (i = 0; i < c->range; i++, c->cases += 2) {
+		ret = mapper_index_get(m, i, &key);
+		if (c->idx[i] == CHECK_NONE ? ret == PON_ADAPTER_SUCCESS :
+		    ret != PON_ADAPTER_SUCCESS || key != c->idx[i])
+			return PON_ADAPTER_ERROR;
+
+		ret = mapper_id_get(m, &key, i);
+		if (c->id[i] == CHECK_NONE ? ret == PON_ADAPTER_SUCCESS :
+		    ret != PON_ADAPTER_SUCCESS || key != c->id[i])
+			return PON_ADAPTER_ERROR;
+	}
+
+	c->cases++;
+	if (mapper_id_array_get(m, &keys, &num) != PON_ADAPTER_SUCCESS)
+		return PON_ADAPTER_ERROR;
+	ret = num == c->live ? PON_ADAPTER_SUCCESS : PON_ADAPTER_ERROR;
+	if (num)
+		qsort(keys, num, sizeof(*keys), key_cmp);
+	for (i = 0, j = 0; i < c->range && ret == PON_ADAPTER_SUCCESS; i++)
+		if (c->idx[i] != CHECK_NONE && keys[j++] != i)
+			ret = PON_ADAPTER_ERROR;
+	free(keys);
+	if (ret != PON_ADAPTER_SUCCESS)
+		return ret;
+
+	c->cases++;
+	if (mapper_stats_get(m, &stats) != PON_ADAPTER_SUCCESS ||
+	    stats.live != c->live)
+		return PON_ADAPTER_ERROR;
+
+	if (check_cursor(m, c, 0, 0xFFFFFFFF) != PON_ADAPTER_SUCCESS)
+		return PON_ADAPTER_ERROR;
+
+	return check_cursor(m, c, c->range / 4, c->range / 2 + 1);
+}
+
+/** Map and remove in the order of the pattern, checking the state after
+ *  every phase
+ */
+static enum pon_adapter_errno check_pattern(struct mapper *m,
+					    struct check_model *c,
+					    enum bench_pattern pattern,
+					    uint32_t *units, uint32_t num)
+{
+	uint32_t live = num / 2, i, j, k, tmp;
+
+	if (pattern == PATTERN_RANDOM)
+		shuffle(units, num);
+
+	if (pattern != PATTERN_CHURN) {
+		/* fill, remove and map again half of the units, which
+		 * returns other indexes than before unless sticky
+		 */
+		if (check_map(m, c, units, num) != PON_ADAPTER_SUCCESS ||
+		    check_state(m, c) != PON_ADAPTER_SUCCESS)
+			return PON_ADAPTER_ERROR;
+		if (pattern == PATTERN_RANDOM)
+			shuffle(units, num);
+		if (check_unmap(m, c, units, live) != PON_ADAPTER_SUCCESS ||
+		    check_state(m, c) != PON_ADAPTER_SUCCESS)
+			return PON_ADAPTER_ERROR;
+		if (pattern == PATTERN_RANDOM)
+			shuffle(units, live);
+		if (check_map(m, c, units, live) != PON_ADAPTER_SUCCESS ||
+		    check_state(m, c) != PON_ADAPTER_SUCCESS)
+			return PON_ADAPTER_ERROR;
+
+		if (check_unmap(m, c, units, num) != PON_ADAPTER_SUCCESS)
+			return PON_ADAPTER_ERROR;
+		return check_state(m, c);
+	}
+
+	/* units[0 .. live - 1] are mapped, the rest is free */
+	shuffle(units, num);
+	if (check_map(m, c, units, live) != PON_ADAPTER_SUCCESS)
+		return PON_ADAPTER_ERROR;
+
+	for (i = 0; i < CHECK_CHURN_STEPS; i++) {
+		j = bench_rand() % live;
+		k = live + bench_rand() % (num - live);
+
+		if (check_unmap(m, c, &units[j], 1) != PON_ADAPTER_SUCCESS ||
+		    check_map(m, c, &units[k], 1) != PON_ADAPTER_SUCCESS)
+			return PON_ADAPTER_ERROR;
+
+		tmp = units[j];
+		units[j] = units[k];
+		units[k] = tmp;
+
+		if (!(i % (CHECK_CHURN_STEPS / 4)) &&
+		    check_state(m, c) != PON_ADAPTER_SUCCESS)
+			return PON_ADAPTER_ERROR;
+	}
+
+	if (check_state(m, c) != PON_ADAPTER_SUCCESS)
+		return PON_ADAPTER_ERROR;
+
+	/* a reset removes everything */
+	c->cases++;
+	if (pa_mapper_reset(&m, 1) != PON_ADAPTER_SUCCESS)
+		return PON_ADAPTER_ERROR;
+	model_clear(c);
+
+	return check_state(m, c);
+}
+
+/** Run all patterns of a mode for one backend and range */
+static enum pon_adapter_errno check_run(const struct bench_backend *b,
+					enum check_mode mode, uint32_t range,
+					struct check_model *c)
+{
+	enum pon_adapter_errno ret = PON_ADAPTER_SUCCESS;
+	struct mapper_entry entry;
+	struct mapper_arena *arena;
+	struct mapper *m[1];
+	uint32_t *units, num, i;
+	unsigned int p;
+
+	entry_init(b, range, &entry);
+	if (mode == MODE_STICKY)
+		entry.flags |= MAPPER_FLAG_STICKY;
+	if (mode == MODE_WIDE)
+		entry.max_key[KEY_TYPE_INDEX] = 0xFFFFFFFF;
+
+	c->mode = mode;
+	c->range = range;
+	c->idx = malloc(range * sizeof(*c->idx));
+	c->id = malloc(range * sizeof(*c->id));
+	c->hint = malloc(range * sizeof(*c->hint));
+	c->h = malloc(range * sizeof(*c->h));
+	units = malloc(range * sizeof(*units));
+	if (!c->idx || !c->id || !c->hint || !c->h || !units ||
+	    set_init(b, &entry, m, &arena) != PON_ADAPTER_SUCCESS) {
+		free(c->idx);
+		free(c->id);
+		free(c->hint);
+		free(c->h);
+		free(units);
+		return PON_ADAPTER_ERROR;
+	}
+
+	model_clear(c);
+	for (i = 0; i < range; i++)
+		c->hint[i] = CHECK_NONE;
+
+	num = range / model_width(c);
+	for (p = 0; p < PATTERN_NUM && ret == PON_ADAPTER_SUCCESS; p++) {
+		for (i = 0; i < num; i++)
+			units[i] = i;
+		ret = check_pattern(m[0], c, p, units, num);
+		if (ret != PON_ADAPTER_SUCCESS)
+			fprintf(stderr, "%s/%s: range %u, %s order failed\n",
+				b->name, mode_names[mode], range,
+				pattern_names[p]);
+	}
+
+	bench_exit(m, arena);
+	free(c->idx);
+	free(c->id);
+	free(c->hint);
+	free(c->h);
+	free(units);
+
+	return ret;
+}
+
+/** Largest number of reader threads */
+#define THREAD_READERS_MAX 4
+
+/** Number of keys of the thread check */
+#define THREAD_CHECK_RANGE 1024
+
+/** Number of writer steps of the thread check */
+#define THREAD_CHECK_STEPS 200000
+
+/** Duration of a thread measurement in ns */
+#define THREAD_BENCH_NS 200000000ULL
+
+/** State shared by the reader threads and the writer */
+struct thread_ctx {
+	/** Concurrent mapper */
+	struct mapper *m;
+	/** Number of keys, key i maps thread_id(i) to index i */
+	uint32_t range;
+	/** Keys below stable are mapped while the readers run */
+	uint32_t stable;
+	/** Set by the writer to end the readers */
+	int stop;
+};
+
+/** Reader thread */
+struct thread_reader {
+	struct thread_ctx *ctx;
+	pthread_t thread;
+	/** Random state of the reader */
+	uint64_t seed;
+	/** Number of lookups */
+	unsigned long lookups;
+	/** Number of wrong lookup results */
+	unsigned int failed;
+};
+
+/** Sparse ID of key i, the large ID range selects the hash backend */
+static uint32_t thread_id(uint32_t i)
+{
+	return i * 2654435761U + 1;
+}
+
+/** Look up random keys until stopped. A found mapping must be the one of
+ *  its key, a stable key must always be found.
+ */
+static void *thread_read(void *arg)
+{
+	struct thread_reader *r = arg;
+	struct thread_ctx *c = r->ctx;
+	enum pon_adapter_errno ret;
+	uint32_t i, key;
+
+	while (!__atomic_load_n(&c->stop, __ATOMIC_RELAXED)) {
+		/* local LCG, bench_rand() is not thread safe */
+		r->seed = r->seed * 6364136223846793005ULL +
+			  1442695040888963407ULL;
+		i = (uint32_t)(r->seed >> 33) % c->range;
+
+		ret = mapper_index_get(c->m, thread_id(i), &key);
+		if (ret == PON_ADAPTER_SUCCESS ? key != i : i < c->stable)
+			r->failed++;
+		ret = mapper_id_get(c->m, &key, i);
+		if (ret == PON_ADAPTER_SUCCESS ? key != thread_id(i) :
+		    i < c->stable)
+			r->failed++;
+		r->lookups += 2;
+	}
+
+	return NULL;
+}
+
+/** Start the readers */
+static enum pon_adapter_errno thread_start(struct thread_ctx *c,
+					   struct thread_reader *r,
+					   unsigned int num)
+{
+	unsigned int i;
+
+	__atomic_store_n(&c->stop, 0, __ATOMIC_RELAXED);
+	for (i = 0; i < num; i++) {
+		r[i].ctx = c;
+		r[i].seed = bench_rand() | ((uint64_t)bench_rand() << 32);
+		r[i].lookups = 0;
+		r[i].failed = 0;
+		if (pthread_create(&r[i].thread, NULL, thread_read, &r[i])) {
+			__atomic_store_n(&c->stop, 1, __ATOMIC_RELAXED);
+			while (i--)
+				pthread_join(r[i].thread, NULL);
+			return PON_ADAPTER_ERROR;
+		}
+	}
+
+	return PON_ADAPTER_SUCCESS;
+}
+
+/** Stop the readers */
+static void thread_stop(struct thread_ctx *c, struct thread_reader *r,
+			unsigned int num)
+{
+	unsigned int i;
+
+	__atomic_store_n(&c->stop, 1, __ATOMIC_RELAXED);
+	for (i = 0; i < num; i++)
+		pthread_join(r[i].thread, NULL);
+}
+
+/** Create a concurrent mapper with the stable keys mapped */
+static enum pon_adapter_errno thread_init(const struct bench_backend *b,
+					  uint32_t range,
+					  struct mapper_entry *entry,
+					  struct mapper **m,
+					  struct mapper_arena **arena,
+					  struct thread_ctx *c)
+{
+	uint32_t i;
+
+	if (bench_init(b, range, entry, m, arena) != PON_ADAPTER_SUCCESS)
+		return PON_ADAPTER_ERROR;
+
+	c->m = m[0];
+	c->range = range;
+	for (i = 0; i < c->stable; i++) {
+		if (mapper_explicit_map(c->m, thread_id(i), i) !=
+		    PON_ADAPTER_SUCCESS) {
+			bench_exit(m, *arena);
+			return PON_ADAPTER_ERROR;
+		}
+	}
+
+	return PON_ADAPTER_SUCCESS;
+}
+
+/** Readers against a writer which grows the hash tables and then maps and
+ *  removes random keys, compared with the mapping rule of the keys and at
+ *  the end with the writer's model
+ */
+static unsigned int check_threads(const struct bench_backend *b)
+{
+	struct thread_reader r[THREAD_READERS_MAX];
+	struct thread_ctx c = { .stable = THREAD_CHECK_RANGE / 4 };
+	bool mapped[THREAD_CHECK_RANGE] = { false };
+	struct mapper_entry entry;
+	struct mapper_arena *arena;
+	unsigned long cases = 0;
+	unsigned int failed = 0;
+	struct mapper *m[1];
+	uint32_t range = THREAD_CHECK_RANGE, i, key;
+	enum pon_adapter_errno ret;
+	char name[32];
+
+	snprintf(name, sizeof(name), "%s/threads", b->name);
+	if (thread_init(b, range, &entry, m, &arena, &c) !=
+	    PON_ADAPTER_SUCCESS)
+		return check_print(name, 0, 1);
+	for (i = 0; i < c.stable; i++)
+		mapped[i] = true;
+
+	if (thread_start(&c, r, THREAD_READERS_MAX) != PON_ADAPTER_SUCCESS) {
+		bench_exit(m, arena);
+		return check_print(name, 0, 1);
+	}
+
+	/* ascending keys first, every table growth retires a table */
+	for (i = c.stable; i < range; i++, cases++) {
+		if (mapper_explicit_map(c.m, thread_id(i), i) !=
+		    PON_ADAPTER_SUCCESS)
+			failed++;
+		mapped[i] = true;
+	}
+
+	for (key = 0; key < THREAD_CHECK_STEPS; key++, cases++) {
+		i = c.stable + bench_rand() % (range - c.stable);
+		if (mapped[i])
+			ret = mapper_id_remove(c.m, thread_id(i));
+		else
+			ret = mapper_explicit_map(c.m, thread_id(i), i);
+		if (ret != PON_ADAPTER_SUCCESS)
+			failed++;
+		mapped[i] = !mapped[i];
+	}
+
+	thread_stop(&c, r, THREAD_READERS_MAX);
+	for (i = 0; i < THREAD_READERS_MAX; i++) {
+		cases += r[i].lookups;
+		failed += r[i].failed;
+	}
+
+	for (i = 0; i < range; i++, cases++)
+		if ((mapper_index_get(c.m, thread_id(i), &key) ==
+		     PON_ADAPTER_SUCCESS) != mapped[i] ||
+		    (mapped[i] && key != i))
+			failed++;
+
+	bench_exit(m, arena);
+
+	return check_print(name, cases, failed);
+}
+
+/** Lookup rate of 1 to THREAD_READERS_MAX readers, without and with a
+ *  writer which remaps random keys all the time. The time per lookup is the
+ *  wall time divided by the lookups of all readers, so it drops with the
+ *  number of readers as far as the lookups scale across cores.
+ */
+static enum pon_adapter_errno bench_threads(const struct bench_backend *b,
+					    uint32_t range)
+{
+	struct thread_reader r[THREAD_READERS_MAX];
+	struct thread_ctx c = { .stable = range };
+	struct mapper_entry entry;
+	struct mapper_arena *arena;
+	struct bench_result res;
+	struct mapper *m[1];
+	unsigned int num, i, wr;
+	uint32_t key;
+	uint64_t start;
+	char op[16];
+
+	if (thread_init(b, range, &entry, m, &arena, &c) !=
+	    PON_ADAPTER_SUCCESS) {
+		fprintf(stderr, "%s: mapper init failed\n", b->name);
+		return PON_ADAPTER_ERROR;
+	}
+
+	for (wr = 0; wr < 2; wr++) {
+		for (num = 1; num <= THREAD_READERS_MAX; num *= 2) {
+			if (thread_start(&c, r, num) != PON_ADAPTER_SUCCESS) {
+				bench_exit(m, arena);
+				return PON_ADAPTER_ERROR;
+			}
+
+			start = time_ns();
+			if (!wr)
+				usleep(THREAD_BENCH_NS / 1000);
+			while (wr && time_ns() - start < THREAD_BENCH_NS) {
+				key = bench_rand() % range;
+				(void)mapper_id_remove(c.m, thread_id(key));
+				(void)mapper_explicit_map(c.m, thread_id(key),
+							  key);
+			}
+			thread_stop(&c, r, num);
+
+			memset(&res, 0, sizeof(res));
+			res.ns = time_ns() - start;
+			for (i = 0; i < num; i++)
+				res.ops += r[i].lookups;
+			snprintf(op, sizeof(op), wr ? "get_%ut_wr" : "get_%ut",
+				 num);
+			result_print(b, range, PATTERN_RANDOM, op, &res);
+		}
+	}
+
+	bench_exit(m, arena);
+
+	return PON_ADAPTER_SUCCESS;
+}
+
+/** Compare every backend and mode with the model, returns the number of
+ *  failed combinations
+ */
+static unsigned int check_all(const char *backend)
+{
+	struct check_model c;
+	unsigned int b, mode, r, failed, ret = 0;
+	char name[32];
+
+	for (b = 0; b < ARRAY_SIZE(backends); b++) {
+		if (backend && strcmp(backend, backends[b].name))
+			continue;
+
+		for (mode = 0; mode < MODE_NUM; mode++) {
+			/* direct tables need the small index range */
+			if (backends[b].small && mode == MODE_WIDE)
+				continue;
+
+			failed = 0;
+			c.cases = 0;
+			for (r = 0; r < ARRAY_SIZE(check_ranges); r++)
+				if (check_run(&backends[b], mode,
+					      check_ranges[r], &c) !=
+				    PON_ADAPTER_SUCCESS)
+					failed++;
+
+			snprintf(name, sizeof(name), "%s/%s",
+				 backends[b].name, mode_names[mode]);
+			ret += check_print(name, c.cases, failed);
+		}
+
+		if (backends[b].flags & MAPPER_FLAG_CONCURRENT)
+			ret += check_threads(&backends[b]);
+	}
+
+	return ret;
+}
+
+static void usage(const char *name)
+{
+	printf("Usage: %s [-c] [-r range] [-b backend] [-p pattern] [-s seed]\n"
+	       "  -c  conformance checks only\n"
+	       "  backends: list arena hash concurrent direct\n"
+	       "  patterns: seq random churn\n", name);
+}
+
+int main(int argc, char **argv)
+{
+	const char *backend = NULL, *pattern = NULL;
+	bool check_only = false;
+	uint32_t range = 0;
+	unsigned int b, r, p;
+	int ret = 0, opt;
+
+	rand_state = 0x9e3779b97f4a7c15ULL;
+
+	while ((opt = getopt(argc, argv, "cr:b:p:s:h")) != -1) {
+		switch (opt) {
+		case 'c':
+			check_only = true;
+			break;
+		case 'r':
+			range = (uint32_t)strtoul(optarg, NULL, 0);
+			break;
+		case 'b':
+			backend = optarg;
+			break;
+		case 'p':
+			pattern = optarg;
+			break;
+		case 's':
+			rand_state = strtoull(optarg, NULL, 0) | 1;
+			break;
+		default:
+			usage(argv[0]);
+			return opt == 'h' ? 0 : 1;
+		}
+	}
+
+	if (check_all(backend))
+		return 1;
+	if (check_only)
+		return 0;
+
+	timer_calibrate();
+
+	printf("\n%-10s %6s %-6s %-10s %12s %10s\n", "backend", "range",
+	       "order", "operation", "ns/op", "allocs/op");
+
+	for (r = 0; r < ARRAY_SIZE(ranges); r++) {
+		if (range && range != ranges[r])
+			continue;
+
+		for (b = 0; b < ARRAY_SIZE(backends); b++) {
+			if (backend && strcmp(backend, backends[b].name))
+				continue;
+			/* direct tables are limited to small ranges */
+			if (backends[b].small &&
+			    ranges[r] > BENCH_DIRECT_RANGE_MAX)
+				continue;
+
+			for (p = 0; p < PATTERN_NUM; p++) {
+				if (pattern && strcmp(pattern,
+						      pattern_names[p]))
+					continue;
+
+				if (bench_run(&backends[b], ranges[r], p) !=
+				    PON_ADAPTER_SUCCESS)
+					ret = 1;
+			}
+
+			/* lookup scaling, readers pick random keys */
+			if ((backends[b].flags & MAPPER_FLAG_CONCURRENT) &&
+			    (!pattern ||
+			     !strcmp(pattern, pattern_names[PATTERN_RANDOM])) &&
+			    bench_threads(&backends[b], ranges[r]) !=
+			    PON_ADAPTER_SUCCESS)
+				ret = 1;
+		}
+	}
+
+	return ret;
+}
@@ -0,0 +1,451 @@
+/******************************************************************************
+ *
+ *  Copyright (c) 2024 MaxLinear, Inc.
+ *
+ * For licensing information, see the file 'LICENSE' in the root folder of
+ * this software module.
+ *
+ ******************************************************************************/
+
+/**
+ * \file msg_ring_bench.c
+ *
+ * OMCI message receive ring conformance test and benchmark.
+ *
+ * Checks the ring against a model of the expected messages, single threaded
+ * in random put, poll and release steps and with a producer and a consumer
+ * thread. Then compares the message rate of a lower layer thread delivering
+ * messages through a receive callback, which copies them into a locked
+ * higher layer queue, with the rate through the ring. Run by "make bench".
+ *
+ * Usage: msg_ring_bench [-c] [-n messages] [-s seed]
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "pon_adapter_crc.h"
+#include "pon_adapter_msg_ring.h"
+#include "bench_common.h"
+
+/** Number of ring slots, also the size of the callback queue */
+#define BENCH_SLOTS 64
+
+/** Maximum number of slots processed per poll */
+#define BENCH_POLL_MAX 16
+
+/** Baseline and extended OMCI message sizes */
+static const uint16_t sizes[] = { 48, 1980 };
+
+/** Number of messages per measurement */
+static unsigned long bench_msgs = 1000000;
+
+/** Size of message number seq, between 4 and PA_MSG_RING_MSG_MAX */
+static uint16_t msg_len(uint32_t seq)
+{
+	return (uint16_t)(4 + (seq * 2654435761U) % (PA_MSG_RING_MSG_MAX - 3));
+}
+
+/** Build message number seq, starting with the number */
+static void msg_fill(uint8_t *msg, uint32_t seq, uint16_t len)
+{
+	uint16_t i;
+
+	memcpy(msg, &seq, sizeof(seq));
+	for (i = sizeof(seq); i < len; i++)
+		msg[i] = (uint8_t)(seq + i);
+}
+
+/** Check that a slot contains message number seq */
+static bool msg_valid(const struct pa_msg_ring_slot *slot, uint32_t seq)
+{
+	uint16_t len = msg_len(seq), i;
+	uint32_t num;
+
+	if (slot->len != len || !(slot->flags & PA_MSG_RING_SLOT_CRC) ||
+	    slot->crc != pa_omci_crc32(0xFFFFFFFF, slot->msg, len))
+		return false;
+	memcpy(&num, slot->msg, sizeof(num));
+	if (num != seq)
+		return false;
+	for (i = sizeof(num); i < len; i++)
+		if (slot->msg[i] != (uint8_t)(seq + i))
+			return false;
+
+	return true;
+}
+
+/** Random steps of one thread, the ring must always contain the messages
+ *  from the released to the produced number
+ */
+static unsigned int check_steps(uint8_t *buf)
+{
+	const struct pa_msg_ring_slot *slots[BENCH_SLOTS + 1];
+	uint32_t produced = 0, released = 0, polled, crc, n, i, step;
+	struct pa_msg_ring *ring;
+	unsigned int failed = 0;
+	uint16_t len;
+
+	if (pa_msg_ring_create(BENCH_SLOTS, &ring) != PON_ADAPTER_SUCCESS)
+		return check_print("pa_msg_ring", 0, 1);
+
+	for (step = 0; step < 20000; step++) {
+		n = bench_rand() % (BENCH_SLOTS + 4);
+		for (i = 0; i < n; i++) {
+			len = msg_len(produced);
+			msg_fill(buf, produced, len);
+			crc = pa_omci_crc32(0xFFFFFFFF, buf, len);
+			if (pa_msg_ring_put(ring, buf, len, &crc) !=
+			    PON_ADAPTER_SUCCESS) {
+				/* only allowed if the ring is full */
+				if (produced - released != BENCH_SLOTS)
+					failed++;
+				break;
+			}
+			produced++;
+		}
+
+		n = bench_rand() % (BENCH_SLOTS + 2);
+		polled = pa_msg_ring_poll(ring, slots, n);
+		if (polled != (produced - released < n ?
+			       produced - released : n))
+			failed++;
+		for (i = 0; i < polled; i++)
+			if (!msg_valid(slots[i], released + i))
+				failed++;
+
+		n = polled ? bench_rand() % (polled + 1) : 0;
+		pa_msg_ring_release(ring, n);
+		released += n;
+	}
+
+	if (pa_msg_ring_put(ring, buf, PA_MSG_RING_MSG_MAX + 1, NULL) !=
+	    PON_ADAPTER_ERR_SIZE)
+		failed++;
+	pa_msg_ring_destroy(ring);
+
+	return check_print("pa_msg_ring", step, failed);
+}
+
+/** Rings in caller memory, attached a second time */
+static unsigned int check_attach(uint8_t *buf)
+{
+	const struct pa_msg_ring_slot *slots[1];
+	struct pa_msg_ring *ring, *other;
+	size_t size = pa_msg_ring_size(4);
+	/* the bench buffers are allocated by malloc, aligned to 16 byte */
+	uint8_t *mem = buf + (64 - (size_t)buf % 64) % 64;
+	unsigned int failed = 0;
+	uint32_t crc = 0;
+
+	if (!size || pa_msg_ring_size(3) || pa_msg_ring_size(0))
+		failed++;
+	if (pa_msg_ring_init(mem + 16, size, 4, &ring) !=
+	    PON_ADAPTER_ERR_PTR_INVALID ||
+	    pa_msg_ring_init(mem, size - 1, 4, &ring) !=
+	    PON_ADAPTER_ERR_SIZE ||
+	    pa_msg_ring_init(mem, size, 6, &ring) !=
+	    PON_ADAPTER_ERR_INVALID_VAL)
+		failed++;
+
+	memset(mem, 0, size);
+	if (pa_msg_ring_attach(mem, size, &other) !=
+	    PON_ADAPTER_ERR_NOT_FOUND)
+		failed++;
+	if (pa_msg_ring_init(mem, size, 4, &ring) != PON_ADAPTER_SUCCESS ||
+	    pa_msg_ring_attach(mem, size - 1, &other) !=
+	    PON_ADAPTER_ERR_SIZE ||
+	    pa_msg_ring_attach(mem, size, &other) != PON_ADAPTER_SUCCESS) {
+		failed++;
+	} else {
+		/* a message put through one handle is read by the other */
+		msg_fill(mem + size, 7, msg_len(7));
+		crc = pa_omci_crc32(0xFFFFFFFF, mem + size, msg_len(7));
+		if (pa_msg_ring_put(ring, mem + size, msg_len(7), &crc) !=
+		    PON_ADAPTER_SUCCESS ||
+		    pa_msg_ring_poll(other, slots, 1) != 1 ||
+		    !msg_valid(slots[0], 7))
+			failed++;
+		pa_msg_ring_release(other, 1);
+		if (pa_msg_ring_poll(ring, slots, 1))
+			failed++;
+	}
+
+	return check_print("pa_msg_ring_attach", 1, failed);
+}
+
+/** Producer and consumer thread of one measurement */
+struct bench_ctx {
+	/** Ring, NULL for the callback queue */
+	struct pa_msg_ring *ring;
+	/** Message size, 0 for the check messages */
+	uint16_t size;
+	/** Number of messages */
+	unsigned long msgs;
+	/** Lower layer receive buffer */
+	uint8_t *rx_buf;
+
+	/** Higher layer queue of the callback */
+	uint8_t (*queue)[PA_MSG_RING_MSG_MAX];
+	/** Message sizes in the queue */
+	uint16_t queue_len[BENCH_SLOTS];
+	/** Queue positions */
+	unsigned long queue_head, queue_tail;
+	/** Queue lock */
+	pthread_mutex_t lock;
+
+	/** Consumer result, sum of the first message bytes */
+	uint32_t sum;
+	/** Number of invalid messages */
+	unsigned int failed;
+};
+
+/** Receive callback of the higher layer, copies the message into its
+ *  queue
+ */
+static enum pon_adapter_errno hl_receive(void *hl_handle, const uint8_t *msg,
+					 const uint16_t len,
+					 const uint32_t *crc)
+{
+	struct bench_ctx *b = hl_handle;
+	enum pon_adapter_errno ret = PON_ADAPTER_ERR_OMCI_MSG_FIFO_FULL;
+	unsigned long pos;
+
+	(void)crc;
+	pthread_mutex_lock(&b->lock);
+	if (b->queue_head - b->queue_tail < BENCH_SLOTS) {
+		pos = b->queue_head++ % BENCH_SLOTS;
+		memcpy(b->queue[pos], msg, len);
+		b->queue_len[pos] = len;
+		ret = PON_ADAPTER_SUCCESS;
+	}
+	pthread_mutex_unlock(&b->lock);
+
+	return ret;
+}
+
+/** Lower layer thread, receives the messages into the ring or through the
+ *  callback
+ */
+static void *producer_thread(void *arg)
+{
+	struct bench_ctx *b = arg;
+	struct pa_msg_ring_slot *slot;
+	unsigned long i;
+	uint32_t crc = 0;
+	uint16_t len;
+
+	for (i = 0; i < b->msgs; i++) {
+		if (!b->size) {
+			/* check: received straight into the ring slot */
+			len = msg_len((uint32_t)i);
+			while (!(slot = pa_msg_ring_slot_get(b->ring)))
+				sched_yield();
+			msg_fill(slot->msg, (uint32_t)i, len);
+			slot->len = len;
+			slot->crc = pa_omci_crc32(0xFFFFFFFF, slot->msg, len);
+			slot->flags = PA_MSG_RING_SLOT_CRC;
+			pa_msg_ring_slot_push(b->ring);
+			continue;
+		}
+
+		/* bench: the driver delivered the message to rx_buf */
+		memcpy(b->rx_buf, &i, sizeof(uint32_t));
+		if (b->ring) {
+			while (pa_msg_ring_put(b->ring, b->rx_buf, b->size,
+					       &crc) != PON_ADAPTER_SUCCESS)
+				sched_yield();
+		} else {
+			while (hl_receive(b, b->rx_buf, b->size, &crc) !=
+			       PON_ADAPTER_SUCCESS)
+				sched_yield();
+		}
+	}
+
+	return NULL;
+}
+
+/** Higher layer thread, processes the messages */
+static void *consumer_thread(void *arg)
+{
+	const struct pa_msg_ring_slot *slots[BENCH_POLL_MAX];
+	uint8_t msg[PA_MSG_RING_MSG_MAX];
+	struct bench_ctx *b = arg;
+	unsigned long done = 0;
+	uint32_t n, i;
+	uint16_t len;
+
+	while (done < b->msgs) {
+		if (b->ring) {
+			n = pa_msg_ring_poll(b->ring, slots, BENCH_POLL_MAX);
+			for (i = 0; i < n; i++) {
+				if (!b->size &&
+				    !msg_valid(slots[i], (uint32_t)(done + i)))
+					b->failed++;
+				b->sum += slots[i]->msg[0];
+			}
+			pa_msg_ring_release(b->ring, n);
+		} else {
+			n = 0;
+			pthread_mutex_lock(&b->lock);
+			if (b->queue_head != b->queue_tail) {
+				i = b->queue_tail++ % BENCH_SLOTS;
+				len = b->queue_len[i];
+				memcpy(msg, b->queue[i], len);
+				n = 1;
+			}
+			pthread_mutex_unlock(&b->lock);
+			if (n)
+				b->sum += msg[0];
+		}
+		if (!n)
+			sched_yield();
+		done += n;
+	}
+
+	return NULL;
+}
+
+/** Run producer and consumer thread, returns the time in ns */
+static uint64_t bench_run(struct bench_ctx *b)
+{
+	pthread_t producer;
+	uint64_t ns;
+
+	ns = time_ns();
+	if (pthread_create(&producer, NULL, producer_thread, b)) {
+		b->failed++;
+		return 0;
+	}
+	consumer_thread(b);
+	pthread_join(producer, NULL);
+
+	return time_ns() - ns;
+}
+
+/** Producer and consumer thread, ordered messages with correct CRC */
+static unsigned int check_threads(void)
+{
+	struct bench_ctx b;
+
+	memset(&b, 0, sizeof(b));
+	b.msgs = bench_msgs / 4;
+	if (pa_msg_ring_create(BENCH_SLOTS, &b.ring) != PON_ADAPTER_SUCCESS)
+		return check_print("pa_msg_ring threads", 0, 1);
+	(void)bench_run(&b);
+	pa_msg_ring_destroy(b.ring);
+
+	return check_print("pa_msg_ring threads", b.msgs, b.failed);
+}
+
+static int bench_all(uint8_t *buf)
+{
+	static const char * const mode_names[] = { "msg_rx_cb_register",
+						   "msg_rx_ring_get" };
+	struct bench_ctx b;
+	unsigned int s, mode;
+	uint64_t ns;
+
+	printf("%-20s %9s %12s %12s\n", "receive", "size", "ns/msg",
+	       "Mmsg/s");
+
+	for (s = 0; s < ARRAY_SIZE(sizes); s++) {
+		for (mode = 0; mode < ARRAY_SIZE(mode_names); mode++) {
+			memset(&b, 0, sizeof(b));
+			b.size = sizes[s];
+			b.msgs = bench_msgs;
+			b.rx_buf = buf;
+			memset(buf, 0x5a, b.size);
+			if (mode) {
+				if (pa_msg_ring_create(BENCH_SLOTS, &b.ring) !=
+				    PON_ADAPTER_SUCCESS)
+					return 1;
+			} else {
+				b.queue = malloc(sizeof(*b.queue) *
+						 BENCH_SLOTS);
+				if (!b.queue)
+					return 1;
+				pthread_mutex_init(&b.lock, NULL);
+			}
+
+			ns = bench_run(&b);
+			if (!ns)
+				ns = 1;
+			printf("%-20s %9u %12.1f %12.2f\n", mode_names[mode],
+			       b.size, (double)ns / (double)b.msgs,
+			       (double)b.msgs * 1000.0 / (double)ns);
+
+			if (mode) {
+				pa_msg_ring_destroy(b.ring);
+			} else {
+				pthread_mutex_destroy(&b.lock);
+				free(b.queue);
+			}
+			if (b.failed)
+				return 1;
+		}
+	}
+
+	return 0;
+}
+
+static void usage(const char *name)
+{
+	printf("Usage: %s [-c] [-n messages] [-s seed]\n"
+	       "  -c  conformance checks only\n"
+	       "  -n  number of messages per measurement\n",
+	       name);
+}
+
+int main(int argc, char **argv)
+{
+	bool check_only = false;
+	unsigned int failed = 0;
+	uint8_t *buf;
+	int ret = 0, opt;
+
+	rand_state = 0x9e3779b97f4a7c15ULL;
+
+	while ((opt = getopt(argc, argv, "cn:s:h")) != -1) {
+		switch (opt) {
+		case 'c':
+			check_only = true;
+			break;
+		case 'n':
+			bench_msgs = strtoul(optarg, NULL, 0);
+			if (!bench_msgs)
+				bench_msgs = 1;
+			break;
+		case 's':
+			rand_state = strtoull(optarg, NULL, 0) | 1;
+			break;
+		default:
+			usage(argv[0]);
+			return opt == 'h' ? 0 : 1;
+		}
+	}
+
+	/* messages and a ring of 4 slots */
+	buf = malloc(2 * PA_MSG_RING_SLOT_SIZE + pa_msg_ring_size(4) + 64);
+	if (!buf) {
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+
+	failed += check_steps(buf);
+	failed += check_attach(buf);
+	failed += check_threads();
+	if (failed)
+		ret = 1;
+	if (!check_only && !ret) {
+		printf("\n");
+		ret = bench_all(buf);
+	}
+
+	free(buf);
+
+	return ret;
+}
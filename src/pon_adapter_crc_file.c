@@ -0,0 +1,235 @@
+/******************************************************************************
+ *
+ *  Copyright (c) 2024 MaxLinear, Inc.
+ *
+ * For licensing information, see the file 'LICENSE' in the root folder of
+ * this software module.
+ *
+ ******************************************************************************/
+
+/**
+ * \file pon_adapter_crc_file.c
+ *
+ * CRC-32 calculation over files, for the verification of downloaded
+ * software images.
+ *
+ * The file is mapped into memory and split into one block per thread. The
+ * CRC of every block is calculated independently and the results are merged
+ * by \ref pa_omci_crc32_combine. If the file can't be mapped, it is read
+ * sequentially by the calling thread.
+ *
+ * The block threads only live for one call. With PA_CRC_FILE_BLOCK_MIN per
+ * thread, starting and joining a thread costs a few percent of the CRC work
+ * of its block, which does not justify a pool that lives as long as the
+ * library and needs its own shutdown.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "pon_adapter_crc.h"
+#include "pon_adapter_debug.h"
+
+#ifndef _WIN32
+#define CRC_FILE_MMAP 1
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#define CRC_FILE_MMAP 0
+#endif
+
+/** Maximum number of threads used for one file */
+#ifndef PA_CRC_FILE_THREAD_MAX
+#define PA_CRC_FILE_THREAD_MAX 16
+#endif
+
+/** Minimum block size per thread, smaller files use less threads */
+#ifndef PA_CRC_FILE_BLOCK_MIN
+#define PA_CRC_FILE_BLOCK_MIN (1024 * 1024)
+#endif
+
+/** Buffer size for reading files which can't be mapped */
+#define CRC_FILE_READ_SIZE (64 * 1024)
+
+/** Read the file sequentially
+ *
+ * \param[in]  filepath   File path
+ * \param[in]  crc        Initial CRC value
+ * \param[out] file_crc   Calculated CRC
+ * \param[out] file_size  File size
+ *
+ * \return
+ *    - PON_ADAPTER_SUCCESS   CRC calculated
+ *    - PON_ADAPTER_ERROR     File can't be read
+ */
+static enum pon_adapter_errno crc_file_read(const char *filepath,
+					    uint32_t crc,
+					    uint32_t *file_crc,
+					    uint64_t *file_size)
+{
+	enum pon_adapter_errno ret = PON_ADAPTER_SUCCESS;
+	struct pa_omci_crc32_ctx ctx;
+	uint8_t *buf;
+	size_t len;
+	FILE *f;
+
+	buf = malloc(CRC_FILE_READ_SIZE);
+	if (!buf)
+		return PON_ADAPTER_ERR_NO_MEMORY;
+
+	f = fopen(filepath, "rb");
+	if (!f) {
+		PA_DBG_PRINT("Can't open %s\n", filepath);
+		free(buf);
+		return PON_ADAPTER_ERROR;
+	}
+
+	pa_omci_crc32_init(&ctx, crc);
+	do {
+		len = fread(buf, 1, CRC_FILE_READ_SIZE, f);
+		pa_omci_crc32_update(&ctx, buf, len);
+	} while (len == CRC_FILE_READ_SIZE);
+	if (ferror(f))
+		ret = PON_ADAPTER_ERROR;
+
+	fclose(f);
+	free(buf);
+
+	*file_crc = pa_omci_crc32_final(&ctx);
+	*file_size = ctx.len;
+
+	return ret;
+}
+
+#if CRC_FILE_MMAP
+/** Block of a mapped file */
+struct crc_file_block {
+	/** Block data */
+	const uint8_t *data;
+	/** Block size */
+	size_t size;
+	/** CRC of the block, calculated with initial value 0 */
+	uint32_t crc;
+	/** Thread calculating the block CRC */
+	pthread_t thread;
+	/** Thread was started */
+	bool started;
+};
+
+/** Thread function, calculates the CRC of one block */
+static void *crc_file_block_thread(void *arg)
+{
+	struct crc_file_block *b = arg;
+
+	b->crc = pa_omci_crc32(0, b->data, b->size);
+
+	return NULL;
+}
+
+/** Number of threads to use if not given by the caller */
+static unsigned int crc_file_thread_num(void)
+{
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+	return cpus > 0 ? (unsigned int)cpus : 1;
+}
+
+/** Calculate the CRC of a mapped file
+ *
+ * \param[in]  data        File content
+ * \param[in]  size        File size
+ * \param[in]  crc         Initial CRC value
+ * \param[in]  thread_num  Number of threads
+ *
+ * \return Calculated CRC
+ */
+static uint32_t crc_file_mapped(const uint8_t *data, size_t size,
+				uint32_t crc, unsigned int thread_num)
+{
+	struct crc_file_block b[PA_CRC_FILE_THREAD_MAX];
+	size_t block_size;
+	unsigned int i;
+
+	if (!thread_num)
+		thread_num = crc_file_thread_num();
+	if (thread_num > PA_CRC_FILE_THREAD_MAX)
+		thread_num = PA_CRC_FILE_THREAD_MAX;
+	if (thread_num > size / PA_CRC_FILE_BLOCK_MIN)
+		thread_num = (unsigned int)(size / PA_CRC_FILE_BLOCK_MIN);
+	if (thread_num <= 1)
+		return pa_omci_crc32(crc, data, size);
+
+	block_size = size / thread_num;
+	for (i = 0; i < thread_num; i++) {
+		b[i].data = data + i * block_size;
+		b[i].size = i == thread_num - 1 ?
+			size - i * block_size : block_size;
+		/* the first block is handled by the calling thread */
+		b[i].started = i && !pthread_create(&b[i].thread, NULL,
+						    crc_file_block_thread,
+						    &b[i]);
+	}
+
+	crc = pa_omci_crc32(crc, b[0].data, b[0].size);
+	for (i = 1; i < thread_num; i++) {
+		if (b[i].started)
+			pthread_join(b[i].thread, NULL);
+		else
+			crc_file_block_thread(&b[i]);
+		crc = pa_omci_crc32_combine(crc, b[i].crc, b[i].size);
+	}
+
+	return crc;
+}
+#endif
+
+enum pon_adapter_errno pa_omci_crc32_file(const char *filepath,
+					  uint32_t crc,
+					  unsigned int thread_num,
+					  uint32_t *file_crc,
+					  uint64_t *file_size)
+{
+	uint64_t size = 0;
+#if CRC_FILE_MMAP
+	struct stat st;
+	void *data;
+	int fd;
+#endif
+
+	if (!filepath || !file_crc)
+		return PON_ADAPTER_ERR_PTR_INVALID;
+	if (!file_size)
+		file_size = &size;
+
+#if CRC_FILE_MMAP
+	fd = open(filepath, O_RDONLY);
+	if (fd < 0) {
+		PA_DBG_PRINT("Can't open %s\n", filepath);
+		return PON_ADAPTER_ERROR;
+	}
+	if (fstat(fd, &st) || !S_ISREG(st.st_mode) || st.st_size <= 0 ||
+	    (uint64_t)st.st_size > SIZE_MAX) {
+		close(fd);
+		return crc_file_read(filepath, crc, file_crc, file_size);
+	}
+
+	data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED)
+		return crc_file_read(filepath, crc, file_crc, file_size);
+
+#ifdef MADV_SEQUENTIAL
+	(void)madvise(data, (size_t)st.st_size, MADV_SEQUENTIAL);
+#endif
+	*file_crc = crc_file_mapped(data, (size_t)st.st_size, crc, thread_num);
+	*file_size = (uint64_t)st.st_size;
+	munmap(data, (size_t)st.st_size);
+
+	return PON_ADAPTER_SUCCESS;
+#else
+	(void)thread_num;
+	return crc_file_read(filepath, crc, file_crc, file_size);
+#endif
+}
@@ -0,0 +1,707 @@
+/******************************************************************************
+ *
+ *  Copyright (c) 2024 MaxLinear, Inc.
+ *
+ * For licensing information, see the file 'LICENSE' in the root folder of
+ * this software module.
+ *
+ ******************************************************************************/
+
+/**
+ * \file pon_adapter_hmac.c
+ *
+ * SHA-256 and SHA-512 (FIPS 180-4) and HMAC (RFC 2104).
+ *
+ * SHA-256 blocks are compressed with the SHA instructions of the CPU (SHA-NI
+ * on x86, the ARMv8 cryptography extension) if available. SHA-512 is always
+ * calculated in software.
+ */
+
+#include <string.h>
+#include "pon_adapter_hmac.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <cpuid.h>
+#include <immintrin.h>
+#define SHA_HW_X86 1
+#define SHA_TARGET_HW __attribute__((target("sha,sse4.1,ssse3")))
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#include <immintrin.h>
+#define SHA_HW_X86 1
+#define SHA_TARGET_HW
+#elif defined(__aarch64__) && defined(__linux__) && \
+	(defined(__ARM_FEATURE_CRYPTO) || defined(__ARM_FEATURE_SHA2))
+/* only if the compiler targets the crypto extension, the SHA intrinsics
+ * are not available otherwise
+ */
+#include <arm_neon.h>
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#define SHA_HW_ARM 1
+#define SHA_TARGET_HW
+#endif
+
+#if defined(SHA_HW_X86) || defined(SHA_HW_ARM)
+#define SHA_HW 1
+#else
+#define SHA_HW 0
+#endif
+
+/** SHA-256 block size */
+#define SHA256_BLOCK_LEN 64
+
+/** SHA-512 block size */
+#define SHA512_BLOCK_LEN 128
+
+/** HMAC inner padding byte */
+#define HMAC_IPAD 0x36
+
+/** HMAC outer padding byte */
+#define HMAC_OPAD 0x5c
+
+/** SHA-256 initial hash value */
+static const uint32_t sha256_iv[8] = {
+	0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+	0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+/** SHA-256 round constants */
+static const uint32_t sha256_k[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+	0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+	0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+	0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+	0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+	0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+	0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+	0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+	0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+/** SHA-512 initial hash value */
+static const uint64_t sha512_iv[8] = {
+	0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL,
+	0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+	0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL,
+	0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL
+};
+
+/** SHA-512 round constants */
+static const uint64_t sha512_k[80] = {
+	0x428a2f98d728ae22ULL, 0x7137449123ef65cdULL,
+	0xb5c0fbcfec4d3b2fULL, 0xe9b5dba58189dbbcULL,
+	0x3956c25bf348b538ULL, 0x59f111f1b605d019ULL,
+	0x923f82a4af194f9bULL, 0xab1c5ed5da6d8118ULL,
+	0xd807aa98a3030242ULL, 0x12835b0145706fbeULL,
+	0x243185be4ee4b28cULL, 0x550c7dc3d5ffb4e2ULL,
+	0x72be5d74f27b896fULL, 0x80deb1fe3b1696b1ULL,
+	0x9bdc06a725c71235ULL, 0xc19bf174cf692694ULL,
+	0xe49b69c19ef14ad2ULL, 0xefbe4786384f25e3ULL,
+	0x0fc19dc68b8cd5b5ULL, 0x240ca1cc77ac9c65ULL,
+	0x2de92c6f592b0275ULL, 0x4a7484aa6ea6e483ULL,
+	0x5cb0a9dcbd41fbd4ULL, 0x76f988da831153b5ULL,
+	0x983e5152ee66dfabULL, 0xa831c66d2db43210ULL,
+	0xb00327c898fb213fULL, 0xbf597fc7beef0ee4ULL,
+	0xc6e00bf33da88fc2ULL, 0xd5a79147930aa725ULL,
+	0x06ca6351e003826fULL, 0x142929670a0e6e70ULL,
+	0x27b70a8546d22ffcULL, 0x2e1b21385c26c926ULL,
+	0x4d2c6dfc5ac42aedULL, 0x53380d139d95b3dfULL,
+	0x650a73548baf63deULL, 0x766a0abb3c77b2a8ULL,
+	0x81c2c92e47edaee6ULL, 0x92722c851482353bULL,
+	0xa2bfe8a14cf10364ULL, 0xa81a664bbc423001ULL,
+	0xc24b8b70d0f89791ULL, 0xc76c51a30654be30ULL,
+	0xd192e819d6ef5218ULL, 0xd69906245565a910ULL,
+	0xf40e35855771202aULL, 0x106aa07032bbd1b8ULL,
+	0x19a4c116b8d2d0c8ULL, 0x1e376c085141ab53ULL,
+	0x2748774cdf8eeb99ULL, 0x34b0bcb5e19b48a8ULL,
+	0x391c0cb3c5c95a63ULL, 0x4ed8aa4ae3418acbULL,
+	0x5b9cca4f7763e373ULL, 0x682e6ff3d6b2b8a3ULL,
+	0x748f82ee5defb2fcULL, 0x78a5636f43172f60ULL,
+	0x84c87814a1f0ab72ULL, 0x8cc702081a6439ecULL,
+	0x90befffa23631e28ULL, 0xa4506cebde82bde9ULL,
+	0xbef9a3f7b2c67915ULL, 0xc67178f2e372532bULL,
+	0xca273eceea26619cULL, 0xd186b8c721c0c207ULL,
+	0xeada7dd6cde0eb1eULL, 0xf57d4f7fee6ed178ULL,
+	0x06f067aa72176fbaULL, 0x0a637dc5a2c898a6ULL,
+	0x113f9804bef90daeULL, 0x1b710b35131c471bULL,
+	0x28db77f523047d84ULL, 0x32caab7b40c72493ULL,
+	0x3c9ebe0a15c9bebcULL, 0x431d67c49c100d4cULL,
+	0x4cc5d4becb3e42b6ULL, 0x597f299cfc657e2aULL,
+	0x5fcb6fab3ad6faecULL, 0x6c44198c4a475817ULL
+};
+
+/** Hash calculation in progress */
+struct sha2_ctx {
+	/** Hash state */
+	union pa_sha2_state h;
+	/** Partial block */
+	uint8_t buf[SHA512_BLOCK_LEN];
+	/** Bytes in buf */
+	size_t buf_len;
+	/** Bytes hashed so far */
+	uint64_t len;
+	/** SHA-512 instead of SHA-256 */
+	bool sha512;
+};
+
+static inline uint32_t get_be32(const uint8_t *p)
+{
+	return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 |
+	       (uint32_t)p[2] << 8 | (uint32_t)p[3];
+}
+
+static inline void put_be32(uint8_t *p, uint32_t v)
+{
+	p[0] = (uint8_t)(v >> 24);
+	p[1] = (uint8_t)(v >> 16);
+	p[2] = (uint8_t)(v >> 8);
+	p[3] = (uint8_t)v;
+}
+
+static inline uint64_t get_be64(const uint8_t *p)
+{
+	return (uint64_t)get_be32(p) << 32 | get_be32(p + 4);
+}
+
+static inline void put_be64(uint8_t *p, uint64_t v)
+{
+	put_be32(p, (uint32_t)(v >> 32));
+	put_be32(p + 4, (uint32_t)v);
+}
+
+static inline uint32_t ror32(uint32_t v, unsigned int n)
+{
+	return (v >> n) | (v << (32 - n));
+}
+
+static inline uint64_t ror64(uint64_t v, unsigned int n)
+{
+	return (v >> n) | (v << (64 - n));
+}
+
+/* one round of the compression, the variables are rotated by the caller */
+#define SHA2_ROUND(a, b, c, d, e, f, g, h, kw, S0, S1) \
+	do { \
+		t = h + S1(e) + (g ^ (e & (f ^ g))) + (kw); \
+		d += t; \
+		h = t + S0(a) + ((a & b) | (c & (a | b))); \
+	} while (0)
+
+/* eight rounds starting with round i */
+#define SHA2_ROUNDS8(s, k, w, i, S0, S1) \
+	do { \
+		SHA2_ROUND(s[0], s[1], s[2], s[3], s[4], s[5], s[6], s[7], \
+			   k[i] + w[i], S0, S1); \
+		SHA2_ROUND(s[7], s[0], s[1], s[2], s[3], s[4], s[5], s[6], \
+			   k[i + 1] + w[i + 1], S0, S1); \
+		SHA2_ROUND(s[6], s[7], s[0], s[1], s[2], s[3], s[4], s[5], \
+			   k[i + 2] + w[i + 2], S0, S1); \
+		SHA2_ROUND(s[5], s[6], s[7], s[0], s[1], s[2], s[3], s[4], \
+			   k[i + 3] + w[i + 3], S0, S1); \
+		SHA2_ROUND(s[4], s[5], s[6], s[7], s[0], s[1], s[2], s[3], \
+			   k[i + 4] + w[i + 4], S0, S1); \
+		SHA2_ROUND(s[3], s[4], s[5], s[6], s[7], s[0], s[1], s[2], \
+			   k[i + 5] + w[i + 5], S0, S1); \
+		SHA2_ROUND(s[2], s[3], s[4], s[5], s[6], s[7], s[0], s[1], \
+			   k[i + 6] + w[i + 6], S0, S1); \
+		SHA2_ROUND(s[1], s[2], s[3], s[4], s[5], s[6], s[7], s[0], \
+			   k[i + 7] + w[i + 7], S0, S1); \
+	} while (0)
+
+#define SHA256_S0(x) (ror32(x, 2) ^ ror32(x, 13) ^ ror32(x, 22))
+#define SHA256_S1(x) (ror32(x, 6) ^ ror32(x, 11) ^ ror32(x, 25))
+#define SHA256_s0(x) (ror32(x, 7) ^ ror32(x, 18) ^ ((x) >> 3))
+#define SHA256_s1(x) (ror32(x, 17) ^ ror32(x, 19) ^ ((x) >> 10))
+
+#define SHA512_S0(x) (ror64(x, 28) ^ ror64(x, 34) ^ ror64(x, 39))
+#define SHA512_S1(x) (ror64(x, 14) ^ ror64(x, 18) ^ ror64(x, 41))
+#define SHA512_s0(x) (ror64(x, 1) ^ ror64(x, 8) ^ ((x) >> 7))
+#define SHA512_s1(x) (ror64(x, 19) ^ ror64(x, 61) ^ ((x) >> 6))
+
+/** Compress SHA-256 blocks in software
+ *
+ * \param[in,out] h      Hash state
+ * \param[in]     p      Blocks
+ * \param[in]     n      Number of blocks
+ */
+static void sha256_soft(uint32_t h[8], const uint8_t *p, size_t n)
+{
+	uint32_t w[64], s[8], t;
+	unsigned int i;
+
+	for (; n; n--, p += SHA256_BLOCK_LEN) {
+		for (i = 0; i < 16; i++)
+			w[i] = get_be32(p + 4 * i);
+		for (i = 16; i < 64; i++)
+			w[i] = w[i - 16] + SHA256_s0(w[i - 15]) + w[i - 7] +
+			       SHA256_s1(w[i - 2]);
+
+		memcpy(s, h, sizeof(s));
+		for (i = 0; i < 64; i += 8)
+			SHA2_ROUNDS8(s, sha256_k, w, i, SHA256_S0, SHA256_S1);
+		for (i = 0; i < 8; i++)
+			h[i] += s[i];
+	}
+}
+
+/** Compress SHA-512 blocks in software
+ *
+ * \param[in,out] h      Hash state
+ * \param[in]     p      Blocks
+ * \param[in]     n      Number of blocks
+ */
+static void sha512_soft(uint64_t h[8], const uint8_t *p, size_t n)
+{
+	uint64_t w[80], s[8], t;
+	unsigned int i;
+
+	for (; n; n--, p += SHA512_BLOCK_LEN) {
+		for (i = 0; i < 16; i++)
+			w[i] = get_be64(p + 8 * i);
+		for (i = 16; i < 80; i++)
+			w[i] = w[i - 16] + SHA512_s0(w[i - 15]) + w[i - 7] +
+			       SHA512_s1(w[i - 2]);
+
+		memcpy(s, h, sizeof(s));
+		for (i = 0; i < 80; i += 8)
+			SHA2_ROUNDS8(s, sha512_k, w, i, SHA512_S0, SHA512_S1);
+		for (i = 0; i < 8; i++)
+			h[i] += s[i];
+	}
+}
+
+#if defined(SHA_HW_X86)
+/** Check for the SHA instructions
+ *
+ * \return true if SHA-NI, SSE4.1 and SSSE3 are supported
+ */
+static bool sha_hw_detect(void)
+{
+#if defined(_MSC_VER)
+	int info[4];
+
+	__cpuid(info, 0);
+	if (info[0] < 7)
+		return false;
+	__cpuid(info, 1);
+	if (!(info[2] & (1 << 19)) || !(info[2] & (1 << 9)))
+		return false;
+	__cpuidex(info, 7, 0);
+
+	return (info[1] & (1 << 29)) != 0;
+#else
+	unsigned int eax, ebx, ecx, edx;
+
+	if (__get_cpuid_max(0, NULL) < 7)
+		return false;
+	if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) ||
+	    !(ecx & bit_SSE4_1) || !(ecx & bit_SSSE3))
+		return false;
+	__cpuid_count(7, 0, eax, ebx, ecx, edx);
+
+	return (ebx & (1 << 29)) != 0;
+#endif
+}
+
+/* four rounds with the message words w, the state is kept as ABEF and CDGH */
+#define SHA256_HW_ROUNDS(w, i) \
+	do { \
+		msg = _mm_add_epi32(w, _mm_loadu_si128( \
+			(const __m128i *)&sha256_k[4 * (i)])); \
+		cdgh = _mm_sha256rnds2_epu32(cdgh, abef, msg); \
+		msg = _mm_shuffle_epi32(msg, 0x0e); \
+		abef = _mm_sha256rnds2_epu32(abef, cdgh, msg); \
+	} while (0)
+
+/* message words 4 * i to 4 * i + 3 from the preceding 16 words */
+#define SHA256_HW_SCHEDULE(w0, w1, w2, w3) \
+	(w0 = _mm_sha256msg2_epu32(_mm_add_epi32(_mm_sha256msg1_epu32(w0, w1), \
+						 _mm_alignr_epi8(w3, w2, 4)), \
+				   w3))
+
+/* four big endian message words */
+#define SHA256_HW_LOAD(p) \
+	_mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(p)), bswap)
+
+/** Compress SHA-256 blocks with SHA-NI */
+SHA_TARGET_HW
+static void sha256_hw(uint32_t h[8], const uint8_t *p, size_t n)
+{
+	const __m128i bswap = _mm_set_epi64x(0x0c0d0e0f08090a0bLL,
+					     0x0405060700010203LL);
+	__m128i abef, cdgh, abef_prev, cdgh_prev, msg, tmp, w0, w1, w2, w3;
+
+	/* reorder the state words for the SHA-256 instructions */
+	tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&h[0]), 0xb1);
+	cdgh = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&h[4]),
+				 0x1b);
+	abef = _mm_alignr_epi8(tmp, cdgh, 8);
+	cdgh = _mm_blend_epi16(cdgh, tmp, 0xf0);
+
+	for (; n; n--, p += SHA256_BLOCK_LEN) {
+		abef_prev = abef;
+		cdgh_prev = cdgh;
+
+		w0 = SHA256_HW_LOAD(p);
+		w1 = SHA256_HW_LOAD(p + 16);
+		w2 = SHA256_HW_LOAD(p + 32);
+		w3 = SHA256_HW_LOAD(p + 48);
+
+		SHA256_HW_ROUNDS(w0, 0);
+		SHA256_HW_ROUNDS(w1, 1);
+		SHA256_HW_ROUNDS(w2, 2);
+		SHA256_HW_ROUNDS(w3, 3);
+		SHA256_HW_ROUNDS(SHA256_HW_SCHEDULE(w0, w1, w2, w3), 4);
+		SHA256_HW_ROUNDS(SHA256_HW_SCHEDULE(w1, w2, w3, w0), 5);
+		SHA256_HW_ROUNDS(SHA256_HW_SCHEDULE(w2, w3, w0, w1), 6);
+		SHA256_HW_ROUNDS(SHA256_HW_SCHEDULE(w3, w0, w1, w2), 7);
+		SHA256_HW_ROUNDS(SHA256_HW_SCHEDULE(w0, w1, w2, w3), 8);
+		SHA256_HW_ROUNDS(SHA256_HW_SCHEDULE(w1, w2, w3, w0), 9);
+		SHA256_HW_ROUNDS(SHA256_HW_SCHEDULE(w2, w3, w0, w1), 10);
+		SHA256_HW_ROUNDS(SHA256_HW_SCHEDULE(w3, w0, w1, w2), 11);
+		SHA256_HW_ROUNDS(SHA256_HW_SCHEDULE(w0, w1, w2, w3), 12);
+		SHA256_HW_ROUNDS(SHA256_HW_SCHEDULE(w1, w2, w3, w0), 13);
+		SHA256_HW_ROUNDS(SHA256_HW_SCHEDULE(w2, w3, w0, w1), 14);
+		SHA256_HW_ROUNDS(SHA256_HW_SCHEDULE(w3, w0, w1, w2), 15);
+
+		abef = _mm_add_epi32(abef, abef_prev);
+		cdgh = _mm_add_epi32(cdgh, cdgh_prev);
+	}
+
+	tmp = _mm_shuffle_epi32(abef, 0x1b);
+	cdgh = _mm_shuffle_epi32(cdgh, 0xb1);
+	_mm_storeu_si128((__m128i *)&h[0], _mm_blend_epi16(tmp, cdgh, 0xf0));
+	_mm_storeu_si128((__m128i *)&h[4], _mm_alignr_epi8(cdgh, tmp, 8));
+}
+#elif defined(SHA_HW_ARM)
+static bool sha_hw_detect(void)
+{
+	return (getauxval(AT_HWCAP) & HWCAP_SHA2) != 0;
+}
+
+/* four rounds with the message words w */
+#define SHA256_HW_ROUNDS(w, i) \
+	do { \
+		msg = vaddq_u32(w, vld1q_u32(&sha256_k[4 * (i)])); \
+		tmp = abcd; \
+		abcd = vsha256hq_u32(abcd, efgh, msg); \
+		efgh = vsha256h2q_u32(efgh, tmp, msg); \
+	} while (0)
+
+/* message words 4 * i to 4 * i + 3 from the preceding 16 words */
+#define SHA256_HW_SCHEDULE(w0, w1, w2, w3) \
+	(w0 = vsha256su1q_u32(vsha256su0q_u32(w0, w1), w2, w3))
+
+/** Compress SHA-256 blocks with the ARMv8 SHA instructions */
+static void sha256_hw(uint32_t h[8], const uint8_t *p, size_t n)
+{
+	uint32x4_t abcd, efgh, abcd_prev, efgh_prev, msg, tmp, w0, w1, w2, w3;
+
+	abcd = vld1q_u32(&h[0]);
+	efgh = vld1q_u32(&h[4]);
+
+	for (; n; n--, p += SHA256_BLOCK_LEN) {
+		abcd_prev = abcd;
+		efgh_prev = efgh;
+
+		w0 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(p)));
+		w1 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(p + 16)));
+		w2 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(p + 32)));
+		w3 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(p + 48)));
+
+		SHA256_HW_ROUNDS(w0, 0);
+		SHA256_HW_ROUNDS(w1, 1);
+		SHA256_HW_ROUNDS(w2, 2);
+		SHA256_HW_ROUNDS(w3, 3);
+		SHA256_HW_ROUNDS(SHA256_HW_SCHEDULE(w0, w1, w2, w3), 4);
+		SHA256_HW_ROUNDS(SHA256_HW_SCHEDULE(w1, w2, w3, w0), 5);
+		SHA256_HW_ROUNDS(SHA256_HW_SCHEDULE(w2, w3, w0, w1), 6);
+		SHA256_HW_ROUNDS(SHA256_HW_SCHEDULE(w3, w0, w1, w2), 7);
+		SHA256_HW_ROUNDS(SHA256_HW_SCHEDULE(w0, w1, w2, w3), 8);
+		SHA256_HW_ROUNDS(SHA256_HW_SCHEDULE(w1, w2, w3, w0), 9);
+		SHA256_HW_ROUNDS(SHA256_HW_SCHEDULE(w2, w3, w0, w1), 10);
+		SHA256_HW_ROUNDS(SHA256_HW_SCHEDULE(w3, w0, w1, w2), 11);
+		SHA256_HW_ROUNDS(SHA256_HW_SCHEDULE(w0, w1, w2, w3), 12);
+		SHA256_HW_ROUNDS(SHA256_HW_SCHEDULE(w1, w2, w3, w0), 13);
+		SHA256_HW_ROUNDS(SHA256_HW_SCHEDULE(w2, w3, w0, w1), 14);
+		SHA256_HW_ROUNDS(SHA256_HW_SCHEDULE(w3, w0, w1, w2), 15);
+
+		abcd = vaddq_u32(abcd, abcd_prev);
+		efgh = vaddq_u32(efgh, efgh_prev);
+	}
+
+	vst1q_u32(&h[0], abcd);
+	vst1q_u32(&h[4], efgh);
+}
+#endif
+
+#if SHA_HW == 1
+/** Result of sha_hw_detect(), -1 before the first check */
+static int sha_hw_state = -1;
+
+/** Check once if the SHA instructions can be used
+ *
+ * \return true if sha256_hw() can be used
+ */
+static bool sha_hw_usable(void)
+{
+	int state;
+
+#if defined(__GNUC__)
+	state = __atomic_load_n(&sha_hw_state, __ATOMIC_RELAXED);
+	if (state < 0) {
+		state = sha_hw_detect() ? 1 : 0;
+		__atomic_store_n(&sha_hw_state, state, __ATOMIC_RELAXED);
+	}
+#else
+	/* concurrent first calls store the same value */
+	state = sha_hw_state;
+	if (state < 0) {
+		state = sha_hw_detect() ? 1 : 0;
+		sha_hw_state = state;
+	}
+#endif
+
+	return state == 1;
+}
+#endif
+
+/** Block size of the hash in use */
+static inline size_t sha2_block_len(const struct sha2_ctx *ctx)
+{
+	return ctx->sha512 ? SHA512_BLOCK_LEN : SHA256_BLOCK_LEN;
+}
+
+/** Compress complete blocks */
+static void sha2_blocks(struct sha2_ctx *ctx, const uint8_t *p, size_t n)
+{
+	if (ctx->sha512) {
+		sha512_soft(ctx->h.h512, p, n);
+		return;
+	}
+#if SHA_HW == 1
+	if (sha_hw_usable()) {
+		sha256_hw(ctx->h.h256, p, n);
+		return;
+	}
+#endif
+	sha256_soft(ctx->h.h256, p, n);
+}
+
+/** Start a hash from a state after len bytes
+ *
+ * \param[out] ctx       Hash calculation
+ * \param[in]  sha512    SHA-512 instead of SHA-256
+ * \param[in]  h         Hash state, NULL for the initial hash value
+ * \param[in]  len       Bytes hashed for the state, a multiple of the block
+ *                       size
+ */
+static void sha2_init(struct sha2_ctx *ctx, bool sha512,
+		      const union pa_sha2_state *h, uint64_t len)
+{
+	ctx->sha512 = sha512;
+	if (h)
+		ctx->h = *h;
+	else if (sha512)
+		memcpy(ctx->h.h512, sha512_iv, sizeof(sha512_iv));
+	else
+		memcpy(ctx->h.h256, sha256_iv, sizeof(sha256_iv));
+	ctx->buf_len = 0;
+	ctx->len = len;
+}
+
+/** Hash data */
+static void sha2_update(struct sha2_ctx *ctx, const uint8_t *data, size_t len)
+{
+	size_t block_len = sha2_block_len(ctx);
+	size_t part;
+
+	ctx->len += len;
+
+	if (ctx->buf_len) {
+		part = block_len - ctx->buf_len;
+		if (part > len)
+			part = len;
+		memcpy(ctx->buf + ctx->buf_len, data, part);
+		ctx->buf_len += part;
+		data += part;
+		len -= part;
+		if (ctx->buf_len < block_len)
+			return;
+		sha2_blocks(ctx, ctx->buf, 1);
+		ctx->buf_len = 0;
+	}
+
+	if (len >= block_len) {
+		sha2_blocks(ctx, data, len / block_len);
+		data += len - len % block_len;
+		len %= block_len;
+	}
+
+	memcpy(ctx->buf, data, len);
+	ctx->buf_len = len;
+}
+
+/** Pad the last block and write the hash
+ *
+ * \param[in,out] ctx     Hash calculation
+ * \param[out]    digest  Hash
+ */
+static void sha2_final(struct sha2_ctx *ctx, uint8_t *digest)
+{
+	size_t block_len = sha2_block_len(ctx);
+	/* 64 or 128 bit message length in bits */
+	size_t len_size = ctx->sha512 ? 16 : 8;
+	unsigned int i;
+
+	ctx->buf[ctx->buf_len++] = 0x80;
+	if (ctx->buf_len > block_len - len_size) {
+		memset(ctx->buf + ctx->buf_len, 0, block_len - ctx->buf_len);
+		sha2_blocks(ctx, ctx->buf, 1);
+		ctx->buf_len = 0;
+	}
+	memset(ctx->buf + ctx->buf_len, 0, block_len - 8 - ctx->buf_len);
+	if (ctx->sha512)
+		put_be32(ctx->buf + block_len - 12,
+			 (uint32_t)(ctx->len >> 61));
+	put_be64(ctx->buf + block_len - 8, ctx->len << 3);
+	sha2_blocks(ctx, ctx->buf, 1);
+
+	for (i = 0; i < 8; i++) {
+		if (ctx->sha512)
+			put_be64(digest + 8 * i, ctx->h.h512[i]);
+		else
+			put_be32(digest + 4 * i, ctx->h.h256[i]);
+	}
+}
+
+size_t pa_hmac_len(enum pon_adapter_enh_sec_ctrl_enc alg)
+{
+	switch (alg) {
+	case ENC_HMAC_SHA_256:
+		return PA_SHA256_LEN;
+	case ENC_HMAC_SHA_512:
+		return PA_SHA512_LEN;
+	default:
+		return 0;
+	}
+}
+
+enum pon_adapter_errno pa_sha2(enum pon_adapter_enh_sec_ctrl_enc alg,
+			       const uint8_t *data,
+			       size_t len,
+			       uint8_t *digest)
+{
+	struct sha2_ctx ctx;
+
+	if ((!data && len) || !digest)
+		return PON_ADAPTER_ERR_PTR_INVALID;
+	if (!pa_hmac_len(alg))
+		return PON_ADAPTER_ERR_NOT_SUPPORTED;
+
+	sha2_init(&ctx, alg == ENC_HMAC_SHA_512, NULL, 0);
+	if (len)
+		sha2_update(&ctx, data, len);
+	sha2_final(&ctx, digest);
+
+	return PON_ADAPTER_SUCCESS;
+}
+
+enum pon_adapter_errno pa_hmac_key_set(struct pa_hmac_key *key,
+				       enum pon_adapter_enh_sec_ctrl_enc alg,
+				       const uint8_t *k,
+				       size_t k_len)
+{
+	uint8_t pad[SHA512_BLOCK_LEN] = { 0 };
+	struct sha2_ctx ctx;
+	size_t block_len;
+	unsigned int i;
+
+	if (!key || (!k && k_len))
+		return PON_ADAPTER_ERR_PTR_INVALID;
+	if (!pa_hmac_len(alg))
+		return PON_ADAPTER_ERR_NOT_SUPPORTED;
+
+	sha2_init(&ctx, alg == ENC_HMAC_SHA_512, NULL, 0);
+	block_len = sha2_block_len(&ctx);
+
+	if (k_len > block_len)
+		(void)pa_sha2(alg, k, k_len, pad);
+	else if (k_len)
+		memcpy(pad, k, k_len);
+
+	/* hash states after one block of key XOR ipad and key XOR opad */
+	for (i = 0; i < block_len; i++)
+		pad[i] ^= HMAC_IPAD;
+	sha2_blocks(&ctx, pad, 1);
+	key->inner = ctx.h;
+
+	sha2_init(&ctx, alg == ENC_HMAC_SHA_512, NULL, 0);
+	for (i = 0; i < block_len; i++)
+		pad[i] ^= HMAC_IPAD ^ HMAC_OPAD;
+	sha2_blocks(&ctx, pad, 1);
+	key->outer = ctx.h;
+
+	memset(pad, 0, sizeof(pad));
+	key->alg = alg;
+	key->len = pa_hmac_len(alg);
+	key->valid = true;
+
+	return PON_ADAPTER_SUCCESS;
+}
+
+enum pon_adapter_errno pa_hmac_parts(const struct pa_hmac_key *key,
+				     const uint8_t *parts[],
+				     const size_t lens[],
+				     size_t n,
+				     uint8_t *mac)
+{
+	uint8_t inner[PA_HMAC_MAX_LEN];
+	struct sha2_ctx ctx;
+	size_t block_len, i;
+	bool sha512;
+
+	if (!key || (n && (!parts || !lens)) || !mac)
+		return PON_ADAPTER_ERR_PTR_INVALID;
+	for (i = 0; i < n; i++) {
+		if (!parts[i] && lens[i])
+			return PON_ADAPTER_ERR_PTR_INVALID;
+	}
+	if (!key->valid)
+		return PON_ADAPTER_ERR_NOT_AVAIL;
+
+	sha512 = key->alg == ENC_HMAC_SHA_512;
+	block_len = sha512 ? SHA512_BLOCK_LEN : SHA256_BLOCK_LEN;
+
+	sha2_init(&ctx, sha512, &key->inner, block_len);
+	for (i = 0; i < n; i++) {
+		if (lens[i])
+			sha2_update(&ctx, parts[i], lens[i]);
+	}
+	sha2_final(&ctx, inner);
+
+	sha2_init(&ctx, sha512, &key->outer, block_len);
+	sha2_update(&ctx, inner, key->len);
+	sha2_final(&ctx, mac);
+
+	return PON_ADAPTER_SUCCESS;
+}
+
+enum pon_adapter_errno pa_hmac(const struct pa_hmac_key *key,
+			       const uint8_t *data,
+			       size_t len,
+			       uint8_t *mac)
+{
+	const uint8_t *parts[1] = { data };
+	const size_t lens[1] = { len };
+
+	return pa_hmac_parts(key, parts, lens, 1, mac);
+}
@@ -9,9 +9,61 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "pon_adapter_mapper.h"
 #include "pon_adapter_debug.h"
 
+/* Concurrent readers need the GCC atomic builtins and POSIX threads */
+#if defined(__GNUC__) && !defined(_WIN32)
+#define MAPPER_CONCURRENT 1
+#include <pthread.h>
+#include <sched.h>
+#else
+#define MAPPER_CONCURRENT 0
+#endif
+
+/** Maximum key range for which a direct-indexed table is used.
+ *  Each key type of such a mapper costs 4 bytes per key of its range.
+ */
+#ifndef PA_MAPPER_DIRECT_RANGE_MAX
+#define PA_MAPPER_DIRECT_RANGE_MAX 4096
+#endif
+
+/** Maximum key range for which a bitmap of used keys is kept.
+ *  The bitmap costs one bit per key of the range plus the summary levels
+ *  and is allocated with the mapper, so at most 8 KiB per key type.
+ */
+#ifndef PA_MAPPER_BITMAP_RANGE_MAX
+#define PA_MAPPER_BITMAP_RANGE_MAX (1U << 16)
+#endif
+
+#if PA_MAPPER_DIRECT_RANGE_MAX > PA_MAPPER_BITMAP_RANGE_MAX
+#error "Direct-indexed mappers need a used key bitmap"
+#endif
+
+/** Initial number of hash table slots (power of 2) */
+#define MAPPER_HASH_SLOTS_MIN 16
+
+/** Maximum number of bitmap levels (64^6 covers the 32 bit key space) */
+#define MAPPER_BITMAP_LEVELS 6
+
+/** Hierarchical bitmap of used keys
+ *
+ * \note Level 0 holds one bit per key of the range, every bit of a higher
+ *       level is set if the corresponding word of the level below is
+ *       completely used. The top level consists of a single word.
+ */
+struct mapper_bitmap {
+	/** Number of levels, 0 if no bitmap is kept */
+	uint32_t levels;
+	/** Number of keys */
+	uint32_t range;
+	/** Number of words per level */
+	uint32_t words[MAPPER_BITMAP_LEVELS];
+	/** Words per level */
+	uint64_t *level[MAPPER_BITMAP_LEVELS];
+};
+
 /** ID to Index (and Index to ID) mapping list definition
  *
  * \note List is sorted by ID and Index growth
@@ -23,16 +75,686 @@ struct mapper_map_list {
 	 * with bigger key value (ID or Index)
 	 */
 	struct mapper_map_list *next[KEY_TYPE_NUM];
+	/** Array of pointers to the previous list node
+	 * with smaller key value (ID or Index)
+	 */
+	struct mapper_map_list *prev[KEY_TYPE_NUM];
+};
+
+/** Default number of list nodes per arena chunk */
+#define MAPPER_ARENA_CHUNK_NODES 256
+
+/** Arena chunk, a block of list nodes */
+struct mapper_arena_chunk {
+	/** Next chunk */
+	struct mapper_arena_chunk *next;
+	/** Number of nodes */
+	uint32_t nodes;
+	/** Nodes */
+	struct mapper_map_list node[];
+};
+
+/** List node arena shared by the mappers of a set
+ *
+ * \note Chunks are only released by \ref mapper_arena_free. Resetting the
+ *       arena makes all chunks available again without touching the nodes.
+ */
+struct mapper_arena {
+	/** Number of nodes per chunk */
+	uint32_t chunk_nodes;
+	/** First chunk */
+	struct mapper_arena_chunk *head;
+	/** Chunk nodes are currently taken from */
+	struct mapper_arena_chunk *cur;
+	/** Number of nodes taken from the current chunk */
+	uint32_t cur_used;
+	/** Released nodes, linked by next[KEY_TYPE_ID] */
+	struct mapper_map_list *free_list;
+	/** Number of released nodes */
+	uint32_t free_num;
+};
+
+/** Hash table slot */
+struct mapper_hash_slot {
+	/** Key */
+	uint32_t key;
+	/** Mapped key */
+	uint32_t val;
+};
+
+/** Hash table storage, the geometry is kept together with the slots */
+struct mapper_hash_table {
+	/** Number of slots minus one (number of slots is a power of 2) */
+	uint32_t mask;
+	/** Shift to derive the home slot from the hashed key */
+	uint32_t shift;
+	/** Probe distance plus one per slot, zero marks an empty slot.
+	 *  Located behind the slot array.
+	 */
+	uint8_t *dist;
+	/** Slot array */
+	struct mapper_hash_slot slot[];
+};
+
+/** Cursor states (\ref mapper_cursor.state) */
+enum mapper_cursor_state {
+	/** No mapping returned yet */
+	MAPPER_CURSOR_START,
+	/** Last mapping returned is stored in the cursor */
+	MAPPER_CURSOR_RUN,
+	/** All mappings returned */
+	MAPPER_CURSOR_END
+};
+
+/** Maximum number of replaced tables, the table size doubles each time */
+#define MAPPER_HASH_RETIRED_MAX 32
+
+/** Open addressing hash table with linear probing and robin hood
+ *  insertion. Entries are moved back on removal, so no tombstones are used.
+ */
+struct mapper_hash {
+	/** Current table */
+	struct mapper_hash_table *tbl;
+	/** Number of used slots */
+	uint32_t used;
+	/** Keep replaced tables until the hash is released, because
+	 *  concurrent readers might still access them
+	 */
+	bool retire;
+	/** Number of replaced tables */
+	uint32_t retired_num;
+	/** Replaced tables */
+	struct mapper_hash_table *retired[MAPPER_HASH_RETIRED_MAX];
+};
+
+/** Mapper backend operations
+ *
+ * \note All keys handed over to the backend are already verified against
+ *       the key range of the mapper entry.
+ */
+struct mapper_backend {
+	/** Backend name */
+	const char *name;
+
+	/** Allocate backend storage
+	 *
+	 * \param[in] m        Pointer to mapper
+	 */
+	enum pon_adapter_errno (*init)(struct mapper *m);
+
+	/** Release backend storage (all mappings are already removed),
+	 *  optional
+	 *
+	 * \param[in] m        Pointer to mapper
+	 */
+	void (*exit)(struct mapper *m);
+
+	/** Find the mapping of a key
+	 *
+	 * \param[in]     m        Pointer to mapper
+	 * \param[in]     key_type Type of the key to search for
+	 * \param[in,out] key      Key array, key[key_type] is searched for,
+	 *                         all other keys are returned
+	 * \param[out]    steps    Number of visited nodes or slots, may be
+	 *                         NULL
+	 *
+	 * \return
+	 *    - PON_ADAPTER_SUCCESS       Mapping was found
+	 *    - PON_ADAPTER_ERR_NOT_FOUND Key is not mapped
+	 */
+	enum pon_adapter_errno (*find)(const struct mapper *m,
+				       enum mapper_key_type key_type,
+				       uint32_t key[KEY_TYPE_NUM],
+				       uint32_t *steps);
+
+	/** Find the mapping of a key and its node, optional (only for
+	 *  backends with nodes which stay in place until removal)
+	 *
+	 * \param[in]     m        Pointer to mapper
+	 * \param[in]     key_type Type of the key to search for
+	 * \param[in,out] key      Key array, key[key_type] is searched for,
+	 *                         all other keys are returned
+	 * \param[out]    node     Node of the mapping
+	 *
+	 * \return
+	 *    - PON_ADAPTER_SUCCESS       Mapping was found
+	 *    - PON_ADAPTER_ERR_NOT_FOUND Key is not mapped
+	 */
+	enum pon_adapter_errno (*find_node)(const struct mapper *m,
+					    enum mapper_key_type key_type,
+					    uint32_t key[KEY_TYPE_NUM],
+					    void **node);
+
+	/** Remove a mapping by its node, required if find_node is set
+	 *
+	 * \param[in] m        Pointer to mapper
+	 * \param[in] node     Node of the mapping, see find_node
+	 */
+	void (*remove_node)(struct mapper *m, void *node);
+
+	/** Find the mappings of several keys, optional
+	 *
+	 * \param[in]  m          Pointer to mapper
+	 * \param[in]  key_type   Type of the keys to search for
+	 * \param[in]  keys       Keys to search for
+	 * \param[in]  num        Number of keys
+	 * \param[out] other_keys Mapped keys of the other type
+	 * \param[in,out] steps   Sum and maximum of the visited nodes per
+	 *                        key, updated for every searched key
+	 *
+	 * \return
+	 *    - PON_ADAPTER_SUCCESS       All mappings were found
+	 *    - PON_ADAPTER_ERR_NOT_FOUND A key is not mapped
+	 */
+	enum pon_adapter_errno (*find_batch)(const struct mapper *m,
+					     enum mapper_key_type key_type,
+					     const uint32_t *keys,
+					     uint32_t num,
+					     uint32_t *other_keys,
+					     uint32_t steps[2]);
+
+	/** Add a mapping
+	 *
+	 * \param[in]     m          Pointer to mapper
+	 * \param[in]     alloc_type Type of the key to allocate (lowest free
+	 *                           key), KEY_TYPE_NUM to allocate none
+	 * \param[in,out] key        Key array, the allocated key is returned
+	 *
+	 * \return
+	 *    - PON_ADAPTER_SUCCESS       Mapping was added
+	 *    - PON_ADAPTER_ERR_NOT_FOUND No free key available
+	 *    - PON_ADAPTER_ERR_NO_MEMORY Not enough memory
+	 *    - PON_ADAPTER_ERROR         A key is already mapped
+	 */
+	enum pon_adapter_errno (*add)(struct mapper *m,
+				      enum mapper_key_type alloc_type,
+				      uint32_t key[KEY_TYPE_NUM]);
+
+	/** Remove a mapping
+	 *
+	 * \param[in]     m        Pointer to mapper
+	 * \param[in]     key_type Type of the key to remove
+	 * \param[in,out] key      Key array, key[key_type] is removed,
+	 *                         all other keys are returned
+	 *
+	 * \return
+	 *    - PON_ADAPTER_SUCCESS       Mapping was removed
+	 *    - PON_ADAPTER_ERR_NOT_FOUND Key is not mapped
+	 *    - PON_ADAPTER_ERROR         Removal failed
+	 */
+	enum pon_adapter_errno (*remove)(struct mapper *m,
+					 enum mapper_key_type key_type,
+					 uint32_t key[KEY_TYPE_NUM]);
+
+	/** Remove all mappings
+	 *
+	 * \param[in] m        Pointer to mapper
+	 * \param[in] release  Release every node, false if the node arena of
+	 *                     the mapper is reset afterwards
+	 */
+	enum pon_adapter_errno (*cleanup)(struct mapper *m, bool release);
+
+	/** Retrieve all mapped keys of a type in ascending order
+	 *
+	 * \param[in]  m        Pointer to mapper
+	 * \param[in]  key_type Key Type
+	 * \param[out] keys     Key array with room for all mapped keys
+	 */
+	void (*keys_get)(const struct mapper *m,
+			 enum mapper_key_type key_type,
+			 uint32_t *keys);
+
+	/** Find the mapping with the lowest ID in [from, c->hi]
+	 *
+	 * \param[in]     m        Pointer to mapper
+	 * \param[in,out] c        Cursor, the backend position is updated
+	 * \param[in]     from     Lowest ID to return
+	 * \param[out]    key      Key array of the found mapping
+	 *
+	 * \return
+	 *    - PON_ADAPTER_SUCCESS       Mapping was found
+	 *    - PON_ADAPTER_ERR_NOT_FOUND No more mapping in the range
+	 */
+	enum pon_adapter_errno (*next)(struct mapper *m,
+				       struct mapper_cursor *c,
+				       uint32_t from,
+				       uint32_t key[KEY_TYPE_NUM]);
+};
+
+/** Mapper statistics counters, see \ref mapper_stats */
+struct mapper_counters {
+	/** Highest number of mappings */
+	uint32_t peak;
+	/** Failed key allocations */
+	uint32_t alloc_fail;
+	/** Number of created mappings */
+	uint64_t map;
+	/** Number of removed mappings */
+	uint64_t unmap;
+	/** Number of lookups, without the lock-free lookups of concurrent
+	 *  mappers
+	 */
+	uint64_t lookup;
+	/** Sum of the search steps of all lookups */
+	uint64_t search_steps;
+	/** Maximum search steps of one lookup */
+	uint32_t search_max;
 };
 
 /** Mapper definition */
 struct mapper {
 	/** m_entry pointer */
 	const struct mapper_entry *m_entry;
-	/** List heads array*/
+	/** Backend operations */
+	const struct mapper_backend *ops;
+	/** List node arena, NULL to allocate nodes from the heap */
+	struct mapper_arena *arena;
+	/** Mapper and tables are located in caller provided storage,
+	 *  see \ref pa_mapper_init_static
+	 */
+	bool fixed;
+	/** Lock-free readers, see \ref MAPPER_FLAG_CONCURRENT */
+	bool concurrent;
+#if MAPPER_CONCURRENT == 1
+	/** Serializes the writers in concurrent mode */
+	pthread_mutex_t lock;
+	/** Write sequence counter, odd while a write is in progress */
+	uint32_t seq;
+#endif
+	/** Number of mapped items */
+	uint32_t count;
+	/** Statistics counters */
+	struct mapper_counters cnt;
+	/** List heads array (list backend) */
 	struct mapper_map_list *list_head[KEY_TYPE_NUM];
+	/** Position of the last modification per list (list backend),
+	 *  searches for larger keys start there. Ascending key sequences,
+	 *  such as sorted batches, are handled in a single list pass.
+	 */
+	struct mapper_map_list *finger[KEY_TYPE_NUM];
+	/** Direct-indexed tables (direct backend), one per key type.
+	 *  Each element holds the offset of the mapped other key plus one,
+	 *  zero marks an unmapped key.
+	 */
+	uint32_t *direct[KEY_TYPE_NUM];
+	/** Hash tables (hash backend), one per key type */
+	struct mapper_hash hash[KEY_TYPE_NUM];
+	/** Sorted IDs for cursors (hash backend without ID bitmap) */
+	uint32_t *sorted;
+	/** Number of IDs in \ref sorted */
+	uint32_t sorted_num;
+	/** Value of \ref gen when \ref sorted was filled */
+	uint32_t sorted_gen;
+	/** Used key bitmaps, one per key type */
+	struct mapper_bitmap used[KEY_TYPE_NUM];
+	/** Last index per ID, see \ref MAPPER_FLAG_STICKY */
+	struct mapper_hash sticky;
+	/** Modification counter, used to validate cursor positions */
+	uint32_t gen;
 };
 
+/* the static storage sizes of pon_adapter_mapper.h follow this layout */
+typedef char mapper_static_hash_check
+	[sizeof(struct mapper_hash) <=
+	 PA_MAPPER_STATIC_HASH_WORDS * sizeof(uint64_t) ? 1 : -1];
+typedef char mapper_static_bitmap_check
+	[sizeof(struct mapper_bitmap) <=
+	 PA_MAPPER_STATIC_BITMAP_WORDS * sizeof(uint64_t) ? 1 : -1];
+#if MAPPER_CONCURRENT == 1
+typedef char mapper_static_lock_check
+	[sizeof(pthread_mutex_t) <=
+	 PA_MAPPER_STATIC_LOCK_WORDS * sizeof(uint64_t) ? 1 : -1];
+#endif
+typedef char mapper_static_hdr_check
+	[sizeof(struct mapper) <=
+	 PA_MAPPER_STATIC_HDR_WORDS * sizeof(uint64_t) ? 1 : -1];
+
+/** Count trailing zero bits of a non-zero word
+ *
+ * \param[in] w        Word
+ *
+ * \return Position of the lowest set bit
+ */
+static inline uint32_t bit_ctz64(uint64_t w)
+{
+#if defined(__GNUC__)
+	return (uint32_t)__builtin_ctzll(w);
+#else
+	uint32_t n = 0;
+
+	if (!(w & 0xffffffffULL)) {
+		w >>= 32;
+		n += 32;
+	}
+	while (!(w & 1)) {
+		w >>= 1;
+		n++;
+	}
+
+	return n;
+#endif
+}
+
+/** Set up the geometry of a used key bitmap
+ *
+ * \param[in] b        Bitmap
+ * \param[in] range    Number of keys
+ *
+ * \return Number of words of all levels
+ */
+static uint32_t bitmap_size(struct mapper_bitmap *b, uint32_t range)
+{
+	uint32_t n = range, total = 0;
+
+	b->range = range;
+	b->levels = 0;
+	do {
+		n = (n + 63) / 64;
+		b->words[b->levels++] = n;
+		total += n;
+	} while (n > 1);
+
+	return total;
+}
+
+/** Assign the words of a used key bitmap
+ *
+ * \param[in] b        Bitmap, set up by \ref bitmap_size
+ * \param[in] words    Cleared words of all levels
+ */
+static void bitmap_attach(struct mapper_bitmap *b, uint64_t *words)
+{
+	uint32_t lvl;
+
+	b->level[0] = words;
+	for (lvl = 1; lvl < b->levels; lvl++)
+		b->level[lvl] = b->level[lvl - 1] + b->words[lvl - 1];
+}
+
+/** Allocate a used key bitmap, all keys are free afterwards
+ *
+ * \param[in] b        Bitmap
+ * \param[in] range    Number of keys
+ *
+ * \return
+ *    - PON_ADAPTER_SUCCESS       Bitmap was allocated
+ *    - PON_ADAPTER_ERR_NO_MEMORY Not enough memory
+ */
+static enum pon_adapter_errno bitmap_init(struct mapper_bitmap *b,
+					  uint32_t range)
+{
+	uint64_t *words;
+
+	words = calloc(bitmap_size(b, range), sizeof(uint64_t));
+	if (!words) {
+		b->levels = 0;
+		return PON_ADAPTER_ERR_NO_MEMORY;
+	}
+
+	bitmap_attach(b, words);
+
+	return PON_ADAPTER_SUCCESS;
+}
+
+/** Release a used key bitmap
+ *
+ * \param[in] b        Bitmap
+ */
+static void bitmap_exit(struct mapper_bitmap *b)
+{
+	if (b->levels)
+		free(b->level[0]);
+	b->levels = 0;
+}
+
+/** Mark all keys of a bitmap as free
+ *
+ * \param[in] b        Bitmap
+ */
+static void bitmap_clear(struct mapper_bitmap *b)
+{
+	uint32_t lvl, total = 0;
+
+	for (lvl = 0; lvl < b->levels; lvl++)
+		total += b->words[lvl];
+
+	if (total)
+		memset(b->level[0], 0, total * sizeof(uint64_t));
+}
+
+/** Mark a key as used
+ *
+ * \param[in] b        Bitmap
+ * \param[in] pos      Key offset
+ */
+static void bitmap_set(struct mapper_bitmap *b, uint32_t pos)
+{
+	uint64_t *w;
+	uint32_t lvl;
+
+	for (lvl = 0; lvl < b->levels; lvl++) {
+		w = &b->level[lvl][pos / 64];
+		*w |= 1ULL << (pos % 64);
+		if (*w != ~0ULL)
+			break;
+		pos /= 64;
+	}
+}
+
+/** Mark a key as free
+ *
+ * \param[in] b        Bitmap
+ * \param[in] pos      Key offset
+ */
+static void bitmap_clr(struct mapper_bitmap *b, uint32_t pos)
+{
+	uint64_t *w;
+	uint32_t lvl;
+	bool full;
+
+	for (lvl = 0; lvl < b->levels; lvl++) {
+		w = &b->level[lvl][pos / 64];
+		full = *w == ~0ULL;
+		*w &= ~(1ULL << (pos % 64));
+		if (!full)
+			break;
+		pos /= 64;
+	}
+}
+
+/** Check if a key is used
+ *
+ * \param[in] b        Bitmap
+ * \param[in] pos      Key offset
+ *
+ * \return true if the key is used
+ */
+static inline bool bitmap_test(const struct mapper_bitmap *b, uint32_t pos)
+{
+	return (b->level[0][pos / 64] >> (pos % 64)) & 1;
+}
+
+/** Find the lowest free key
+ *
+ * \param[in]  b        Bitmap
+ * \param[out] pos      Offset of the lowest free key
+ *
+ * \return
+ *    - PON_ADAPTER_SUCCESS       Free key was found
+ *    - PON_ADAPTER_ERR_NOT_FOUND All keys are used
+ */
+static enum pon_adapter_errno bitmap_free_find(const struct mapper_bitmap *b,
+					       uint32_t *pos)
+{
+	uint64_t w;
+	uint32_t lvl = b->levels, i = 0;
+
+	while (lvl--) {
+		w = ~b->level[lvl][i];
+		if (!w)
+			return PON_ADAPTER_ERR_NOT_FOUND;
+		i = i * 64 + bit_ctz64(w);
+		/* bits beyond the end of the level below are never set */
+		if (i >= (lvl ? b->words[lvl - 1] : b->range))
+			return PON_ADAPTER_ERR_NOT_FOUND;
+	}
+
+	*pos = i;
+
+	return PON_ADAPTER_SUCCESS;
+}
+
+/** Find the lowest used key at or above an offset
+ *
+ * \param[in]  b        Bitmap
+ * \param[in]  from     Offset to start at
+ * \param[out] pos      Offset of the found key
+ *
+ * \return
+ *    - PON_ADAPTER_SUCCESS       Used key was found
+ *    - PON_ADAPTER_ERR_NOT_FOUND No key at or above \p from is used
+ */
+static enum pon_adapter_errno bitmap_used_find(const struct mapper_bitmap *b,
+					       uint32_t from,
+					       uint32_t *pos)
+{
+	uint32_t i = from / 64;
+	uint64_t w;
+
+	if (from >= b->range)
+		return PON_ADAPTER_ERR_NOT_FOUND;
+
+	/* the upper levels mark full words only, scan the lowest level */
+	w = b->level[0][i] & (~0ULL << (from % 64));
+	while (!w) {
+		if (++i >= b->words[0])
+			return PON_ADAPTER_ERR_NOT_FOUND;
+		w = b->level[0][i];
+	}
+
+	*pos = i * 64 + bit_ctz64(w);
+
+	return PON_ADAPTER_SUCCESS;
+}
+
+/** Find the lowest free key at or above an offset
+ *
+ * \param[in]  b        Bitmap
+ * \param[in]  from     Offset to start at
+ * \param[out] pos      Offset of the found key
+ *
+ * \return
+ *    - PON_ADAPTER_SUCCESS       Free key was found
+ *    - PON_ADAPTER_ERR_NOT_FOUND All keys at or above \p from are used
+ */
+static enum pon_adapter_errno bitmap_free_next(const struct mapper_bitmap *b,
+					       uint32_t from,
+					       uint32_t *pos)
+{
+	uint32_t i = from / 64;
+	uint64_t w;
+
+	if (from >= b->range)
+		return PON_ADAPTER_ERR_NOT_FOUND;
+
+	w = ~b->level[0][i] & (~0ULL << (from % 64));
+	while (!w) {
+		if (++i >= b->words[0])
+			return PON_ADAPTER_ERR_NOT_FOUND;
+		/* the second level marks full words, skip up to 64 at once */
+		if (b->levels > 1) {
+			w = ~b->level[1][i / 64] & (~0ULL << (i % 64));
+			if (!w) {
+				i |= 63;
+				continue;
+			}
+			i = (i & ~63U) + bit_ctz64(w);
+			if (i >= b->words[0])
+				return PON_ADAPTER_ERR_NOT_FOUND;
+		}
+		w = ~b->level[0][i];
+	}
+
+	*pos = i * 64 + bit_ctz64(w);
+
+	return *pos < b->range ? PON_ADAPTER_SUCCESS :
+				 PON_ADAPTER_ERR_NOT_FOUND;
+}
+
+/** Find the lowest run of free keys which starts at an aligned key
+ *
+ * Every step skips a whole used or too short free run, so the search time
+ * depends on the number of fragments rather than on the number of keys.
+ *
+ * \param[in]  b        Bitmap
+ * \param[in]  min      Key at offset zero
+ * \param[in]  num      Number of keys
+ * \param[in]  align    Alignment of the first key
+ * \param[out] pos      Offset of the first key
+ *
+ * \return
+ *    - PON_ADAPTER_SUCCESS       Free run was found
+ *    - PON_ADAPTER_ERR_NOT_FOUND No aligned run of free keys is long enough
+ */
+static enum pon_adapter_errno bitmap_run_find(const struct mapper_bitmap *b,
+					      uint32_t min,
+					      uint32_t num,
+					      uint32_t align,
+					      uint32_t *pos)
+{
+	uint32_t from = 0, used;
+	uint64_t key;
+
+	while (bitmap_free_next(b, from, &from) == PON_ADAPTER_SUCCESS) {
+		key = (uint64_t)min + from;
+		key = (key + align - 1) / align * align;
+		if (key - min + num > b->range)
+			break;
+		from = (uint32_t)(key - min);
+
+		if (bitmap_used_find(b, from, &used) != PON_ADAPTER_SUCCESS)
+			used = b->range;
+		if (used - from >= num) {
+			*pos = from;
+			return PON_ADAPTER_SUCCESS;
+		}
+		from = used + 1;
+	}
+
+	return PON_ADAPTER_ERR_NOT_FOUND;
+}
+
+/** Find the mapping with the lowest ID in a range using the ID bitmap
+ *
+ * \param[in]  m        Pointer to mapper
+ * \param[in]  from     Lowest ID
+ * \param[in]  hi       Highest ID
+ * \param[out] key      Key array of the found mapping
+ *
+ * \return
+ *    - PON_ADAPTER_SUCCESS       Mapping was found
+ *    - PON_ADAPTER_ERR_NOT_FOUND No mapping in the range
+ */
+static enum pon_adapter_errno bitmap_next(struct mapper *m,
+					  uint32_t from,
+					  uint32_t hi,
+					  uint32_t key[KEY_TYPE_NUM])
+{
+	uint32_t min = m->m_entry->min_key[KEY_TYPE_ID];
+	uint32_t off;
+
+	if (from < min)
+		from = min;
+
+	if (bitmap_used_find(&m->used[KEY_TYPE_ID], from - min, &off) !=
+	    PON_ADAPTER_SUCCESS || off > hi - min || hi < min)
+		return PON_ADAPTER_ERR_NOT_FOUND;
+
+	key[KEY_TYPE_ID] = min + off;
+
+	return m->ops->find(m, KEY_TYPE_ID, key, NULL);
+}
+
 /** Verify key
  *
  * \note Verify key using range (minimal and maximal values)
@@ -67,8 +789,163 @@ static enum pon_adapter_errno key_verify(const struct mapper *m,
 	return PON_ADAPTER_ERROR;
 }
 
+/** Retrieve the other key type of an ID/Index pair
+ *
+ * \param[in] key_type Key Type
+ *
+ * \return Key type of the mapped key
+ */
+static enum mapper_key_type key_type_other(enum mapper_key_type key_type)
+{
+	return key_type == KEY_TYPE_ID ? KEY_TYPE_INDEX : KEY_TYPE_ID;
+}
+
+/** Take a list node from an arena
+ *
+ * \param[in] a        Arena
+ *
+ * \return Node or NULL if no memory is left
+ */
+static struct mapper_map_list *arena_node_get(struct mapper_arena *a)
+{
+	struct mapper_arena_chunk *chunk;
+	struct mapper_map_list *node = a->free_list;
+
+	if (node) {
+		a->free_list = node->next[KEY_TYPE_ID];
+		a->free_num--;
+		return node;
+	}
+
+	if (!a->cur || a->cur_used == a->cur->nodes) {
+		/* reuse chunks which were kept over a reset */
+		chunk = a->cur ? a->cur->next : a->head;
+		if (!chunk) {
+			chunk = malloc(sizeof(*chunk) +
+				       a->chunk_nodes * sizeof(chunk->node[0]));
+			if (!chunk)
+				return NULL;
+			chunk->next = NULL;
+			chunk->nodes = a->chunk_nodes;
+			if (a->cur)
+				a->cur->next = chunk;
+			else
+				a->head = chunk;
+		}
+		a->cur = chunk;
+		a->cur_used = 0;
+	}
+
+	return &a->cur->node[a->cur_used++];
+}
+
+/** Give a list node back to an arena
+ *
+ * \param[in] a        Arena
+ * \param[in] node     Node
+ */
+static void arena_node_put(struct mapper_arena *a,
+			   struct mapper_map_list *node)
+{
+	node->next[KEY_TYPE_ID] = a->free_list;
+	a->free_list = node;
+	a->free_num++;
+}
+
+/** Make sure that an arena can hand out some nodes without allocating
+ *
+ * Missing nodes are allocated as one chunk, which is appended behind the
+ * chunks kept over a reset.
+ *
+ * \param[in] a        Arena
+ * \param[in] num      Number of nodes
+ *
+ * \return
+ *    - PON_ADAPTER_SUCCESS       The nodes are available
+ *    - PON_ADAPTER_ERR_NO_MEMORY Not enough memory for the missing nodes
+ */
+static enum pon_adapter_errno arena_reserve(struct mapper_arena *a,
+					    uint32_t num)
+{
+	struct mapper_arena_chunk *chunk, *last = NULL;
+	uint64_t avail = a->free_num, size;
+	uint32_t nodes;
+
+	if (a->cur) {
+		avail += a->cur->nodes - a->cur_used;
+		last = a->cur;
+	}
+	for (chunk = a->cur ? a->cur->next : a->head; chunk;
+	     chunk = chunk->next) {
+		avail += chunk->nodes;
+		last = chunk;
+	}
+	if (avail >= num)
+		return PON_ADAPTER_SUCCESS;
+
+	nodes = num - (uint32_t)avail;
+	if (nodes < a->chunk_nodes)
+		nodes = a->chunk_nodes;
+	size = sizeof(*chunk) + (uint64_t)nodes * sizeof(chunk->node[0]);
+	if (size > SIZE_MAX)
+		return PON_ADAPTER_ERR_NO_MEMORY;
+
+	chunk = malloc((size_t)size);
+	if (!chunk)
+		return PON_ADAPTER_ERR_NO_MEMORY;
+	chunk->next = NULL;
+	chunk->nodes = nodes;
+	if (last)
+		last->next = chunk;
+	else
+		a->head = chunk;
+
+	return PON_ADAPTER_SUCCESS;
+}
+
+/** Make all nodes of an arena available again
+ *
+ * \param[in] a        Arena
+ */
+static void arena_reset(struct mapper_arena *a)
+{
+	a->cur = NULL;
+	a->cur_used = 0;
+	a->free_list = NULL;
+	a->free_num = 0;
+}
+
+struct mapper_arena *mapper_arena_alloc(uint32_t chunk_nodes)
+{
+	struct mapper_arena *a;
+
+	a = calloc(1, sizeof(*a));
+	if (!a)
+		return NULL;
+
+	a->chunk_nodes = chunk_nodes ? chunk_nodes : MAPPER_ARENA_CHUNK_NODES;
+
+	return a;
+}
+
+void mapper_arena_free(struct mapper_arena *a)
+{
+	struct mapper_arena_chunk *chunk;
+
+	if (!a)
+		return;
+
+	while (a->head) {
+		chunk = a->head;
+		a->head = chunk->next;
+		free(chunk);
+	}
+	free(a);
+}
+
 /** Create Mapping List Item
  *
+ * \param[in]  m    Pointer to mapper
  * \param[in]  key  Array of keys
  * \param[out] item Pointer to pointer to created item
  *
@@ -76,12 +953,16 @@ static enum pon_adapter_errno key_verify(const struct mapper *m,
  *    - PON_ADAPTER_SUCCESS Item was created successfully
  *    - PON_ADAPTER_ERROR   Item creation failed
  */
-static enum pon_adapter_errno item_create(uint32_t key[KEY_TYPE_NUM],
+static enum pon_adapter_errno item_create(struct mapper *m,
+					  uint32_t key[KEY_TYPE_NUM],
 					  struct mapper_map_list **item)
 {
 	enum mapper_key_type key_type;
 
-	*item = malloc(sizeof(struct mapper_map_list));
+	if (m->arena)
+		*item = arena_node_get(m->arena);
+	else
+		*item = malloc(sizeof(struct mapper_map_list));
 	if (!(*item)) {
 		PA_DBG_PRINT("%s", "Not enough memory for new mapper item!\n");
 		return PON_ADAPTER_ERROR;
@@ -90,6 +971,7 @@ static enum pon_adapter_errno item_create(uint32_t key[KEY_TYPE_NUM],
 	for (key_type = KEY_TYPE_ID; key_type < KEY_TYPE_NUM; key_type++) {
 		(*item)->key[key_type] = key[key_type];
 		(*item)->next[key_type] = NULL;
+		(*item)->prev[key_type] = NULL;
 	}
 
 	return PON_ADAPTER_SUCCESS;
@@ -97,11 +979,15 @@ static enum pon_adapter_errno item_create(uint32_t key[KEY_TYPE_NUM],
 
 /** Delete Mapping List Item
  *
+ * \param[in] m    Pointer to mapper
  * \param[in] item Pointer to Item to delete
  */
-static void item_delete(struct mapper_map_list *item)
+static void item_delete(struct mapper *m, struct mapper_map_list *item)
 {
-	free(item);
+	if (m->arena)
+		arena_node_put(m->arena, item);
+	else
+		free(item);
 }
 
 /** Add Item to Mapping list
@@ -131,6 +1017,9 @@ static enum pon_adapter_errno item_add(struct mapper *m,
 			item->next[key_type] = pos[key_type]->next[key_type];
 			pos[key_type]->next[key_type] = item;
 		}
+		item->prev[key_type] = pos[key_type];
+		if (item->next[key_type])
+			item->next[key_type]->prev[key_type] = item;
 	}
 
 	return PON_ADAPTER_SUCCESS;
@@ -142,39 +1031,25 @@ static enum pon_adapter_errno item_add(struct mapper *m,
  *       (for deletion use \ref item_delete)
  *
  * \param[in] m       Pointer to mapper
- * \param[in] pos     Array of Item positions
- *
- * \return
- *    - Pointer to the removed Item
- *    - NULL pointer if Item removing failed
+ * \param[in] item    Item to remove
  */
-static struct mapper_map_list *item_remove(struct mapper *m,
-					   struct mapper_map_list
-						*pos[KEY_TYPE_NUM])
+static void item_remove(struct mapper *m, struct mapper_map_list *item)
 {
-	struct mapper_map_list *removed_item = NULL;
 	enum mapper_key_type key_type;
 
-	if (!m)
-		return removed_item;
-
 	for (key_type = KEY_TYPE_ID; key_type < KEY_TYPE_NUM; key_type++) {
-		if (!(pos[key_type])) {
-			removed_item = m->list_head[key_type];
-			m->list_head[key_type] =
-				m->list_head[key_type]->next[key_type];
-		} else {
-			removed_item = pos[key_type]->next[key_type];
-			pos[key_type]->next[key_type] =
-				pos[key_type]->next[key_type]->next[key_type];
-		}
+		if (item->prev[key_type])
+			item->prev[key_type]->next[key_type] =
+				item->next[key_type];
+		else
+			m->list_head[key_type] = item->next[key_type];
+		if (item->next[key_type])
+			item->next[key_type]->prev[key_type] =
+				item->prev[key_type];
+
+		/* the predecessors stay linked */
+		m->finger[key_type] = item->prev[key_type];
 	}
-
-	if (!removed_item)
-		PA_DBG_PRINT("Failed to remove item {%s}\n",
-			m->m_entry->name);
-
-	return removed_item;
 }
 
 /** Retrieve Item for the given position
@@ -209,52 +1084,74 @@ static struct mapper_map_list *item_get(const struct mapper *m,
  * \param[in]  m        Pointer to mapper
  * \param[in]  key_type Key Type
  * \param[in]  key      Key
+ * \param[in]  start    Item to start the search behind, NULL to search the
+ *                      whole list. Used only if its key is below \p key.
  * \param[out] pos      Pointer to array of Item positions
+ * \param[out] steps    Number of visited Items, may be NULL
  *
  * \return
  *    - PON_ADAPTER_SUCCESS   Item was found successfully
  *    - PON_ADAPTER_ERR_NOT_FOUND Item was not found
  *    - PON_ADAPTER_ERROR     Item searching failed
  */
-static enum pon_adapter_errno item_find(const struct mapper *m,
-				      enum mapper_key_type key_type,
-				      uint32_t key,
-				      struct mapper_map_list **pos)
+static enum pon_adapter_errno item_find_from(const struct mapper *m,
+					     enum mapper_key_type key_type,
+					     uint32_t key,
+					     struct mapper_map_list *start,
+					     struct mapper_map_list **pos,
+					     uint32_t *steps)
 {
 	struct mapper_map_list *item = NULL;
+	uint32_t n = 1;
 
 	if (!m)
 		return PON_ADAPTER_ERROR;
 
-	*pos = NULL;
-
-	item = m->list_head[key_type];
-	if ((!item))
-		return PON_ADAPTER_ERR_NOT_FOUND;
-
-	if (key < item->key[key_type])
-		return PON_ADAPTER_ERR_NOT_FOUND;
-
-	if (item->key[key_type] == key)
-		return PON_ADAPTER_SUCCESS;
+	if (start && start->key[key_type] < key) {
+		*pos = start;
+		item = start->next[key_type];
+	} else {
+		*pos = NULL;
+		item = m->list_head[key_type];
+	}
 
-	while (item->next[key_type]) {
-		if (item->next[key_type]->key[key_type] == key) {
-			*pos = item;
-			return PON_ADAPTER_SUCCESS;
-		}
-		if (key < item->next[key_type]->key[key_type]) {
-			*pos = item;
-			return PON_ADAPTER_ERR_NOT_FOUND;
-		}
+	while (item && item->key[key_type] < key) {
+		*pos = item;
 		item = item->next[key_type];
+		n++;
 	}
 
-	*pos = item;
+	if (steps)
+		*steps = n;
+
+	if (item && item->key[key_type] == key)
+		return PON_ADAPTER_SUCCESS;
 
 	return PON_ADAPTER_ERR_NOT_FOUND;
 }
 
+/** Find Item in the Mapping List with the given Key number
+ *
+ * \param[in]  m        Pointer to mapper
+ * \param[in]  key_type Key Type
+ * \param[in]  key      Key
+ * \param[out] pos      Pointer to array of Item positions
+ * \param[out] steps    Number of visited Items, may be NULL
+ *
+ * \return
+ *    - PON_ADAPTER_SUCCESS   Item was found successfully
+ *    - PON_ADAPTER_ERR_NOT_FOUND Item was not found
+ *    - PON_ADAPTER_ERROR     Item searching failed
+ */
+static enum pon_adapter_errno item_find(const struct mapper *m,
+				      enum mapper_key_type key_type,
+				      uint32_t key,
+				      struct mapper_map_list **pos,
+				      uint32_t *steps)
+{
+	return item_find_from(m, key_type, key, NULL, pos, steps);
+}
+
 /** Retrieve key from the given Item with respect to the key Type
  *
  * \param[in]  item     Item to retrieve key from
@@ -322,105 +1219,323 @@ static enum pon_adapter_errno free_key_find(const struct mapper *m,
 	return PON_ADAPTER_SUCCESS;
 }
 
-struct mapper *mapper_alloc(const struct mapper_entry *m_entry)
+static enum pon_adapter_errno list_init(struct mapper *m)
 {
-	struct mapper *m;
+	m->list_head[KEY_TYPE_ID] = NULL;
 
-	PA_DBG_PRINT("Setup map item={%s} id=[0x%08x,0x%08x] idx=[0x%08x,0x%08x]\n",
-			m_entry->name,
-			m_entry->min_key[KEY_TYPE_ID],
-			m_entry->max_key[KEY_TYPE_ID],
-			m_entry->min_key[KEY_TYPE_INDEX],
-			m_entry->max_key[KEY_TYPE_INDEX]);
+	m->list_head[KEY_TYPE_INDEX] = NULL;
 
-	m = malloc(sizeof(struct mapper));
-	if (!m)
-		return NULL;
+	m->finger[KEY_TYPE_ID] = NULL;
 
-	m->m_entry = m_entry;
+	m->finger[KEY_TYPE_INDEX] = NULL;
 
-	m->list_head[KEY_TYPE_ID] = NULL;
+	return PON_ADAPTER_SUCCESS;
+}
 
-	m->list_head[KEY_TYPE_INDEX] = NULL;
+static enum pon_adapter_errno list_find(const struct mapper *m,
+					enum mapper_key_type key_type,
+					uint32_t key[KEY_TYPE_NUM],
+					uint32_t *steps)
+{
+	enum pon_adapter_errno ret;
+	struct mapper_map_list *item_pos = NULL;
+	struct mapper_map_list *item = NULL;
 
-	return m;
+	ret = item_find(m, key_type, key[key_type], &item_pos, steps);
+	if (ret != PON_ADAPTER_SUCCESS)
+		return ret;
+
+	item = item_get(m, key_type, item_pos);
+	if (!item)
+		return PON_ADAPTER_ERROR;
+
+	key_get(item, key_type_other(key_type),
+		&key[key_type_other(key_type)]);
+
+	return PON_ADAPTER_SUCCESS;
 }
 
-enum pon_adapter_errno mapper_cleanup(struct mapper *m)
+static enum pon_adapter_errno list_add(struct mapper *m,
+				       enum mapper_key_type alloc_type,
+				       uint32_t key[KEY_TYPE_NUM])
 {
 	enum pon_adapter_errno ret;
 	struct mapper_map_list *item_pos[KEY_TYPE_NUM] = { NULL };
 	struct mapper_map_list *item = NULL;
-	uint32_t key;
+	enum mapper_key_type key_type;
 
-	if (m) {
-		item = item_get(m, KEY_TYPE_ID, item_pos[KEY_TYPE_ID]);
-		while (item) {
-			key_get(item, KEY_TYPE_INDEX, &key);
-
-			ret = item_find(m, KEY_TYPE_INDEX, key,
-					&item_pos[KEY_TYPE_INDEX]);
-			if (ret != PON_ADAPTER_SUCCESS) {
-				PA_DBG_PRINT
-				    ("Index %d searching error %d\n",
-				     key, ret);
-				return PON_ADAPTER_ERROR;
-			}
+	for (key_type = KEY_TYPE_ID; key_type < KEY_TYPE_NUM; key_type++) {
+		if (key_type == alloc_type) {
+			ret = free_key_find(m, key_type, &key[key_type],
+					    &item_pos[key_type]);
+			if (ret != PON_ADAPTER_SUCCESS)
+				return ret;
+			continue;
+		}
 
-			item = item_remove(m, item_pos);
-			if (!item)
-				return PON_ADAPTER_ERROR;
+		ret = item_find_from(m, key_type, key[key_type],
+				     m->finger[key_type], &item_pos[key_type],
+				     NULL);
+		if (ret == PON_ADAPTER_SUCCESS) {
+			PA_DBG_PRINT
+			    ("Key %d with type %d is already mapped for item {%s}\n",
+			     key[key_type], key_type, m->m_entry->name);
+			return PON_ADAPTER_ERROR;
+		}
+	}
 
-			item_delete(item);
+	ret = item_create(m, key, &item);
+	if (ret != PON_ADAPTER_SUCCESS)
+		return PON_ADAPTER_ERR_NO_MEMORY;
 
-			item = item_get(m, KEY_TYPE_ID,
-					item_pos[KEY_TYPE_ID]);
-		}
+	ret = item_add(m, item_pos, item);
+	if (ret != PON_ADAPTER_SUCCESS)
+		return ret;
 
-		return PON_ADAPTER_SUCCESS;
-	}
+	for (key_type = KEY_TYPE_ID; key_type < KEY_TYPE_NUM; key_type++)
+		m->finger[key_type] = item;
 
-	return PON_ADAPTER_ERROR;
+	return PON_ADAPTER_SUCCESS;
 }
 
-enum pon_adapter_errno mapper_free(struct mapper *m)
+static enum pon_adapter_errno list_remove(struct mapper *m,
+					  enum mapper_key_type key_type,
+					  uint32_t key[KEY_TYPE_NUM])
 {
 	enum pon_adapter_errno ret;
+	struct mapper_map_list *item_pos = NULL;
+	struct mapper_map_list *item = NULL;
+	enum mapper_key_type other = key_type_other(key_type);
 
-	ret = mapper_cleanup(m);
+	ret = item_find_from(m, key_type, key[key_type], m->finger[key_type],
+			     &item_pos, NULL);
 	if (ret != PON_ADAPTER_SUCCESS)
 		return ret;
 
-	free(m);
+	item = item_get(m, key_type, item_pos);
+	if (!item)
+		return PON_ADAPTER_ERROR;
+
+	key_get(item, other, &key[other]);
+
+	item_remove(m, item);
+	item_delete(m, item);
 
 	return PON_ADAPTER_SUCCESS;
 }
 
-enum pon_adapter_errno mapper_explicit_map(struct mapper *m,
-					   uint32_t id,
-					   uint32_t idx)
+static enum pon_adapter_errno list_cleanup(struct mapper *m, bool release)
 {
-	enum pon_adapter_errno ret = PON_ADAPTER_SUCCESS;
-	uint32_t key[KEY_TYPE_NUM] = { 0 };
-	struct mapper_map_list *item_pos[KEY_TYPE_NUM] = { NULL };
+	struct mapper_map_list *item = m->list_head[KEY_TYPE_ID];
+	struct mapper_map_list *next;
+
+	/* every item is linked once into each list, the ID list is enough */
+	while (release && item) {
+		next = item->next[KEY_TYPE_ID];
+		item_delete(m, item);
+		item = next;
+	}
+
+	m->list_head[KEY_TYPE_ID] = NULL;
+	m->list_head[KEY_TYPE_INDEX] = NULL;
+	m->finger[KEY_TYPE_ID] = NULL;
+	m->finger[KEY_TYPE_INDEX] = NULL;
+
+	return PON_ADAPTER_SUCCESS;
+}
+
+static void list_keys_get(const struct mapper *m,
+			  enum mapper_key_type key_type,
+			  uint32_t *keys)
+{
+	struct mapper_map_list *item = m->list_head[key_type];
+	uint32_t i = 0;
+
+	while (item) {
+		keys[i++] = item->key[key_type];
+		item = item->next[key_type];
+	}
+}
+
+static enum pon_adapter_errno list_find_node(const struct mapper *m,
+					     enum mapper_key_type key_type,
+					     uint32_t key[KEY_TYPE_NUM],
+					     void **node)
+{
+	enum pon_adapter_errno ret;
+	struct mapper_map_list *item_pos = NULL;
+	struct mapper_map_list *item = m->finger[key_type];
+
+	/* the last added item is found without a search */
+	if (!item || item->key[key_type] != key[key_type]) {
+		ret = item_find_from(m, key_type, key[key_type], item,
+				     &item_pos, NULL);
+		if (ret != PON_ADAPTER_SUCCESS)
+			return ret;
+
+		item = item_get(m, key_type, item_pos);
+	}
+
+	key_get(item, key_type_other(key_type),
+		&key[key_type_other(key_type)]);
+	*node = item;
+
+	return PON_ADAPTER_SUCCESS;
+}
+
+static void list_remove_node(struct mapper *m, void *node)
+{
+	item_remove(m, node);
+	item_delete(m, node);
+}
+
+static enum pon_adapter_errno list_find_batch(const struct mapper *m,
+					      enum mapper_key_type key_type,
+					      const uint32_t *keys,
+					      uint32_t num,
+					      uint32_t *other_keys,
+					      uint32_t steps[2])
+{
+	enum pon_adapter_errno ret;
+	enum mapper_key_type other = key_type_other(key_type);
+	struct mapper_map_list *item_pos = NULL;
 	struct mapper_map_list *item = NULL;
+	uint32_t i, n = 0;
+
+	for (i = 0; i < num; i++) {
+		/* ascending keys continue behind the previous match */
+		ret = item_find_from(m, key_type, keys[i], item, &item_pos, &n);
+		steps[0] += n;
+		if (n > steps[1])
+			steps[1] = n;
+		if (ret != PON_ADAPTER_SUCCESS)
+			return ret;
+
+		item = item_get(m, key_type, item_pos);
+		key_get(item, other, &other_keys[i]);
+	}
+
+	return PON_ADAPTER_SUCCESS;
+}
+
+static enum pon_adapter_errno list_next(struct mapper *m,
+				        struct mapper_cursor *c,
+				        uint32_t from,
+				        uint32_t key[KEY_TYPE_NUM])
+{
+	struct mapper_map_list *item_pos = NULL;
+	struct mapper_map_list *item;
+
+	/* the node of the last step is valid while the mapper is unchanged */
+	if (c->state == MAPPER_CURSOR_RUN && c->gen == m->gen) {
+		item = ((struct mapper_map_list *)c->node)->next[KEY_TYPE_ID];
+	} else {
+		item_find_from(m, KEY_TYPE_ID, from, NULL, &item_pos, NULL);
+		item = item_get(m, KEY_TYPE_ID, item_pos);
+	}
+
+	if (!item || item->key[KEY_TYPE_ID] > c->hi)
+		return PON_ADAPTER_ERR_NOT_FOUND;
+
+	c->node = item;
+	key[KEY_TYPE_ID] = item->key[KEY_TYPE_ID];
+	key[KEY_TYPE_INDEX] = item->key[KEY_TYPE_INDEX];
+
+	return PON_ADAPTER_SUCCESS;
+}
+
+/** Sorted list backend, used for large key ranges */
+static const struct mapper_backend mapper_list_backend = {
+	.name = "list",
+	.init = list_init,
+	.find = list_find,
+	.find_node = list_find_node,
+	.remove_node = list_remove_node,
+	.find_batch = list_find_batch,
+	.add = list_add,
+	.remove = list_remove,
+	.cleanup = list_cleanup,
+	.keys_get = list_keys_get,
+	.next = list_next,
+};
+
+/** Retrieve the number of keys in the range of a key type
+ *
+ * \param[in] m        Pointer to mapper
+ * \param[in] key_type Key Type
+ *
+ * \return Size of the key range
+ */
+static uint32_t direct_range(const struct mapper *m,
+			     enum mapper_key_type key_type)
+{
+	return m->m_entry->max_key[key_type] -
+	       m->m_entry->min_key[key_type] + 1;
+}
+
+static enum pon_adapter_errno direct_init(struct mapper *m)
+{
 	enum mapper_key_type key_type;
 
-	PA_DBG_PRINT("%s(%u, %u)\n", __func__, id, idx);
+	for (key_type = KEY_TYPE_ID; key_type < KEY_TYPE_NUM; key_type++) {
+		m->direct[key_type] = calloc(direct_range(m, key_type),
+					     sizeof(uint32_t));
+		if (!m->direct[key_type]) {
+			PA_DBG_PRINT("%s", "Not enough memory for mapper table\n");
+			free(m->direct[KEY_TYPE_ID]);
+			m->direct[KEY_TYPE_ID] = NULL;
+			return PON_ADAPTER_ERR_NO_MEMORY;
+		}
+	}
 
-	key[KEY_TYPE_ID] = id;
-	key[KEY_TYPE_INDEX] = idx;
+	return PON_ADAPTER_SUCCESS;
+}
+
+static void direct_exit(struct mapper *m)
+{
+	enum mapper_key_type key_type;
 
 	for (key_type = KEY_TYPE_ID; key_type < KEY_TYPE_NUM; key_type++) {
-		ret = key_verify(m, key_type, key[key_type]);
-		if (ret != PON_ADAPTER_SUCCESS)
-			return PON_ADAPTER_ERROR;
+		free(m->direct[key_type]);
+		m->direct[key_type] = NULL;
 	}
+}
+
+static enum pon_adapter_errno direct_find(const struct mapper *m,
+					  enum mapper_key_type key_type,
+					  uint32_t key[KEY_TYPE_NUM],
+					  uint32_t *steps)
+{
+	enum mapper_key_type other = key_type_other(key_type);
+	uint32_t val;
+
+	if (steps)
+		*steps = 1;
+
+	val = m->direct[key_type][key[key_type] -
+				  m->m_entry->min_key[key_type]];
+	if (!val)
+		return PON_ADAPTER_ERR_NOT_FOUND;
+
+	key[other] = m->m_entry->min_key[other] + val - 1;
+
+	return PON_ADAPTER_SUCCESS;
+}
+
+static enum pon_adapter_errno direct_add(struct mapper *m,
+					 enum mapper_key_type alloc_type,
+					 uint32_t key[KEY_TYPE_NUM])
+{
+	enum mapper_key_type key_type;
+	uint32_t off[KEY_TYPE_NUM];
+
+	/* direct ranges always have a used key bitmap to allocate from */
+	if (alloc_type != KEY_TYPE_NUM)
+		return PON_ADAPTER_ERROR;
 
 	for (key_type = KEY_TYPE_ID; key_type < KEY_TYPE_NUM; key_type++) {
-		ret = item_find(m, key_type, key[key_type],
-				&item_pos[key_type]);
-		if (ret == PON_ADAPTER_SUCCESS) {
+		off[key_type] = key[key_type] - m->m_entry->min_key[key_type];
+		if (m->direct[key_type][off[key_type]]) {
 			PA_DBG_PRINT
 			    ("Key %d with type %d is already mapped for item {%s}\n",
 			     key[key_type], key_type, m->m_entry->name);
@@ -428,363 +1543,2253 @@ enum pon_adapter_errno mapper_explicit_map(struct mapper *m,
 		}
 	}
 
-	ret = item_create(key, &item);
-	if (ret != PON_ADAPTER_SUCCESS)
-		return PON_ADAPTER_ERROR;
+	m->direct[KEY_TYPE_ID][off[KEY_TYPE_ID]] = off[KEY_TYPE_INDEX] + 1;
+	m->direct[KEY_TYPE_INDEX][off[KEY_TYPE_INDEX]] = off[KEY_TYPE_ID] + 1;
 
-	ret = item_add(m, item_pos, item);
+	return PON_ADAPTER_SUCCESS;
+}
+
+static enum pon_adapter_errno direct_remove(struct mapper *m,
+					    enum mapper_key_type key_type,
+					    uint32_t key[KEY_TYPE_NUM])
+{
+	enum pon_adapter_errno ret;
+	enum mapper_key_type other = key_type_other(key_type);
+
+	ret = direct_find(m, key_type, key, NULL);
 	if (ret != PON_ADAPTER_SUCCESS)
-		return PON_ADAPTER_ERROR;
+		return ret;
+
+	m->direct[key_type][key[key_type] - m->m_entry->min_key[key_type]] = 0;
+	m->direct[other][key[other] - m->m_entry->min_key[other]] = 0;
 
 	return PON_ADAPTER_SUCCESS;
 }
 
-enum pon_adapter_errno mapper_id_map(struct mapper *m,
-				     uint32_t id,
-				     uint32_t *idx)
+static enum pon_adapter_errno direct_cleanup(struct mapper *m, bool release)
 {
-	enum pon_adapter_errno ret = PON_ADAPTER_SUCCESS;
-	struct mapper_map_list *item_pos[KEY_TYPE_NUM] = { NULL };
-	struct mapper_map_list *item = NULL;
-	uint32_t key[KEY_TYPE_NUM] = { 0 };
+	enum mapper_key_type key_type;
 
-	PA_DBG_PRINT("%s(%u, %p) item {%s}\n", __func__, id, idx,
-		     m->m_entry->name);
+	(void)release;
+	for (key_type = KEY_TYPE_ID; key_type < KEY_TYPE_NUM; key_type++)
+		memset(m->direct[key_type], 0,
+		       direct_range(m, key_type) * sizeof(uint32_t));
 
-	ret = key_verify(m, KEY_TYPE_ID, id);
-	if (ret != PON_ADAPTER_SUCCESS)
-		return PON_ADAPTER_ERROR;
+	return PON_ADAPTER_SUCCESS;
+}
+
+static void direct_keys_get(const struct mapper *m,
+			    enum mapper_key_type key_type,
+			    uint32_t *keys)
+{
+	uint32_t range = direct_range(m, key_type);
+	uint32_t off, i = 0;
+
+	for (off = 0; off < range && i < m->count; off++)
+		if (m->direct[key_type][off])
+			keys[i++] = m->m_entry->min_key[key_type] + off;
+}
+
+/** Direct-indexed backend, used if all key ranges are small */
+static enum pon_adapter_errno direct_next(struct mapper *m,
+					  struct mapper_cursor *c,
+					  uint32_t from,
+					  uint32_t key[KEY_TYPE_NUM])
+{
+	return bitmap_next(m, from, c->hi, key);
+}
+
+static const struct mapper_backend mapper_direct_backend = {
+	.name = "direct",
+	.init = direct_init,
+	.exit = direct_exit,
+	.find = direct_find,
+	.add = direct_add,
+	.remove = direct_remove,
+	.cleanup = direct_cleanup,
+	.keys_get = direct_keys_get,
+	.next = direct_next,
+};
+
+/** Allocate an empty hash table
+ *
+ * \param[in] slots    Number of slots (power of 2)
+ *
+ * \return Table or NULL if there is not enough memory
+ */
+static struct mapper_hash_table *hash_table_alloc(uint32_t slots)
+{
+	struct mapper_hash_table *t;
+	uint32_t bits = 0;
+
+	t = malloc(sizeof(*t) + slots * (sizeof(t->slot[0]) +
+					 sizeof(t->dist[0])));
+	if (!t)
+		return NULL;
+
+	t->dist = (uint8_t *)(t->slot + slots);
+	memset(t->dist, 0, slots * sizeof(t->dist[0]));
+
+	while ((1U << bits) < slots)
+		bits++;
+
+	t->mask = slots - 1;
+	t->shift = 32 - bits;
+
+	return t;
+}
+
+/** Allocate the table of a hash
+ *
+ * \param[in] h        Hash table
+ * \param[in] slots    Number of slots (power of 2)
+ * \param[in] retire   Keep replaced tables until \ref hash_exit
+ *
+ * \return
+ *    - PON_ADAPTER_SUCCESS       Slots were allocated
+ *    - PON_ADAPTER_ERR_NO_MEMORY Not enough memory
+ */
+static enum pon_adapter_errno hash_init(struct mapper_hash *h, uint32_t slots,
+					bool retire)
+{
+	h->tbl = hash_table_alloc(slots);
+	if (!h->tbl)
+		return PON_ADAPTER_ERR_NO_MEMORY;
+
+	h->used = 0;
+	h->retire = retire;
+	h->retired_num = 0;
+
+	return PON_ADAPTER_SUCCESS;
+}
+
+/** Release a hash table
+ *
+ * \param[in] h        Hash table
+ */
+static void hash_exit(struct mapper_hash *h)
+{
+	while (h->retired_num)
+		free(h->retired[--h->retired_num]);
+
+	free(h->tbl);
+	h->tbl = NULL;
+	h->used = 0;
+}
+
+/** Remove all entries of a hash table
+ *
+ * \param[in] h        Hash table
+ */
+static void hash_clear(struct mapper_hash *h)
+{
+	memset(h->tbl->dist, 0, (h->tbl->mask + 1) * sizeof(h->tbl->dist[0]));
+	h->used = 0;
+}
+
+/** Retrieve the home slot of a key (Fibonacci hashing)
+ *
+ * \param[in] t        Hash table storage
+ * \param[in] key      Key
+ *
+ * \return Slot number
+ */
+static inline uint32_t hash_pos(const struct mapper_hash_table *t,
+				uint32_t key)
+{
+	return (uint32_t)(key * 2654435769U) >> t->shift;
+}
+
+/** Find the slot of a key
+ *
+ * \param[in]  h        Hash table
+ * \param[in]  key      Key
+ * \param[out] steps    Number of probed slots, may be NULL
+ *
+ * \return Pointer to the slot or NULL if the key is not stored
+ */
+static struct mapper_hash_slot *hash_find(const struct mapper_hash *h,
+					  uint32_t key,
+					  uint32_t *steps)
+{
+	struct mapper_hash_table *t;
+	uint32_t i, d = 1;
+
+#if MAPPER_CONCURRENT == 1
+	t = __atomic_load_n(&h->tbl, __ATOMIC_ACQUIRE);
+#else
+	t = h->tbl;
+#endif
+	i = hash_pos(t, key);
+
+	/* robin hood order allows to stop at the first poorer entry,
+	 * the probe distance limit also ends the walk for readers racing
+	 * with a writer
+	 */
+	while (t->dist[i] >= d) {
+		if (t->slot[i].key == key)
+			break;
+		i = (i + 1) & t->mask;
+		d++;
+	}
+
+	if (steps)
+		*steps = d;
+
+	return t->dist[i] >= d ? &t->slot[i] : NULL;
+}
+
+/** Insert a slot into a table
+ *
+ * \param[in]     t        Hash table storage
+ * \param[in,out] cur      Slot to insert, returns the slot which could not
+ *                         be stored on probe distance overflow
+ *
+ * \return false on probe distance overflow
+ */
+static bool hash_table_insert(struct mapper_hash_table *t,
+			      struct mapper_hash_slot *cur)
+{
+	struct mapper_hash_slot tmp;
+	uint32_t i = hash_pos(t, cur->key);
+	uint8_t d = 1, td;
+
+	for (;;) {
+		if (!t->dist[i]) {
+			t->slot[i] = *cur;
+			t->dist[i] = d;
+			return true;
+		}
+		/* take the slot from an entry closer to its home slot */
+		if (t->dist[i] < d) {
+			tmp = t->slot[i];
+			td = t->dist[i];
+			t->slot[i] = *cur;
+			t->dist[i] = d;
+			*cur = tmp;
+			d = td;
+		}
+		i = (i + 1) & t->mask;
+		if (++d == UINT8_MAX)
+			return false;
+	}
+}
+
+/** Replace the table of a hash by a larger one
+ *
+ * \param[in] h        Hash table
+ *
+ * \return
+ *    - PON_ADAPTER_SUCCESS       Table was resized
+ *    - PON_ADAPTER_ERR_NO_MEMORY Not enough memory
+ */
+static enum pon_adapter_errno hash_grow(struct mapper_hash *h)
+{
+	struct mapper_hash_table *old = h->tbl, *t;
+	struct mapper_hash_slot cur;
+	uint32_t slots = (old->mask + 1) * 2;
+	uint32_t i;
+
+	if (h->retire && h->retired_num == MAPPER_HASH_RETIRED_MAX)
+		return PON_ADAPTER_ERR_NO_MEMORY;
+
+	for (;;) {
+		t = hash_table_alloc(slots);
+		if (!t)
+			return PON_ADAPTER_ERR_NO_MEMORY;
+
+		for (i = 0; i <= old->mask; i++) {
+			if (!old->dist[i])
+				continue;
+			cur = old->slot[i];
+			if (!hash_table_insert(t, &cur))
+				break;
+		}
+		if (i > old->mask)
+			break;
+
+		/* probe distance overflow, retry with more slots */
+		free(t);
+		slots *= 2;
+	}
+
+#if MAPPER_CONCURRENT == 1
+	__atomic_store_n(&h->tbl, t, __ATOMIC_RELEASE);
+#else
+	h->tbl = t;
+#endif
+	if (h->retire)
+		h->retired[h->retired_num++] = old;
+	else
+		free(old);
+
+	return PON_ADAPTER_SUCCESS;
+}
+
+/** Insert a key which is not yet stored
+ *
+ * \param[in] h        Hash table
+ * \param[in] key      Key
+ * \param[in] val      Mapped key
+ *
+ * \return
+ *    - PON_ADAPTER_SUCCESS       Key was inserted
+ *    - PON_ADAPTER_ERR_NO_MEMORY Not enough memory
+ */
+static enum pon_adapter_errno hash_insert(struct mapper_hash *h,
+					  uint32_t key, uint32_t val)
+{
+	struct mapper_hash_slot cur;
+	enum pon_adapter_errno ret;
+
+	/* keep the load factor below 80% */
+	if ((h->used + 1) * 5 > (h->tbl->mask + 1) * 4) {
+		ret = hash_grow(h);
+		if (ret != PON_ADAPTER_SUCCESS)
+			return ret;
+	}
+
+	cur.key = key;
+	cur.val = val;
+
+	/* on probe distance overflow the carried entry is the only one which
+	 * is not stored in the table
+	 */
+	while (!hash_table_insert(h->tbl, &cur)) {
+		ret = hash_grow(h);
+		if (ret != PON_ADAPTER_SUCCESS)
+			return ret;
+	}
+	h->used++;
+
+	return PON_ADAPTER_SUCCESS;
+}
+
+/** Remove a stored key
+ *
+ * \param[in]  h        Hash table
+ * \param[in]  slot     Slot of the key, as returned by \ref hash_find
+ */
+static void hash_remove(struct mapper_hash *h, struct mapper_hash_slot *slot)
+{
+	struct mapper_hash_table *t = h->tbl;
+	uint32_t i = (uint32_t)(slot - t->slot);
+	uint32_t j = (i + 1) & t->mask;
+
+	/* shift the following entries of the probe sequence back */
+	while (t->dist[j] > 1) {
+		t->slot[i] = t->slot[j];
+		t->dist[i] = t->dist[j] - 1;
+		i = j;
+		j = (j + 1) & t->mask;
+	}
+	t->dist[i] = 0;
+	h->used--;
+}
+
+static enum pon_adapter_errno hash_backend_init(struct mapper *m)
+{
+	enum mapper_key_type key_type;
+	enum pon_adapter_errno ret;
+
+	for (key_type = KEY_TYPE_ID; key_type < KEY_TYPE_NUM; key_type++) {
+		ret = hash_init(&m->hash[key_type], MAPPER_HASH_SLOTS_MIN,
+				m->concurrent);
+		if (ret != PON_ADAPTER_SUCCESS) {
+			PA_DBG_PRINT("%s", "Not enough memory for mapper table\n");
+			hash_exit(&m->hash[KEY_TYPE_ID]);
+			return ret;
+		}
+	}
+
+	return PON_ADAPTER_SUCCESS;
+}
+
+static void hash_backend_exit(struct mapper *m)
+{
+	enum mapper_key_type key_type;
+
+	for (key_type = KEY_TYPE_ID; key_type < KEY_TYPE_NUM; key_type++)
+		hash_exit(&m->hash[key_type]);
+
+	free(m->sorted);
+	m->sorted = NULL;
+}
+
+static enum pon_adapter_errno hash_backend_find(const struct mapper *m,
+						enum mapper_key_type key_type,
+						uint32_t key[KEY_TYPE_NUM],
+						uint32_t *steps)
+{
+	struct mapper_hash_slot *slot;
+
+	slot = hash_find(&m->hash[key_type], key[key_type], steps);
+	if (!slot)
+		return PON_ADAPTER_ERR_NOT_FOUND;
+
+	key[key_type_other(key_type)] = slot->val;
+
+	return PON_ADAPTER_SUCCESS;
+}
+
+static enum pon_adapter_errno hash_backend_add(struct mapper *m,
+					       enum mapper_key_type alloc_type,
+					       uint32_t key[KEY_TYPE_NUM])
+{
+	enum mapper_key_type key_type;
+	enum pon_adapter_errno ret;
+
+	for (key_type = KEY_TYPE_ID; key_type < KEY_TYPE_NUM; key_type++) {
+		if (key_type == alloc_type) {
+			/* no bitmap for this range, probe upwards */
+			key[key_type] = m->m_entry->min_key[key_type];
+			while (hash_find(&m->hash[key_type], key[key_type],
+					 NULL)) {
+				if (key[key_type] ==
+				    m->m_entry->max_key[key_type]) {
+					PA_DBG_PRINT("No free key for type %d, name %s\n",
+						     key_type, m->m_entry->name);
+					return PON_ADAPTER_ERR_NOT_FOUND;
+				}
+				key[key_type]++;
+			}
+			continue;
+		}
+
+		if (hash_find(&m->hash[key_type], key[key_type], NULL)) {
+			PA_DBG_PRINT
+			    ("Key %d with type %d is already mapped for item {%s}\n",
+			     key[key_type], key_type, m->m_entry->name);
+			return PON_ADAPTER_ERROR;
+		}
+	}
+
+	ret = hash_insert(&m->hash[KEY_TYPE_ID], key[KEY_TYPE_ID],
+			  key[KEY_TYPE_INDEX]);
+	if (ret != PON_ADAPTER_SUCCESS)
+		return ret;
+
+	ret = hash_insert(&m->hash[KEY_TYPE_INDEX], key[KEY_TYPE_INDEX],
+			  key[KEY_TYPE_ID]);
+	if (ret != PON_ADAPTER_SUCCESS) {
+		hash_remove(&m->hash[KEY_TYPE_ID],
+			    hash_find(&m->hash[KEY_TYPE_ID], key[KEY_TYPE_ID],
+				      NULL));
+		return ret;
+	}
+
+	return PON_ADAPTER_SUCCESS;
+}
+
+static enum pon_adapter_errno hash_backend_remove(struct mapper *m,
+						  enum mapper_key_type key_type,
+						  uint32_t key[KEY_TYPE_NUM])
+{
+	enum mapper_key_type other = key_type_other(key_type);
+	struct mapper_hash_slot *slot;
+
+	slot = hash_find(&m->hash[key_type], key[key_type], NULL);
+	if (!slot)
+		return PON_ADAPTER_ERR_NOT_FOUND;
+
+	key[other] = slot->val;
+	hash_remove(&m->hash[key_type], slot);
+
+	slot = hash_find(&m->hash[other], key[other], NULL);
+	if (!slot)
+		return PON_ADAPTER_ERROR;
+
+	hash_remove(&m->hash[other], slot);
+
+	return PON_ADAPTER_SUCCESS;
+}
+
+static enum pon_adapter_errno hash_backend_cleanup(struct mapper *m,
+						   bool release)
+{
+	enum mapper_key_type key_type;
+
+	(void)release;
+	for (key_type = KEY_TYPE_ID; key_type < KEY_TYPE_NUM; key_type++)
+		hash_clear(&m->hash[key_type]);
+
+	return PON_ADAPTER_SUCCESS;
+}
+
+/** Compare two keys for qsort */
+static int key_cmp(const void *a, const void *b)
+{
+	uint32_t ka = *(const uint32_t *)a;
+	uint32_t kb = *(const uint32_t *)b;
+
+	return ka < kb ? -1 : ka > kb;
+}
+
+static void hash_backend_keys_get(const struct mapper *m,
+				  enum mapper_key_type key_type,
+				  uint32_t *keys)
+{
+	const struct mapper_hash_table *t = m->hash[key_type].tbl;
+	uint32_t i, n = 0;
+
+	for (i = 0; i <= t->mask; i++)
+		if (t->dist[i])
+			keys[n++] = t->slot[i].key;
+
+	/* the table has no order, sort on demand */
+	qsort(keys, n, sizeof(*keys), key_cmp);
+}
+
+static enum pon_adapter_errno hash_backend_next(struct mapper *m,
+						struct mapper_cursor *c,
+						uint32_t from,
+						uint32_t key[KEY_TYPE_NUM])
+{
+	uint32_t *sorted;
+	uint32_t lo, hi;
+
+	if (m->used[KEY_TYPE_ID].levels)
+		return bitmap_next(m, from, c->hi, key);
+
+	/* sort the IDs once per modification of the mapper */
+	if (!m->sorted || m->sorted_gen != m->gen) {
+		sorted = realloc(m->sorted,
+				 (m->count ? m->count : 1) * sizeof(uint32_t));
+		if (!sorted)
+			return PON_ADAPTER_ERR_NO_MEMORY;
+		m->ops->keys_get(m, KEY_TYPE_ID, sorted);
+		m->sorted = sorted;
+		m->sorted_num = m->count;
+		m->sorted_gen = m->gen;
+	}
+
+	if (c->state == MAPPER_CURSOR_RUN && c->gen == m->gen) {
+		lo = c->pos + 1;
+	} else {
+		/* first ID at or above from */
+		lo = 0;
+		hi = m->sorted_num;
+		while (lo < hi) {
+			if (m->sorted[lo + (hi - lo) / 2] < from)
+				lo = lo + (hi - lo) / 2 + 1;
+			else
+				hi = lo + (hi - lo) / 2;
+		}
+	}
+
+	if (lo >= m->sorted_num || m->sorted[lo] > c->hi)
+		return PON_ADAPTER_ERR_NOT_FOUND;
+
+	c->pos = lo;
+	key[KEY_TYPE_ID] = m->sorted[lo];
+
+	return m->ops->find(m, KEY_TYPE_ID, key, NULL);
+}
+
+/** Hash backend, used for large key ranges if selected by the entry */
+static const struct mapper_backend mapper_hash_backend = {
+	.name = "hash",
+	.init = hash_backend_init,
+	.exit = hash_backend_exit,
+	.find = hash_backend_find,
+	.add = hash_backend_add,
+	.remove = hash_backend_remove,
+	.cleanup = hash_backend_cleanup,
+	.keys_get = hash_backend_keys_get,
+	.next = hash_backend_next,
+};
+
+/** Select the backend for a mapper entry
+ *
+ * \param[in] m_entry  Mapper entry
+ *
+ * \return Backend operations
+ */
+static const struct mapper_backend *
+backend_select(const struct mapper_entry *m_entry)
+{
+	enum mapper_key_type key_type;
+
+	for (key_type = KEY_TYPE_ID; key_type < KEY_TYPE_NUM; key_type++) {
+		if (m_entry->max_key[key_type] < m_entry->min_key[key_type] ||
+		    m_entry->max_key[key_type] - m_entry->min_key[key_type] >=
+		    PA_MAPPER_DIRECT_RANGE_MAX)
+			/* list nodes can't be read while they are released */
+			return (m_entry->flags &
+				(MAPPER_FLAG_HASH | MAPPER_FLAG_CONCURRENT)) ?
+				&mapper_hash_backend : &mapper_list_backend;
+	}
+
+	return &mapper_direct_backend;
+}
+
+/** Release the storage of an empty mapper
+ *
+ * \param[in] m        Pointer to mapper
+ */
+static void mapper_release(struct mapper *m)
+{
+	enum mapper_key_type key_type;
+
+	/* caller provided storage holds all tables */
+	if (m->fixed) {
+#if MAPPER_CONCURRENT == 1
+		if (m->concurrent)
+			pthread_mutex_destroy(&m->lock);
+#endif
+		return;
+	}
+
+	for (key_type = KEY_TYPE_ID; key_type < KEY_TYPE_NUM; key_type++)
+		bitmap_exit(&m->used[key_type]);
+
+	if (m->m_entry->flags & MAPPER_FLAG_STICKY)
+		hash_exit(&m->sticky);
+
+	if (m->ops->exit)
+		m->ops->exit(m);
+#if MAPPER_CONCURRENT == 1
+	if (m->concurrent)
+		pthread_mutex_destroy(&m->lock);
+#endif
+	free(m);
+}
+
+/** Allocate a mapper element
+ *
+ * \param[in] m_entry  Mapper entry
+ * \param[in] arena    List node arena, NULL to use the heap
+ *
+ * \return
+ *    New allocated mapper or NULL on error.
+ */
+static struct mapper *mapper_create(const struct mapper_entry *m_entry,
+				    struct mapper_arena *arena)
+{
+	enum mapper_key_type key_type;
+	struct mapper *m;
+	uint32_t range;
+
+	PA_DBG_PRINT("Setup map item={%s} id=[0x%08x,0x%08x] idx=[0x%08x,0x%08x]\n",
+			m_entry->name,
+			m_entry->min_key[KEY_TYPE_ID],
+			m_entry->max_key[KEY_TYPE_ID],
+			m_entry->min_key[KEY_TYPE_INDEX],
+			m_entry->max_key[KEY_TYPE_INDEX]);
+
+#if MAPPER_CONCURRENT == 0
+	if (m_entry->flags & MAPPER_FLAG_CONCURRENT) {
+		PA_DBG_PRINT("%s", "Concurrent mapper mode is not supported\n");
+		return NULL;
+	}
+#endif
+
+	m = calloc(1, sizeof(struct mapper));
+	if (!m)
+		return NULL;
+
+	m->m_entry = m_entry;
+	m->ops = backend_select(m_entry);
+	m->arena = arena;
+
+#if MAPPER_CONCURRENT == 1
+	if (m_entry->flags & MAPPER_FLAG_CONCURRENT) {
+		if (pthread_mutex_init(&m->lock, NULL)) {
+			free(m);
+			return NULL;
+		}
+		m->concurrent = true;
+	}
+#endif
+
+	PA_DBG_PRINT("Map item={%s} uses %s backend\n", m_entry->name,
+		     m->ops->name);
+
+	if (m->ops->init(m) != PON_ADAPTER_SUCCESS) {
+#if MAPPER_CONCURRENT == 1
+		if (m->concurrent)
+			pthread_mutex_destroy(&m->lock);
+#endif
+		free(m);
+		return NULL;
+	}
+
+	for (key_type = KEY_TYPE_ID; key_type < KEY_TYPE_NUM; key_type++) {
+		range = m_entry->max_key[key_type] - m_entry->min_key[key_type];
+		if (m_entry->max_key[key_type] < m_entry->min_key[key_type] ||
+		    range >= PA_MAPPER_BITMAP_RANGE_MAX)
+			continue;
+
+		if (bitmap_init(&m->used[key_type], range + 1) !=
+		    PON_ADAPTER_SUCCESS) {
+			PA_DBG_PRINT("%s", "Not enough memory for mapper bitmap\n");
+			mapper_release(m);
+			return NULL;
+		}
+	}
+
+	/* hints are only used by the writer, no need to retire tables */
+	if ((m_entry->flags & MAPPER_FLAG_STICKY) &&
+	    hash_init(&m->sticky, MAPPER_HASH_SLOTS_MIN, false) !=
+	    PON_ADAPTER_SUCCESS) {
+		PA_DBG_PRINT("%s", "Not enough memory for mapper hints\n");
+		mapper_release(m);
+		return NULL;
+	}
+
+	return m;
+}
+
+struct mapper *mapper_alloc(const struct mapper_entry *m_entry)
+{
+	return mapper_create(m_entry, NULL);
+}
+
+/** Take words from caller provided storage
+ *
+ * \param[in,out] storage  Storage, advanced behind the taken words
+ * \param[in,out] left     Number of words left in the storage
+ * \param[in]     num      Number of words to take
+ *
+ * \return Cleared words or NULL if the storage is too small
+ */
+static uint64_t *storage_take(uint64_t **storage, size_t *left, size_t num)
+{
+	uint64_t *words = *storage;
+
+	if (num > *left)
+		return NULL;
+
+	memset(words, 0, num * sizeof(*words));
+	*storage += num;
+	*left -= num;
+
+	return words;
+}
+
+/** Create a mapper in caller provided storage
+ *
+ * Only mappers which use the direct backend and keep no sticky hints can be
+ * placed in fixed storage, all other backends need the heap.
+ *
+ * \param[in]     m_entry  Mapper entry
+ * \param[in,out] storage  Storage, advanced behind the used words
+ * \param[in,out] left     Number of words left in the storage
+ *
+ * \return
+ *    New mapper or NULL on error.
+ */
+static struct mapper *mapper_create_fixed(const struct mapper_entry *m_entry,
+					  uint64_t **storage, size_t *left)
+{
+	enum mapper_key_type key_type;
+	struct mapper *m;
+	uint32_t range;
+
+	if (backend_select(m_entry) != &mapper_direct_backend ||
+	    (m_entry->flags & MAPPER_FLAG_STICKY)) {
+		PA_DBG_PRINT("Map item={%s} can't use fixed storage\n",
+			     m_entry->name);
+		return NULL;
+	}
+
+#if MAPPER_CONCURRENT == 0
+	if (m_entry->flags & MAPPER_FLAG_CONCURRENT) {
+		PA_DBG_PRINT("%s", "Concurrent mapper mode is not supported\n");
+		return NULL;
+	}
+#endif
+
+	m = (struct mapper *)storage_take(storage, left,
+					  PA_MAPPER_STATIC_HDR_WORDS);
+	if (!m)
+		return NULL;
+
+	m->m_entry = m_entry;
+	m->ops = &mapper_direct_backend;
+	m->fixed = true;
+
+	for (key_type = KEY_TYPE_ID; key_type < KEY_TYPE_NUM; key_type++) {
+		range = direct_range(m, key_type);
+		m->direct[key_type] = (uint32_t *)storage_take(storage, left,
+							       (range + 1) / 2);
+		if (!m->direct[key_type])
+			return NULL;
+
+		m->used[key_type].level[0] =
+			storage_take(storage, left,
+				     bitmap_size(&m->used[key_type], range));
+		if (!m->used[key_type].level[0])
+			return NULL;
+		bitmap_attach(&m->used[key_type], m->used[key_type].level[0]);
+	}
+
+#if MAPPER_CONCURRENT == 1
+	if (m_entry->flags & MAPPER_FLAG_CONCURRENT) {
+		if (pthread_mutex_init(&m->lock, NULL))
+			return NULL;
+		m->concurrent = true;
+	}
+#endif
+
+	return m;
+}
+
+/** Serialize a call with the writers of the mapper
+ *
+ * For functions which only read the mappings, the sequence counter is left
+ * unchanged so that concurrent lookups don't retry.
+ *
+ * \param[in] m        Pointer to mapper
+ */
+static void mapper_lock(struct mapper *m)
+{
+#if MAPPER_CONCURRENT == 1
+	if (m && m->concurrent)
+		pthread_mutex_lock(&m->lock);
+#else
+	(void)m;
+#endif
+}
+
+/** Finish a call started by mapper_lock()
+ *
+ * \param[in] m        Pointer to mapper
+ */
+static void mapper_unlock(struct mapper *m)
+{
+#if MAPPER_CONCURRENT == 1
+	if (m && m->concurrent)
+		pthread_mutex_unlock(&m->lock);
+#else
+	(void)m;
+#endif
+}
+
+/** Start the table updates of a call which holds the lock
+ *
+ * In concurrent mode the sequence counter is made odd, so that readers
+ * wait for the end of the modification and retry their lookup.
+ *
+ * \param[in] m        Pointer to mapper
+ */
+static void mapper_modify_begin(struct mapper *m)
+{
+#if MAPPER_CONCURRENT == 1
+	if (!m || !m->concurrent)
+		return;
+
+	__atomic_store_n(&m->seq, m->seq + 1, __ATOMIC_RELAXED);
+	/* order the counter update before the table updates */
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+#else
+	(void)m;
+#endif
+}
+
+/** Finish the table updates started by mapper_modify_begin()
+ *
+ * \param[in] m        Pointer to mapper
+ */
+static void mapper_modify_end(struct mapper *m)
+{
+#if MAPPER_CONCURRENT == 1
+	if (m && m->concurrent)
+		__atomic_store_n(&m->seq, m->seq + 1, __ATOMIC_RELEASE);
+#else
+	(void)m;
+#endif
+}
+
+/** Start a modification of the mapper
+ *
+ * In concurrent mode the writers are serialized, see
+ * mapper_modify_begin() for the readers.
+ *
+ * \param[in] m        Pointer to mapper
+ */
+static void mapper_write_begin(struct mapper *m)
+{
+	mapper_lock(m);
+	mapper_modify_begin(m);
+}
+
+/** Finish a modification of the mapper
+ *
+ * \param[in] m        Pointer to mapper
+ */
+static void mapper_write_end(struct mapper *m)
+{
+	mapper_modify_end(m);
+	mapper_unlock(m);
+}
+
+/** Account lookups in the mapper statistics
+ *
+ * \param[in] m        Pointer to mapper
+ * \param[in] num      Number of lookups
+ * \param[in] steps    Sum of the search steps of the lookups
+ * \param[in] max      Maximum search steps of one lookup
+ *
+ * The caller of a concurrent mapper holds the lock.
+ */
+static void lookup_count(struct mapper *m, uint32_t num, uint32_t steps,
+			 uint32_t max)
+{
+	struct mapper_counters *c = &m->cnt;
+
+	c->lookup += num;
+	c->search_steps += steps;
+	if (max > c->search_max)
+		c->search_max = max;
+}
+
+/** Find a mapping, safe against concurrent writers in concurrent mode
+ *
+ * \param[in]     m        Pointer to mapper
+ * \param[in]     key_type Type of the key to search for
+ * \param[in,out] key      Key array, the other key is returned
+ *
+ * \return
+ *    - PON_ADAPTER_SUCCESS       Mapping was found
+ *    - PON_ADAPTER_ERR_NOT_FOUND Key is not mapped
+ */
+static enum pon_adapter_errno mapping_find(struct mapper *m,
+					   enum mapper_key_type key_type,
+					   uint32_t key[KEY_TYPE_NUM])
+{
+	enum pon_adapter_errno ret;
+	uint32_t steps = 0;
+#if MAPPER_CONCURRENT == 1
+	uint32_t seq;
+
+	if (m->concurrent) {
+		/* the backend tables are never released while the mapper
+		 * exists, so a lookup racing with a writer only needs to be
+		 * repeated. While a modification is in progress (odd counter)
+		 * the lookup waits for the writer to finish.
+		 */
+		for (;;) {
+			seq = __atomic_load_n(&m->seq, __ATOMIC_ACQUIRE);
+			if (seq & 1) {
+				sched_yield();
+				continue;
+			}
+			ret = m->ops->find(m, key_type, key, &steps);
+			__atomic_thread_fence(__ATOMIC_ACQUIRE);
+			if (__atomic_load_n(&m->seq, __ATOMIC_RELAXED) == seq)
+				break;
+		}
+		/* not counted, a shared counter would make every reader
+		 * write the cache line which all readers poll
+		 */
+		return ret;
+	}
+#endif
+	ret = m->ops->find(m, key_type, key, &steps);
+	lookup_count(m, 1, steps, steps);
+
+	return ret;
+}
+
+/** Remove all mappings
+ *
+ * \param[in] m        Pointer to mapper
+ * \param[in] release  Release every list node, false if the node arena of
+ *                     the mapper is reset afterwards
+ *
+ * \return
+ *    - PON_ADAPTER_SUCCESS Mappings were removed
+ *    - PON_ADAPTER_ERROR   Cleanup failed
+ */
+static enum pon_adapter_errno mapper_clear(struct mapper *m, bool release)
+{
+	enum pon_adapter_errno ret;
+	enum mapper_key_type key_type;
+
+	if (m) {
+		mapper_write_begin(m);
+		ret = m->ops->cleanup(m, release);
+		if (ret == PON_ADAPTER_SUCCESS) {
+			for (key_type = KEY_TYPE_ID; key_type < KEY_TYPE_NUM;
+			     key_type++)
+				bitmap_clear(&m->used[key_type]);
+
+			m->cnt.unmap += m->count;
+			m->count = 0;
+			m->gen++;
+		}
+		mapper_write_end(m);
+
+		return ret;
+	}
+
+	return PON_ADAPTER_ERROR;
+}
+
+enum pon_adapter_errno mapper_sticky_clear(struct mapper *m)
+{
+	if (!m || !(m->m_entry->flags & MAPPER_FLAG_STICKY))
+		return PON_ADAPTER_ERROR;
+
+	mapper_write_begin(m);
+	hash_clear(&m->sticky);
+	mapper_write_end(m);
+
+	return PON_ADAPTER_SUCCESS;
+}
+
+enum pon_adapter_errno mapper_cleanup(struct mapper *m)
+{
+	return mapper_clear(m, true);
+}
+
+enum pon_adapter_errno mapper_free(struct mapper *m)
+{
+	enum pon_adapter_errno ret;
+
+	ret = mapper_cleanup(m);
+	if (ret != PON_ADAPTER_SUCCESS)
+		return ret;
+
+	mapper_release(m);
+
+	return PON_ADAPTER_SUCCESS;
+}
+
+/** Retrieve the last index of an ID if it is free again
+ *
+ * \param[in]  m        Pointer to mapper
+ * \param[in]  id       ID
+ * \param[out] idx      Previous index of the ID
+ *
+ * \return true if the previous index can be used
+ */
+static bool sticky_get(struct mapper *m, uint32_t id, uint32_t *idx)
+{
+	const struct mapper_hash_slot *slot;
+	uint32_t key[KEY_TYPE_NUM];
+
+	slot = hash_find(&m->sticky, id, NULL);
+	if (!slot)
+		return false;
+
+	*idx = slot->val;
+	if (m->used[KEY_TYPE_INDEX].levels)
+		return !bitmap_test(&m->used[KEY_TYPE_INDEX],
+				    *idx - m->m_entry->min_key[KEY_TYPE_INDEX]);
+
+	key[KEY_TYPE_INDEX] = *idx;
+
+	return m->ops->find(m, KEY_TYPE_INDEX, key, NULL) ==
+		PON_ADAPTER_ERR_NOT_FOUND;
+}
+
+/** Remember the index of an ID for later mappings
+ *
+ * \param[in] m        Pointer to mapper
+ * \param[in] id       ID
+ * \param[in] idx      Index
+ */
+static void sticky_set(struct mapper *m, uint32_t id, uint32_t idx)
+{
+	struct mapper_hash_slot *slot;
+
+	slot = hash_find(&m->sticky, id, NULL);
+	if (slot) {
+		slot->val = idx;
+		return;
+	}
+
+	/* a missing hint only affects the choice of the index */
+	if (hash_insert(&m->sticky, id, idx) != PON_ADAPTER_SUCCESS)
+		PA_DBG_PRINT("No memory for index hint of %u, item {%s}\n",
+			     id, m->m_entry->name);
+}
+
+/** Store a new mapping without updating the index hint of the ID
+ *
+ * \param[in]     m          Pointer to mapper
+ * \param[in]     alloc_type Type of the key to allocate,
+ *                           KEY_TYPE_NUM to allocate none
+ * \param[in,out] key        Key array
+ *
+ * The caller holds the writer lock. Used directly by operations which map
+ * several IDs at once and set the hints only if all IDs were mapped.
+ *
+ * \return
+ *    - PON_ADAPTER_SUCCESS Mapping was stored
+ *    - PON_ADAPTER_ERROR   Mapping failed
+ */
+static enum pon_adapter_errno mapping_store(struct mapper *m,
+					     enum mapper_key_type alloc_type,
+					     uint32_t key[KEY_TYPE_NUM])
+{
+	enum pon_adapter_errno ret;
+	enum mapper_key_type key_type;
+	uint32_t off;
+
+	for (key_type = KEY_TYPE_ID; key_type < KEY_TYPE_NUM; key_type++) {
+		if (key_type == alloc_type)
+			continue;
+		ret = key_verify(m, key_type, key[key_type]);
+		if (ret != PON_ADAPTER_SUCCESS)
+			return PON_ADAPTER_ERROR;
+	}
+
+	/* prefer the index which was used for the ID before */
+	if (alloc_type == KEY_TYPE_INDEX &&
+	    (m->m_entry->flags & MAPPER_FLAG_STICKY) &&
+	    sticky_get(m, key[KEY_TYPE_ID], &key[KEY_TYPE_INDEX]))
+		alloc_type = KEY_TYPE_NUM;
+
+	if (alloc_type != KEY_TYPE_NUM && m->used[alloc_type].levels) {
+		ret = bitmap_free_find(&m->used[alloc_type], &off);
+		if (ret != PON_ADAPTER_SUCCESS) {
+			PA_DBG_PRINT("No free key for type %d, name %s\n",
+				     alloc_type, m->m_entry->name);
+			m->cnt.alloc_fail++;
+			return PON_ADAPTER_ERROR;
+		}
+		key[alloc_type] = m->m_entry->min_key[alloc_type] + off;
+		alloc_type = KEY_TYPE_NUM;
+	}
+
+	ret = m->ops->add(m, alloc_type, key);
+	if (ret != PON_ADAPTER_SUCCESS) {
+		if (ret == PON_ADAPTER_ERR_NOT_FOUND ||
+		    ret == PON_ADAPTER_ERR_NO_MEMORY)
+			m->cnt.alloc_fail++;
+		return PON_ADAPTER_ERROR;
+	}
+
+	for (key_type = KEY_TYPE_ID; key_type < KEY_TYPE_NUM; key_type++)
+		if (m->used[key_type].levels)
+			bitmap_set(&m->used[key_type], key[key_type] -
+				   m->m_entry->min_key[key_type]);
+
+	m->count++;
+	m->gen++;
+	m->cnt.map++;
+	if (m->count > m->cnt.peak)
+		m->cnt.peak = m->count;
+
+	return PON_ADAPTER_SUCCESS;
+}
+
+/** Store a new mapping
+ *
+ * \param[in]     m          Pointer to mapper
+ * \param[in]     alloc_type Type of the key to allocate,
+ *                           KEY_TYPE_NUM to allocate none
+ * \param[in,out] key        Key array
+ *
+ * The caller holds the writer lock.
+ *
+ * \return
+ *    - PON_ADAPTER_SUCCESS Mapping was stored
+ *    - PON_ADAPTER_ERROR   Mapping failed
+ */
+static enum pon_adapter_errno mapping_insert(struct mapper *m,
+					     enum mapper_key_type alloc_type,
+					     uint32_t key[KEY_TYPE_NUM])
+{
+	enum pon_adapter_errno ret;
+
+	ret = mapping_store(m, alloc_type, key);
+	if (ret == PON_ADAPTER_SUCCESS &&
+	    (m->m_entry->flags & MAPPER_FLAG_STICKY))
+		sticky_set(m, key[KEY_TYPE_ID], key[KEY_TYPE_INDEX]);
+
+	return ret;
+}
+
+/** Store a new mapping
+ *
+ * \param[in]     m          Pointer to mapper
+ * \param[in]     alloc_type Type of the key to allocate,
+ *                           KEY_TYPE_NUM to allocate none
+ * \param[in,out] key        Key array
+ *
+ * \return
+ *    - PON_ADAPTER_SUCCESS Mapping was stored
+ *    - PON_ADAPTER_ERROR   Mapping failed
+ */
+static enum pon_adapter_errno mapping_add(struct mapper *m,
+					  enum mapper_key_type alloc_type,
+					  uint32_t key[KEY_TYPE_NUM])
+{
+	enum pon_adapter_errno ret;
+
+	mapper_write_begin(m);
+	ret = mapping_insert(m, alloc_type, key);
+	mapper_write_end(m);
+
+	return ret;
+}
+
+enum pon_adapter_errno mapper_explicit_map(struct mapper *m,
+					   uint32_t id,
+					   uint32_t idx)
+{
+	uint32_t key[KEY_TYPE_NUM] = { 0 };
+
+	PA_DBG_PRINT("%s(%u, %u)\n", __func__, id, idx);
+
+	key[KEY_TYPE_ID] = id;
+	key[KEY_TYPE_INDEX] = idx;
+
+	return mapping_add(m, KEY_TYPE_NUM, key);
+}
+
+enum pon_adapter_errno mapper_id_map(struct mapper *m,
+				     uint32_t id,
+				     uint32_t *idx)
+{
+	enum pon_adapter_errno ret;
+	uint32_t key[KEY_TYPE_NUM] = { 0 };
+
+	PA_DBG_PRINT("%s(%u, %p) item {%s}\n", __func__, id, idx,
+		     m->m_entry->name);
+
+	key[KEY_TYPE_ID] = id;
+
+	ret = mapping_add(m, KEY_TYPE_INDEX, key);
+	if (ret != PON_ADAPTER_SUCCESS)
+		return ret;
+
+	*idx = key[KEY_TYPE_INDEX];
+
+	return PON_ADAPTER_SUCCESS;
+}
+
+enum pon_adapter_errno mapper_index_map(struct mapper *m,
+					uint32_t *id,
+					uint32_t idx)
+{
+	enum pon_adapter_errno ret;
+	uint32_t key[KEY_TYPE_NUM] = { 0 };
+
+	PA_DBG_PRINT("%s(%p, %u) item {%s}\n", __func__, id, idx,
+		     m->m_entry->name);
+
+	key[KEY_TYPE_INDEX] = idx;
+
+	ret = mapping_add(m, KEY_TYPE_ID, key);
+	if (ret != PON_ADAPTER_SUCCESS)
+		return ret;
+
+	*id = key[KEY_TYPE_ID];
+
+	return PON_ADAPTER_SUCCESS;
+}
+
+enum pon_adapter_errno mapper_index_get(struct mapper *m,
+					uint32_t id,
+					uint32_t *idx)
+{
+	enum pon_adapter_errno ret = PON_ADAPTER_SUCCESS;
+	uint32_t key[KEY_TYPE_NUM] = { 0 };
+
+	PA_DBG_PRINT("%s(%u, %p) item {%s}\n", __func__, id, idx,
+		     m->m_entry->name);
+
+	ret = key_verify(m, KEY_TYPE_ID, id);
+	if (ret != PON_ADAPTER_SUCCESS)
+		return PON_ADAPTER_ERROR;
+
+	key[KEY_TYPE_ID] = id;
+
+	ret = mapping_find(m, KEY_TYPE_ID, key);
+	if (ret == PON_ADAPTER_ERR_NOT_FOUND) {
+		PA_DBG_PRINT("Id %d is not found (index_get), item {%s}\n",
+			id, m->m_entry->name);
+		return PON_ADAPTER_ERR_NOT_FOUND;
+	} else if (ret != PON_ADAPTER_SUCCESS) {
+		PA_DBG_PRINT("Id %d searching error %d (index_get), item {%s}\n",
+				   id, ret, m->m_entry->name);
+		return PON_ADAPTER_ERROR;
+	}
+
+	*idx = key[KEY_TYPE_INDEX];
+
+	return PON_ADAPTER_SUCCESS;
+}
+
+enum pon_adapter_errno mapper_id_get(struct mapper *m,
+				     uint32_t *id,
+				     uint32_t idx)
+{
+	enum pon_adapter_errno ret = PON_ADAPTER_SUCCESS;
+	uint32_t key[KEY_TYPE_NUM] = { 0 };
+
+	PA_DBG_PRINT("%s(%p, %u)\n", __func__, id, idx);
+
+	ret = key_verify(m, KEY_TYPE_INDEX, idx);
+	if (ret != PON_ADAPTER_SUCCESS)
+		return PON_ADAPTER_ERROR;
+
+	key[KEY_TYPE_INDEX] = idx;
+
+	ret = mapping_find(m, KEY_TYPE_INDEX, key);
+	if (ret == PON_ADAPTER_ERR_NOT_FOUND) {
+		PA_DBG_PRINT("Index %d is not found (id_get)\n", idx);
+		return PON_ADAPTER_ERR_NOT_FOUND;
+	} else if (ret != PON_ADAPTER_SUCCESS) {
+		PA_DBG_PRINT("Index %d searching error %d (id_get)\n",
+				   idx, ret);
+		return PON_ADAPTER_ERROR;
+	}
+
+	*id = key[KEY_TYPE_ID];
+
+	return PON_ADAPTER_SUCCESS;
+}
+
+enum pon_adapter_errno mapper_index_map_or_get(struct mapper *m,
+					       const uint32_t id,
+					       uint32_t *idx)
+{
+	enum pon_adapter_errno ret;
+	uint32_t key[KEY_TYPE_NUM] = { 0 };
+	uint32_t steps = 0;
+
+	PA_DBG_PRINT("%s(%u, %p) item {%s}\n", __func__, id, idx,
+		     m->m_entry->name);
+
+	ret = key_verify(m, KEY_TYPE_ID, id);
+	if (ret != PON_ADAPTER_SUCCESS)
+		return PON_ADAPTER_ERROR;
+
+	key[KEY_TYPE_ID] = id;
+
+	/* search and map under one lock, only a new mapping makes
+	 * concurrent readers retry
+	 */
+	mapper_lock(m);
+	ret = m->ops->find(m, KEY_TYPE_ID, key, &steps);
+	lookup_count(m, 1, steps, steps);
+	if (ret == PON_ADAPTER_ERR_NOT_FOUND) {
+		mapper_modify_begin(m);
+		ret = mapping_insert(m, KEY_TYPE_INDEX, key);
+		mapper_modify_end(m);
+	}
+	mapper_unlock(m);
+	if (ret != PON_ADAPTER_SUCCESS)
+		return PON_ADAPTER_ERROR;
+
+	*idx = key[KEY_TYPE_INDEX];
+
+	return PON_ADAPTER_SUCCESS;
+}
+
+/** Retrieve the array of mapped keys of the given type
+ *
+ * \param[in]  m        Pointer to mapper
+ * \param[in]  key_type Key Type
+ * \param[out] keys     Pointer to the mapped key array
+ * \param[out] size     Size of the mapped key array
+ *
+ * \return
+ *    - PON_ADAPTER_SUCCESS Array was created
+ *    - PON_ADAPTER_ERROR   Not enough memory
+ */
+static enum pon_adapter_errno keys_array_get(struct mapper *m,
+					     enum mapper_key_type key_type,
+					     uint32_t **keys,
+					     uint32_t *size)
+{
+	enum pon_adapter_errno ret = PON_ADAPTER_SUCCESS;
+
+	mapper_lock(m);
+	if (!m->count) {
+		*keys = NULL;
+		*size = 0;
+	} else {
+		*keys = malloc(m->count * sizeof(uint32_t));
+		if (*keys) {
+			m->ops->keys_get(m, key_type, *keys);
+			*size = m->count;
+		} else {
+			PA_DBG_PRINT("Not enough memory for key array (type %d)\n",
+				     key_type);
+			ret = PON_ADAPTER_ERROR;
+		}
+	}
+	mapper_unlock(m);
+
+	return ret;
+}
+
+enum pon_adapter_errno mapper_index_array_get(struct mapper *m,
+					      uint32_t **idx,
+					      uint32_t *size)
+{
+	PA_DBG_PRINT("%s(%p, %p)\n", __func__, idx, size);
+
+	return keys_array_get(m, KEY_TYPE_INDEX, idx, size);
+}
+
+enum pon_adapter_errno mapper_id_array_get(struct mapper *m,
+					   uint32_t **id,
+					   uint32_t *size)
+{
+	PA_DBG_PRINT("%s(%p, %p)\n", __func__, id, size);
+
+	return keys_array_get(m, KEY_TYPE_ID, id, size);
+}
+
+/** Remove a mapping by one of its keys
+ *
+ * The caller holds the writer lock.
+ *
+ * \param[in]     m        Pointer to mapper
+ * \param[in]     key_type Key Type
+ * \param[in,out] keys     Key array, keys[key_type] is removed, all other
+ *                         keys are returned. All keys are given if a node
+ *                         is given.
+ * \param[in]     node     Backend node of the mapping or NULL
+ *
+ * \return
+ *    - PON_ADAPTER_SUCCESS       Mapping was removed
+ *    - PON_ADAPTER_ERR_NOT_FOUND Key is not mapped
+ *    - PON_ADAPTER_ERROR         Removal failed
+ */
+static enum pon_adapter_errno mapping_delete(struct mapper *m,
+					     enum mapper_key_type key_type,
+					     uint32_t keys[KEY_TYPE_NUM],
+					     void *node)
+{
+	enum pon_adapter_errno ret;
+	enum mapper_key_type kt;
+
+	if (node && m->ops->remove_node) {
+		m->ops->remove_node(m, node);
+	} else {
+		ret = m->ops->remove(m, key_type, keys);
+		if (ret != PON_ADAPTER_SUCCESS)
+			return ret;
+	}
+
+	for (kt = KEY_TYPE_ID; kt < KEY_TYPE_NUM; kt++)
+		if (m->used[kt].levels)
+			bitmap_clr(&m->used[kt],
+				   keys[kt] - m->m_entry->min_key[kt]);
+
+	m->count--;
+	m->gen++;
+	m->cnt.unmap++;
+
+	return PON_ADAPTER_SUCCESS;
+}
+
+/** Remove a mapping by one of its keys
+ *
+ * \param[in] m        Pointer to mapper
+ * \param[in] key_type Key Type
+ * \param[in] key      Key to remove
+ *
+ * \return
+ *    - PON_ADAPTER_SUCCESS       Mapping was removed
+ *    - PON_ADAPTER_ERR_NOT_FOUND Key is not mapped
+ *    - PON_ADAPTER_ERROR         Removal failed
+ */
+static enum pon_adapter_errno mapping_remove(struct mapper *m,
+					     enum mapper_key_type key_type,
+					     uint32_t key)
+{
+	enum pon_adapter_errno ret;
+	uint32_t keys[KEY_TYPE_NUM] = { 0 };
+
+	ret = key_verify(m, key_type, key);
+	if (ret != PON_ADAPTER_SUCCESS)
+		return PON_ADAPTER_ERROR;
+
+	keys[key_type] = key;
+
+	mapper_write_begin(m);
+	ret = mapping_delete(m, key_type, keys, NULL);
+	mapper_write_end(m);
+
+	if (ret == PON_ADAPTER_ERR_NOT_FOUND) {
+		PA_DBG_PRINT("Key %d with type %d is not found (remove)\n",
+			     key, key_type);
+		return PON_ADAPTER_ERR_NOT_FOUND;
+	} else if (ret != PON_ADAPTER_SUCCESS) {
+		PA_DBG_PRINT("Key %d with type %d searching error %d (remove)\n",
+			     key, key_type, ret);
+		return PON_ADAPTER_ERROR;
+	}
+
+	return PON_ADAPTER_SUCCESS;
+}
+
+enum pon_adapter_errno mapper_id_remove(struct mapper *m,
+					uint32_t id)
+{
+	PA_DBG_PRINT("%s(%u)\n", __func__, id);
+
+	return mapping_remove(m, KEY_TYPE_ID, id);
+}
+
+enum pon_adapter_errno mapper_index_remove(struct mapper *m,
+					   uint32_t idx)
+{
+	PA_DBG_PRINT("%s(%u)\n", __func__, idx);
+
+	return mapping_remove(m, KEY_TYPE_INDEX, idx);
+}
+
+void mapper_cursor_init(struct mapper_cursor *c, uint32_t lo, uint32_t hi)
+{
+	memset(c, 0, sizeof(*c));
+	c->lo = lo;
+	c->hi = hi;
+	c->state = lo > hi ? MAPPER_CURSOR_END : MAPPER_CURSOR_START;
+}
+
+enum pon_adapter_errno mapper_cursor_next(struct mapper *m,
+					  struct mapper_cursor *c,
+					  uint32_t *id,
+					  uint32_t *idx)
+{
+	enum pon_adapter_errno ret;
+	uint32_t key[KEY_TYPE_NUM] = { 0 };
+	uint32_t from;
+
+	if (!m || !c)
+		return PON_ADAPTER_ERROR;
+
+	if (c->state == MAPPER_CURSOR_END)
+		return PON_ADAPTER_ERR_NOT_FOUND;
+
+	if (c->state == MAPPER_CURSOR_RUN) {
+		if (c->last >= c->hi) {
+			c->state = MAPPER_CURSOR_END;
+			return PON_ADAPTER_ERR_NOT_FOUND;
+		}
+		from = c->last + 1;
+	} else {
+		from = c->lo;
+	}
+
+	mapper_lock(m);
+	ret = m->ops->next(m, c, from, key);
+	c->gen = m->gen;
+	mapper_unlock(m);
+
+	if (ret != PON_ADAPTER_SUCCESS) {
+		if (ret == PON_ADAPTER_ERR_NOT_FOUND)
+			c->state = MAPPER_CURSOR_END;
+		return ret;
+	}
+
+	c->state = MAPPER_CURSOR_RUN;
+	c->last = key[KEY_TYPE_ID];
+	if (id)
+		*id = key[KEY_TYPE_ID];
+	if (idx)
+		*idx = key[KEY_TYPE_INDEX];
+
+	return PON_ADAPTER_SUCCESS;
+}
+
+/** Find a mapping and its backend node
+ *
+ * The caller holds the lock.
+ *
+ * \param[in]     m        Pointer to mapper
+ * \param[in]     key_type Type of the key to search for
+ * \param[in,out] key      Key array, the other key is returned
+ * \param[out]    node     Backend node, NULL if the backend has none
+ *
+ * \return
+ *    - PON_ADAPTER_SUCCESS       Mapping was found
+ *    - PON_ADAPTER_ERR_NOT_FOUND Key is not mapped
+ */
+static enum pon_adapter_errno mapping_node_find(struct mapper *m,
+						enum mapper_key_type key_type,
+						uint32_t key[KEY_TYPE_NUM],
+						void **node)
+{
+	*node = NULL;
+
+	if (m->ops->find_node)
+		return m->ops->find_node(m, key_type, key, node);
+
+	return m->ops->find(m, key_type, key, NULL);
+}
+
+enum pon_adapter_errno mapper_handle_map_or_get(struct mapper *m,
+						uint32_t id,
+						struct mapper_handle *h)
+{
+	enum pon_adapter_errno ret;
+	uint32_t key[KEY_TYPE_NUM] = { 0 };
+	void *node;
+
+	PA_DBG_PRINT("%s(%u, %p)\n", __func__, id, h);
+
+	if (!h || key_verify(m, KEY_TYPE_ID, id) != PON_ADAPTER_SUCCESS)
+		return PON_ADAPTER_ERROR;
+
+	key[KEY_TYPE_ID] = id;
+
+	/* like mapper_index_map_or_get, a hit doesn't disturb readers */
+	mapper_lock(m);
+	ret = mapping_node_find(m, KEY_TYPE_ID, key, &node);
+	if (ret == PON_ADAPTER_ERR_NOT_FOUND) {
+		mapper_modify_begin(m);
+		ret = mapping_insert(m, KEY_TYPE_INDEX, key);
+		mapper_modify_end(m);
+		if (ret == PON_ADAPTER_SUCCESS)
+			ret = mapping_node_find(m, KEY_TYPE_ID, key, &node);
+	}
+	mapper_unlock(m);
+	if (ret != PON_ADAPTER_SUCCESS)
+		return PON_ADAPTER_ERROR;
+
+	h->key[KEY_TYPE_ID] = key[KEY_TYPE_ID];
+	h->key[KEY_TYPE_INDEX] = key[KEY_TYPE_INDEX];
+	h->node = node;
+	h->mapped = true;
+
+	return PON_ADAPTER_SUCCESS;
+}
+
+enum pon_adapter_errno mapper_handle_id_get(const struct mapper_handle *h,
+					    uint32_t *id)
+{
+	if (!h || !h->mapped)
+		return PON_ADAPTER_ERROR;
+
+	*id = h->key[KEY_TYPE_ID];
+
+	return PON_ADAPTER_SUCCESS;
+}
+
+enum pon_adapter_errno mapper_handle_index_get(const struct mapper_handle *h,
+					       uint32_t *idx)
+{
+	if (!h || !h->mapped)
+		return PON_ADAPTER_ERROR;
+
+	*idx = h->key[KEY_TYPE_INDEX];
+
+	return PON_ADAPTER_SUCCESS;
+}
+
+enum pon_adapter_errno mapper_handle_remove(struct mapper *m,
+					    struct mapper_handle *h)
+{
+	enum pon_adapter_errno ret;
+	uint32_t key[KEY_TYPE_NUM];
+
+	PA_DBG_PRINT("%s(%p)\n", __func__, h);
+
+	if (!m || !h || !h->mapped)
+		return PON_ADAPTER_ERROR;
+
+	key[KEY_TYPE_ID] = h->key[KEY_TYPE_ID];
+	key[KEY_TYPE_INDEX] = h->key[KEY_TYPE_INDEX];
+
+	mapper_write_begin(m);
+	ret = mapping_delete(m, KEY_TYPE_ID, key, h->node);
+	mapper_write_end(m);
+	if (ret != PON_ADAPTER_SUCCESS)
+		return ret;
+
+	h->node = NULL;
+	h->mapped = false;
+
+	return PON_ADAPTER_SUCCESS;
+}
+
+enum pon_adapter_errno mapper_stats_get(struct mapper *m,
+				       struct mapper_stats *stats)
+{
+	if (!stats)
+		return PON_ADAPTER_ERROR;
+
+	memset(stats, 0, sizeof(*stats));
+	if (!m)
+		return PON_ADAPTER_ERROR;
+
+	mapper_lock(m);
+	stats->live = m->count;
+	stats->peak = m->cnt.peak;
+	stats->alloc_fail = m->cnt.alloc_fail;
+	stats->map = m->cnt.map;
+	stats->unmap = m->cnt.unmap;
+	stats->lookup = m->cnt.lookup;
+	stats->search_steps = m->cnt.search_steps;
+	stats->search_max = m->cnt.search_max;
+	mapper_unlock(m);
+
+	if (stats->lookup)
+		stats->search_avg = (uint32_t)((stats->search_steps +
+						stats->lookup / 2) /
+					       stats->lookup);
+
+	return PON_ADAPTER_SUCCESS;
+}
+
+/** Multi-key mapper row number of an unused row */
+#define MAPPER_MULTI_ROW_NONE UINT32_MAX
+
+/** Minimum number of rows of a multi-key mapper */
+#define MAPPER_MULTI_ROWS_MIN 16
+
+/** Multi-key mapper definition
+ *
+ * Every mapping is a row of key_num keys. One hash per key type maps a key
+ * to its row, so that a mapping is found by any of its keys with a single
+ * lookup.
+ */
+struct mapper_multi {
+	/** Mapper entry */
+	const struct mapper_multi_entry *m_entry;
+	/** Key to row number hash per key type */
+	struct mapper_hash hash[MAPPER_MULTI_KEY_MAX];
+	/** Used key bitmap per key type, kept for key ranges up to
+	 *  PA_MAPPER_BITMAP_RANGE_MAX
+	 */
+	struct mapper_bitmap used[MAPPER_MULTI_KEY_MAX];
+	/** Row storage, key_num keys per row */
+	uint32_t *rows;
+	/** Number of allocated rows */
+	uint32_t row_num;
+	/** Number of rows which were ever used */
+	uint32_t row_top;
+	/** First unused row below row_top, unused rows are chained through
+	 *  their first key
+	 */
+	uint32_t row_free;
+	/** Number of mappings */
+	uint32_t count;
+};
+
+/** Retrieve the keys of a multi-key mapper row
+ *
+ * \param[in] m        Pointer to multi-key mapper
+ * \param[in] row      Row number
+ *
+ * \return Pointer to the keys of the row
+ */
+static inline uint32_t *multi_row(const struct mapper_multi *m, uint32_t row)
+{
+	return &m->rows[(size_t)row * m->m_entry->key_num];
+}
+
+/** Take an unused row, growing the row storage if required
+ *
+ * \param[in]  m        Pointer to multi-key mapper
+ * \param[out] row      Row number
+ *
+ * \return
+ *    - PON_ADAPTER_SUCCESS       Row was taken
+ *    - PON_ADAPTER_ERR_NO_MEMORY Not enough memory
+ */
+static enum pon_adapter_errno multi_row_take(struct mapper_multi *m,
+					     uint32_t *row)
+{
+	uint32_t *rows, num;
+
+	if (m->row_free != MAPPER_MULTI_ROW_NONE) {
+		*row = m->row_free;
+		m->row_free = multi_row(m, *row)[0];
+		return PON_ADAPTER_SUCCESS;
+	}
+
+	if (m->row_top == m->row_num) {
+		num = m->row_num ? m->row_num * 2 : MAPPER_MULTI_ROWS_MIN;
+		if (num <= m->row_num)
+			return PON_ADAPTER_ERR_NO_MEMORY;
+		rows = realloc(m->rows, (size_t)num * m->m_entry->key_num *
+			       sizeof(*rows));
+		if (!rows)
+			return PON_ADAPTER_ERR_NO_MEMORY;
+		m->rows = rows;
+		m->row_num = num;
+	}
+
+	*row = m->row_top++;
+
+	return PON_ADAPTER_SUCCESS;
+}
+
+/** Return a row to the unused rows
+ *
+ * \param[in] m        Pointer to multi-key mapper
+ * \param[in] row      Row number
+ */
+static void multi_row_put(struct mapper_multi *m, uint32_t row)
+{
+	multi_row(m, row)[0] = m->row_free;
+	m->row_free = row;
+}
+
+/** Remove the keys of a row from the hashes and bitmaps
+ *
+ * \param[in] m        Pointer to multi-key mapper
+ * \param[in] keys     Keys of the row
+ * \param[in] num      Number of key types to remove, starting at the first
+ */
+static void multi_keys_remove(struct mapper_multi *m, const uint32_t *keys,
+			      uint32_t num)
+{
+	const struct mapper_multi_entry *e = m->m_entry;
+	struct mapper_hash_slot *slot;
+	uint32_t kt;
+
+	for (kt = 0; kt < num; kt++) {
+		slot = hash_find(&m->hash[kt], keys[kt], NULL);
+		if (slot)
+			hash_remove(&m->hash[kt], slot);
+		if (m->used[kt].levels)
+			bitmap_clr(&m->used[kt], keys[kt] - e->min_key[kt]);
+	}
+}
+
+enum pon_adapter_errno mapper_multi_free(struct mapper_multi *m)
+{
+	uint32_t kt;
+
+	if (!m)
+		return PON_ADAPTER_ERROR;
+
+	for (kt = 0; kt < MAPPER_MULTI_KEY_MAX; kt++) {
+		if (m->hash[kt].tbl)
+			hash_exit(&m->hash[kt]);
+		bitmap_exit(&m->used[kt]);
+	}
+	free(m->rows);
+	free(m);
+
+	return PON_ADAPTER_SUCCESS;
+}
+
+struct mapper_multi *
+mapper_multi_alloc(const struct mapper_multi_entry *m_entry)
+{
+	struct mapper_multi *m;
+	uint32_t kt;
+
+	if (!m_entry || !m_entry->key_num ||
+	    m_entry->key_num > MAPPER_MULTI_KEY_MAX)
+		return NULL;
+
+	for (kt = 0; kt < m_entry->key_num; kt++)
+		if (m_entry->max_key[kt] < m_entry->min_key[kt])
+			return NULL;
+
+	m = calloc(1, sizeof(*m));
+	if (!m)
+		return NULL;
 
-	ret = item_find(m, KEY_TYPE_ID, id, &item_pos[KEY_TYPE_ID]);
-	if (ret == PON_ADAPTER_SUCCESS) {
-		PA_DBG_PRINT("Id %d is already mapped for item {%s}\n",
-			     id, m->m_entry->name);
-		return PON_ADAPTER_ERROR;
+	m->m_entry = m_entry;
+	m->row_free = MAPPER_MULTI_ROW_NONE;
+
+	for (kt = 0; kt < m_entry->key_num; kt++) {
+		if (hash_init(&m->hash[kt], MAPPER_HASH_SLOTS_MIN, false) !=
+		    PON_ADAPTER_SUCCESS ||
+		    (m_entry->max_key[kt] - m_entry->min_key[kt] <
+		     PA_MAPPER_BITMAP_RANGE_MAX &&
+		     bitmap_init(&m->used[kt], m_entry->max_key[kt] -
+				 m_entry->min_key[kt] + 1) !=
+		     PON_ADAPTER_SUCCESS)) {
+			PA_DBG_PRINT("%s", "Not enough memory for mapper\n");
+			mapper_multi_free(m);
+			return NULL;
+		}
 	}
 
-	ret = free_key_find(m, KEY_TYPE_INDEX, idx, &item_pos[KEY_TYPE_INDEX]);
-	if (ret != PON_ADAPTER_SUCCESS)
-		return PON_ADAPTER_ERROR;
+	return m;
+}
 
-	key[KEY_TYPE_ID] = id;
-	key[KEY_TYPE_INDEX] = *idx;
+enum pon_adapter_errno mapper_multi_cleanup(struct mapper_multi *m)
+{
+	uint32_t kt;
 
-	ret = item_create(key, &item);
-	if (ret != PON_ADAPTER_SUCCESS)
+	if (!m)
 		return PON_ADAPTER_ERROR;
 
-	ret = item_add(m, item_pos, item);
-	if (ret != PON_ADAPTER_SUCCESS)
-		return PON_ADAPTER_ERROR;
+	for (kt = 0; kt < m->m_entry->key_num; kt++) {
+		hash_clear(&m->hash[kt]);
+		bitmap_clear(&m->used[kt]);
+	}
+	m->row_top = 0;
+	m->row_free = MAPPER_MULTI_ROW_NONE;
+	m->count = 0;
 
 	return PON_ADAPTER_SUCCESS;
 }
 
-enum pon_adapter_errno mapper_index_map(struct mapper *m,
-					uint32_t *id,
-					uint32_t idx)
+enum pon_adapter_errno mapper_multi_map(struct mapper_multi *m,
+					uint32_t *keys,
+					uint32_t alloc)
 {
-	enum pon_adapter_errno ret = PON_ADAPTER_SUCCESS;
-	struct mapper_map_list *item_pos[KEY_TYPE_NUM] = { NULL };
-	struct mapper_map_list *item = NULL;
-	uint32_t key[KEY_TYPE_NUM] = { 0 };
-
-	PA_DBG_PRINT("%s(%p, %u) item {%s}\n", __func__, id, idx,
-		     m->m_entry->name);
+	const struct mapper_multi_entry *e;
+	enum pon_adapter_errno ret;
+	uint32_t kt, off, row;
 
-	ret = key_verify(m, KEY_TYPE_INDEX, idx);
-	if (ret != PON_ADAPTER_SUCCESS)
+	if (!m || !keys)
 		return PON_ADAPTER_ERROR;
 
-	ret = item_find(m, KEY_TYPE_INDEX, idx, &item_pos[KEY_TYPE_INDEX]);
-	if (ret == PON_ADAPTER_SUCCESS) {
-		PA_DBG_PRINT("Index %d is already mapped for item {%s}\n",
-			idx, m->m_entry->name);
-		return PON_ADAPTER_ERROR;
-	}
+	e = m->m_entry;
+	PA_DBG_PRINT("%s(%p, 0x%x) item {%s}\n", __func__, keys, alloc,
+		     e->name);
 
-	ret = free_key_find(m, KEY_TYPE_ID, id, &item_pos[KEY_TYPE_ID]);
-	if (ret != PON_ADAPTER_SUCCESS)
+	if (alloc >> e->key_num)
 		return PON_ADAPTER_ERROR;
 
-	key[KEY_TYPE_ID] = *id;
-	key[KEY_TYPE_INDEX] = idx;
+	/* check and allocate all keys before anything is changed */
+	for (kt = 0; kt < e->key_num; kt++) {
+		if (alloc & (1U << kt)) {
+			if (!m->used[kt].levels ||
+			    bitmap_free_find(&m->used[kt], &off) !=
+			    PON_ADAPTER_SUCCESS) {
+				PA_DBG_PRINT("No free key for type %u, name %s\n",
+					     kt, e->name);
+				return PON_ADAPTER_ERROR;
+			}
+			keys[kt] = e->min_key[kt] + off;
+			continue;
+		}
 
-	ret = item_create(key, &item);
-	if (ret != PON_ADAPTER_SUCCESS)
-		return PON_ADAPTER_ERROR;
+		if (keys[kt] < e->min_key[kt] || keys[kt] > e->max_key[kt] ||
+		    hash_find(&m->hash[kt], keys[kt], NULL))
+			return PON_ADAPTER_ERROR;
+	}
 
-	ret = item_add(m, item_pos, item);
+	ret = multi_row_take(m, &row);
 	if (ret != PON_ADAPTER_SUCCESS)
-		return PON_ADAPTER_ERROR;
+		return ret;
+
+	for (kt = 0; kt < e->key_num; kt++) {
+		ret = hash_insert(&m->hash[kt], keys[kt], row);
+		if (ret != PON_ADAPTER_SUCCESS) {
+			/* the mapping is added for all keys or not at all */
+			multi_keys_remove(m, keys, kt);
+			multi_row_put(m, row);
+			return ret;
+		}
+		if (m->used[kt].levels)
+			bitmap_set(&m->used[kt], keys[kt] - e->min_key[kt]);
+	}
+
+	memcpy(multi_row(m, row), keys, e->key_num * sizeof(*keys));
+	m->count++;
 
 	return PON_ADAPTER_SUCCESS;
 }
 
-enum pon_adapter_errno mapper_index_get(struct mapper *m,
-					uint32_t id,
-					uint32_t *idx)
+enum pon_adapter_errno mapper_multi_get(const struct mapper_multi *m,
+					uint32_t key_type,
+					uint32_t key,
+					uint32_t *keys)
 {
-	enum pon_adapter_errno ret = PON_ADAPTER_SUCCESS;
-	struct mapper_map_list *item_pos = NULL;
-	struct mapper_map_list *item = NULL;
+	struct mapper_hash_slot *slot;
 
-	PA_DBG_PRINT("%s(%u, %p) item {%s}\n", __func__, id, idx,
-		     m->m_entry->name);
-
-	ret = key_verify(m, KEY_TYPE_ID, id);
-	if (ret != PON_ADAPTER_SUCCESS)
+	if (!m || !keys || key_type >= m->m_entry->key_num)
 		return PON_ADAPTER_ERROR;
 
-	ret = item_find(m, KEY_TYPE_ID, id, &item_pos);
-	if (ret == PON_ADAPTER_ERR_NOT_FOUND) {
-		PA_DBG_PRINT("Id %d is not found (index_get), item {%s}\n",
-			id, m->m_entry->name);
+	slot = hash_find(&m->hash[key_type], key, NULL);
+	if (!slot)
 		return PON_ADAPTER_ERR_NOT_FOUND;
-	} else if (ret != PON_ADAPTER_SUCCESS) {
-		PA_DBG_PRINT("Id %d searching error %d (index_get), item {%s}\n",
-				   id, ret, m->m_entry->name);
-		return PON_ADAPTER_ERROR;
-	}
-
-	item = item_get(m, KEY_TYPE_ID, item_pos);
-	if (!item) {
-		PA_DBG_PRINT("%s", "Id retrieving failed (index_get)\n");
-		return PON_ADAPTER_ERROR;
-	}
 
-	key_get(item, KEY_TYPE_INDEX, idx);
+	memcpy(keys, multi_row(m, slot->val),
+	       m->m_entry->key_num * sizeof(*keys));
 
 	return PON_ADAPTER_SUCCESS;
 }
 
-enum pon_adapter_errno mapper_id_get(struct mapper *m,
-				     uint32_t *id,
-				     uint32_t idx)
+enum pon_adapter_errno mapper_multi_remove(struct mapper_multi *m,
+					   uint32_t key_type,
+					   uint32_t key)
 {
-	enum pon_adapter_errno ret = PON_ADAPTER_SUCCESS;
-	struct mapper_map_list *item_pos = NULL;
-	struct mapper_map_list *item = NULL;
-
-	PA_DBG_PRINT("%s(%p, %u)\n", __func__, id, idx);
+	struct mapper_hash_slot *slot;
+	uint32_t row;
 
-	ret = key_verify(m, KEY_TYPE_INDEX, idx);
-	if (ret != PON_ADAPTER_SUCCESS)
+	if (!m || key_type >= m->m_entry->key_num)
 		return PON_ADAPTER_ERROR;
 
-	ret = item_find(m, KEY_TYPE_INDEX, idx, &item_pos);
-	if (ret == PON_ADAPTER_ERR_NOT_FOUND) {
-		PA_DBG_PRINT("Index %d is not found (id_get)\n", idx);
-		return PON_ADAPTER_ERR_NOT_FOUND;
-	} else if (ret != PON_ADAPTER_SUCCESS) {
-		PA_DBG_PRINT("Index %d searching error %d (id_get)\n",
-				   idx, ret);
-		return PON_ADAPTER_ERROR;
-	}
+	PA_DBG_PRINT("%s(%u, %u) item {%s}\n", __func__, key_type, key,
+		     m->m_entry->name);
 
-	item = item_get(m, KEY_TYPE_INDEX, item_pos);
-	if (!item) {
-		PA_DBG_PRINT("%s", "Index retrieving failed (id_get)\n");
-		return PON_ADAPTER_ERROR;
-	}
+	slot = hash_find(&m->hash[key_type], key, NULL);
+	if (!slot)
+		return PON_ADAPTER_ERR_NOT_FOUND;
 
-	key_get(item, KEY_TYPE_ID, id);
+	row = slot->val;
+	multi_keys_remove(m, multi_row(m, row), m->m_entry->key_num);
+	multi_row_put(m, row);
+	m->count--;
 
 	return PON_ADAPTER_SUCCESS;
 }
 
-enum pon_adapter_errno mapper_index_map_or_get(struct mapper *m,
-					       const uint32_t id,
-					       uint32_t *idx)
+/** Verify an array of keys
+ *
+ * \param[in] m        Pointer to mapper
+ * \param[in] key_type Key Type
+ * \param[in] keys     Keys
+ * \param[in] num      Number of keys
+ *
+ * \return
+ *    - PON_ADAPTER_SUCCESS All keys are in the range of the mapper
+ *    - PON_ADAPTER_ERROR   A key is out of range
+ */
+static enum pon_adapter_errno keys_verify(struct mapper *m,
+					  enum mapper_key_type key_type,
+					  const uint32_t *keys,
+					  uint32_t num)
 {
-	enum pon_adapter_errno ret = mapper_index_get(m, id, idx);
+	uint32_t i;
 
-	if (ret == PON_ADAPTER_ERR_NOT_FOUND)
-		ret = mapper_id_map(m, id, idx);
+	if (!m || (num && !keys))
+		return PON_ADAPTER_ERROR;
 
-	return ret;
+	for (i = 0; i < num; i++)
+		if (key_verify(m, key_type, keys[i]) != PON_ADAPTER_SUCCESS)
+			return PON_ADAPTER_ERROR;
+
+	return PON_ADAPTER_SUCCESS;
 }
 
-enum pon_adapter_errno mapper_index_array_get(struct mapper *m,
-					      uint32_t **idx,
-					      uint32_t *size)
+enum pon_adapter_errno mapper_id_map_batch(struct mapper *m,
+					   const uint32_t *id,
+					   uint32_t num,
+					   uint32_t *idx)
 {
-	struct mapper_map_list *item = NULL;
-	uint32_t sz = 0;
-	uint32_t i = 0;
-
-	PA_DBG_PRINT("%s(%p, %p)\n", __func__, idx, size);
-
-	item = m->list_head[KEY_TYPE_INDEX];
-	if (!item) {
-		*idx = NULL;
-		*size = 0;
-		return PON_ADAPTER_SUCCESS;
-	}
+	enum pon_adapter_errno ret = PON_ADAPTER_SUCCESS;
+	uint32_t key[KEY_TYPE_NUM];
+	uint64_t map, unmap;
+	uint32_t peak, i;
 
-	while (item) {
-		sz++;
-		item = item->next[KEY_TYPE_INDEX];
-	}
+	PA_DBG_PRINT("%s(%p, %u, %p)\n", __func__, id, num, idx);
 
-	*idx = malloc(sz * sizeof(uint32_t));
-	if (!(*idx)) {
-		PA_DBG_PRINT("%s", "Not enough memory for index array\n");
+	if (keys_verify(m, KEY_TYPE_ID, id, num) != PON_ADAPTER_SUCCESS ||
+	    (num && !idx))
 		return PON_ADAPTER_ERROR;
+
+	mapper_write_begin(m);
+	map = m->cnt.map;
+	unmap = m->cnt.unmap;
+	peak = m->cnt.peak;
+	/* take the list nodes of all IDs from one arena allocation, if that
+	 * fails the IDs are mapped until the node allocation fails
+	 */
+	if (m->arena && m->ops == &mapper_list_backend)
+		(void)arena_reserve(m->arena, num);
+	/* the index hints are set only after all IDs were mapped */
+	for (i = 0; i < num; i++) {
+		key[KEY_TYPE_ID] = id[i];
+		key[KEY_TYPE_INDEX] = 0;
+		ret = mapping_store(m, KEY_TYPE_INDEX, key);
+		if (ret != PON_ADAPTER_SUCCESS)
+			break;
+		idx[i] = key[KEY_TYPE_INDEX];
 	}
 
-	item = m->list_head[KEY_TYPE_INDEX];
-	while (item) {
-		(*idx)[i++] = item->key[KEY_TYPE_INDEX];
-		item = item->next[KEY_TYPE_INDEX];
+	/* map all or nothing, only the failed allocation stays counted */
+	if (ret != PON_ADAPTER_SUCCESS) {
+		PA_DBG_PRINT("Id %u can't be mapped, item {%s}\n",
+			     id[i], m->m_entry->name);
+		while (i--) {
+			key[KEY_TYPE_ID] = id[i];
+			mapping_delete(m, KEY_TYPE_ID, key, NULL);
+		}
+		m->cnt.map = map;
+		m->cnt.unmap = unmap;
+		m->cnt.peak = peak;
+		ret = PON_ADAPTER_ERROR;
+	} else if (m->m_entry->flags & MAPPER_FLAG_STICKY) {
+		for (i = 0; i < num; i++)
+			sticky_set(m, id[i], idx[i]);
 	}
-	*size = sz;
+	mapper_write_end(m);
 
-	return PON_ADAPTER_SUCCESS;
+	return ret;
 }
 
-enum pon_adapter_errno mapper_id_array_get(struct mapper *m,
-					   uint32_t **id,
-					   uint32_t *size)
+enum pon_adapter_errno mapper_index_get_batch(struct mapper *m,
+					      const uint32_t *id,
+					      uint32_t num,
+					      uint32_t *idx)
 {
-	struct mapper_map_list *item = NULL;
-	uint32_t sz = 0;
-	uint32_t i = 0;
+	enum pon_adapter_errno ret = PON_ADAPTER_SUCCESS;
+	uint32_t key[KEY_TYPE_NUM] = { 0 };
+	uint32_t steps[2] = { 0 };
+	uint32_t i;
 
-	PA_DBG_PRINT("%s(%p, %p)\n", __func__, id, size);
+	PA_DBG_PRINT("%s(%p, %u, %p)\n", __func__, id, num, idx);
 
-	item = m->list_head[KEY_TYPE_ID];
-	if (!item) {
-		*id = NULL;
-		*size = 0;
-		return PON_ADAPTER_SUCCESS;
+	if (keys_verify(m, KEY_TYPE_ID, id, num) != PON_ADAPTER_SUCCESS ||
+	    (num && !idx))
+		return PON_ADAPTER_ERROR;
+
+	/* never set for the backends of concurrent mappers */
+	if (m->ops->find_batch) {
+		ret = m->ops->find_batch(m, KEY_TYPE_ID, id, num, idx, steps);
+		lookup_count(m, num, steps[0], steps[1]);
+		return ret;
 	}
 
-	while (item) {
-		sz++;
-		item = item->next[KEY_TYPE_ID];
+	for (i = 0; i < num; i++) {
+		key[KEY_TYPE_ID] = id[i];
+		ret = mapping_find(m, KEY_TYPE_ID, key);
+		if (ret != PON_ADAPTER_SUCCESS)
+			break;
+		idx[i] = key[KEY_TYPE_INDEX];
 	}
 
-	*id = malloc(sz * sizeof(uint32_t));
-	if (!(*id)) {
-		PA_DBG_PRINT("%s", "Not enough memory for id array\n");
+	return ret;
+}
+
+enum pon_adapter_errno mapper_id_remove_batch(struct mapper *m,
+					      const uint32_t *id,
+					      uint32_t num)
+{
+	enum pon_adapter_errno ret = PON_ADAPTER_SUCCESS, err;
+	uint32_t key[KEY_TYPE_NUM];
+	uint32_t i;
+
+	PA_DBG_PRINT("%s(%p, %u)\n", __func__, id, num);
+
+	if (keys_verify(m, KEY_TYPE_ID, id, num) != PON_ADAPTER_SUCCESS)
 		return PON_ADAPTER_ERROR;
-	}
 
-	item = m->list_head[KEY_TYPE_ID];
-	while (item) {
-		(*id)[i++] = item->key[KEY_TYPE_ID];
-		item = item->next[KEY_TYPE_ID];
+	mapper_write_begin(m);
+	for (i = 0; i < num; i++) {
+		key[KEY_TYPE_ID] = id[i];
+		err = mapping_delete(m, KEY_TYPE_ID, key, NULL);
+		if (err != PON_ADAPTER_SUCCESS && ret == PON_ADAPTER_SUCCESS)
+			ret = err;
 	}
-	*size = sz;
+	mapper_write_end(m);
 
-	return PON_ADAPTER_SUCCESS;
+	return ret;
 }
 
-enum pon_adapter_errno mapper_id_remove(struct mapper *m,
-					uint32_t id)
+enum pon_adapter_errno mapper_id_map_range(struct mapper *m,
+					   uint32_t id,
+					   uint32_t num,
+					   uint32_t align,
+					   uint32_t *first_idx)
 {
 	enum pon_adapter_errno ret = PON_ADAPTER_SUCCESS;
-	struct mapper_map_list *item_pos[KEY_TYPE_NUM] = { NULL };
-	struct mapper_map_list *item = NULL;
-	uint32_t idx = 0;
+	uint32_t key[KEY_TYPE_NUM];
+	uint64_t map, unmap;
+	uint32_t peak, off, i;
 
-	PA_DBG_PRINT("%s(%u)\n", __func__, id);
+	PA_DBG_PRINT("%s(%u, %u, %u, %p)\n", __func__, id, num, align,
+		     first_idx);
 
-	ret = key_verify(m, KEY_TYPE_ID, id);
-	if (ret != PON_ADAPTER_SUCCESS)
+	if (!m || !num || !first_idx || id + (num - 1) < id ||
+	    key_verify(m, KEY_TYPE_ID, id) != PON_ADAPTER_SUCCESS ||
+	    key_verify(m, KEY_TYPE_ID, id + (num - 1)) != PON_ADAPTER_SUCCESS)
 		return PON_ADAPTER_ERROR;
 
-	ret = item_find(m, KEY_TYPE_ID, id, &item_pos[KEY_TYPE_ID]);
-	if (ret == PON_ADAPTER_ERR_NOT_FOUND) {
-		PA_DBG_PRINT("Id %d is not found (id_remove)\n", id);
-		return PON_ADAPTER_ERR_NOT_FOUND;
-	} else if (ret != PON_ADAPTER_SUCCESS) {
-		PA_DBG_PRINT("Id %d searching error %d (id_remove)\n",
-				   id, ret);
+	/* free runs are only known for index ranges with a bitmap */
+	if (!m->used[KEY_TYPE_INDEX].levels)
 		return PON_ADAPTER_ERROR;
-	}
 
-	item = item_get(m, KEY_TYPE_ID, item_pos[KEY_TYPE_ID]);
-	if (!item) {
-		PA_DBG_PRINT("%s", "Id retrieving failed (id_remove)\n");
+	if (!align)
+		align = 1;
+
+	mapper_write_begin(m);
+	if (bitmap_run_find(&m->used[KEY_TYPE_INDEX],
+			    m->m_entry->min_key[KEY_TYPE_INDEX], num, align,
+			    &off) != PON_ADAPTER_SUCCESS) {
+		PA_DBG_PRINT("No %u free indexes, item {%s}\n", num,
+			     m->m_entry->name);
+		m->cnt.alloc_fail++;
+		mapper_write_end(m);
 		return PON_ADAPTER_ERROR;
 	}
 
-	key_get(item, KEY_TYPE_INDEX, &idx);
+	map = m->cnt.map;
+	unmap = m->cnt.unmap;
+	peak = m->cnt.peak;
+	/* the index hints are set only after all IDs were mapped */
+	for (i = 0; i < num; i++) {
+		key[KEY_TYPE_ID] = id + i;
+		key[KEY_TYPE_INDEX] = m->m_entry->min_key[KEY_TYPE_INDEX] +
+				      off + i;
+		ret = mapping_store(m, KEY_TYPE_NUM, key);
+		if (ret != PON_ADAPTER_SUCCESS)
+			break;
+	}
 
-	ret = item_find(m, KEY_TYPE_INDEX, idx, &item_pos[KEY_TYPE_INDEX]);
-	if (ret == PON_ADAPTER_ERR_NOT_FOUND) {
-		PA_DBG_PRINT("Index %d is not found (id_remove)\n", idx);
-		return PON_ADAPTER_ERR_NOT_FOUND;
-	} else if (ret != PON_ADAPTER_SUCCESS) {
-		PA_DBG_PRINT("Index %d searching error %d (id_remove)\n",
-				   idx, ret);
-		return PON_ADAPTER_ERROR;
+	/* map all or nothing, see mapper_id_map_batch */
+	if (ret != PON_ADAPTER_SUCCESS) {
+		PA_DBG_PRINT("Id %u can't be mapped, item {%s}\n",
+			     id + i, m->m_entry->name);
+		while (i--) {
+			key[KEY_TYPE_ID] = id + i;
+			mapping_delete(m, KEY_TYPE_ID, key, NULL);
+		}
+		m->cnt.map = map;
+		m->cnt.unmap = unmap;
+		m->cnt.peak = peak;
+		ret = PON_ADAPTER_ERROR;
+	} else if (m->m_entry->flags & MAPPER_FLAG_STICKY) {
+		for (i = 0; i < num; i++)
+			sticky_set(m, id + i,
+				   m->m_entry->min_key[KEY_TYPE_INDEX] +
+				   off + i);
 	}
+	mapper_write_end(m);
 
-	item = item_remove(m, item_pos);
-	if (!item)
-		return PON_ADAPTER_ERROR;
+	if (ret == PON_ADAPTER_SUCCESS)
+		*first_idx = m->m_entry->min_key[KEY_TYPE_INDEX] + off;
 
-	item_delete(item);
-	return PON_ADAPTER_SUCCESS;
+	return ret;
 }
 
-enum pon_adapter_errno mapper_index_remove(struct mapper *m,
-					   uint32_t idx)
+enum pon_adapter_errno mapper_id_remove_range(struct mapper *m,
+					      uint32_t id,
+					      uint32_t num)
 {
 	enum pon_adapter_errno ret = PON_ADAPTER_SUCCESS;
-	struct mapper_map_list *item_pos[KEY_TYPE_NUM] = { NULL };
-	struct mapper_map_list *item = NULL;
-	uint32_t id = 0;
-
-	PA_DBG_PRINT("%s(%u)\n", __func__, idx);
+	uint32_t key[KEY_TYPE_NUM];
+	uint32_t i;
 
-	ret = key_verify(m, KEY_TYPE_INDEX, idx);
-	if (ret != PON_ADAPTER_SUCCESS)
-		return PON_ADAPTER_ERROR;
+	PA_DBG_PRINT("%s(%u, %u)\n", __func__, id, num);
 
-	ret = item_find(m, KEY_TYPE_INDEX, idx, &item_pos[KEY_TYPE_INDEX]);
-	if (ret == PON_ADAPTER_ERR_NOT_FOUND) {
-		PA_DBG_PRINT("Index %d is not found (index_remove)\n",
-				   idx);
-		return PON_ADAPTER_ERR_NOT_FOUND;
-	} else if (ret != PON_ADAPTER_SUCCESS) {
-		PA_DBG_PRINT
-		    ("Index %d searching error %d (index_remove)\n", idx, ret);
+	if (!m || !num || id + (num - 1) < id ||
+	    key_verify(m, KEY_TYPE_ID, id) != PON_ADAPTER_SUCCESS ||
+	    key_verify(m, KEY_TYPE_ID, id + (num - 1)) != PON_ADAPTER_SUCCESS)
 		return PON_ADAPTER_ERROR;
-	}
 
-	item = item_get(m, KEY_TYPE_INDEX, item_pos[KEY_TYPE_INDEX]);
-	if (!item) {
-		PA_DBG_PRINT("%s", "Index retrieving failed (index_remove)\n");
-		return PON_ADAPTER_ERROR;
+	mapper_write_begin(m);
+	/* remove all or nothing */
+	for (i = 0; i < num && ret == PON_ADAPTER_SUCCESS; i++) {
+		key[KEY_TYPE_ID] = id + i;
+		ret = m->ops->find(m, KEY_TYPE_ID, key, NULL);
 	}
 
-	key_get(item, KEY_TYPE_ID, &id);
-
-	ret = item_find(m, KEY_TYPE_ID, id, &item_pos[KEY_TYPE_ID]);
-	if (ret == PON_ADAPTER_ERR_NOT_FOUND) {
-		PA_DBG_PRINT("Id %d is not found (index_remove)\n", id);
-		return PON_ADAPTER_ERR_NOT_FOUND;
-	} else if (ret != PON_ADAPTER_SUCCESS) {
-		PA_DBG_PRINT("Id %d searching error %d (index_remove)\n",
-				   id, ret);
-		return PON_ADAPTER_ERROR;
+	for (i = 0; i < num && ret == PON_ADAPTER_SUCCESS; i++) {
+		key[KEY_TYPE_ID] = id + i;
+		ret = mapping_delete(m, KEY_TYPE_ID, key, NULL);
 	}
+	mapper_write_end(m);
 
-	item = item_remove(m, item_pos);
-	if (!item)
-		return PON_ADAPTER_ERROR;
-
-	item_delete(item);
-	return PON_ADAPTER_SUCCESS;
+	return ret;
 }
 
 enum pon_adapter_errno pa_mapper_init(struct mapper **m,
 				      size_t size,
 				      const struct mapper_entry *m_entry)
+{
+	return pa_mapper_init_arena(m, size, m_entry, NULL);
+}
+
+enum pon_adapter_errno pa_mapper_init_arena(struct mapper **m,
+					    size_t size,
+					    const struct mapper_entry *m_entry,
+					    struct mapper_arena *arena)
 {
 	size_t i;
 	uint32_t id_type;
@@ -794,7 +3799,37 @@ enum pon_adapter_errno pa_mapper_init(struct mapper **m,
 	for (i = 0; i < size; i++) {
 		id_type = m_entry[i].type;
 
-		m[id_type] = mapper_alloc(&m_entry[i]);
+		m[id_type] = mapper_create(&m_entry[i], arena);
+
+		if (!m[id_type]) {
+			PA_DBG_PRINT("Can't initialize mapping for %s\n",
+			    m_entry[i].name);
+
+			return PON_ADAPTER_ERROR;
+		}
+	}
+
+	return PON_ADAPTER_SUCCESS;
+}
+
+enum pon_adapter_errno pa_mapper_init_static(struct mapper **m,
+					     size_t size,
+					     const struct mapper_entry *m_entry,
+					     uint64_t *storage,
+					     size_t storage_size)
+{
+	size_t i, left = storage_size / sizeof(uint64_t);
+	uint32_t id_type;
+
+	PA_DBG_PRINT("%s\n", __func__);
+
+	if (!m || !m_entry || !storage)
+		return PON_ADAPTER_ERROR;
+
+	for (i = 0; i < size; i++) {
+		id_type = m_entry[i].type;
+
+		m[id_type] = mapper_create_fixed(&m_entry[i], &storage, &left);
 
 		if (!m[id_type]) {
 			PA_DBG_PRINT("Can't initialize mapping for %s\n",
@@ -814,9 +3849,15 @@ enum pon_adapter_errno pa_mapper_reset(struct mapper **m,
 
 	PA_DBG_PRINT("%s\n", __func__);
 
+	/* nodes of arena based mappers are dropped with the arena */
 	for (id_type = 0; id_type < size; id_type++) {
 		if (m[id_type])
-			mapper_cleanup(m[id_type]);
+			mapper_clear(m[id_type], !m[id_type]->arena);
+	}
+
+	for (id_type = 0; id_type < size; id_type++) {
+		if (m[id_type] && m[id_type]->arena)
+			arena_reset(m[id_type]->arena);
 	}
 
 	return PON_ADAPTER_SUCCESS;
@@ -831,26 +3872,49 @@ enum pon_adapter_errno pa_mapper_shutdown(struct mapper **m,
 
 	for (id_type = 0; id_type < size; id_type++) {
 		if (m[id_type]) {
-			mapper_ret = mapper_free(m[id_type]);
+			mapper_ret = mapper_clear(m[id_type], !m[id_type]->arena);
 			if (mapper_ret != PON_ADAPTER_SUCCESS) {
 				PA_DBG_PRINT("Can't free mapping for %s\n",
 					     m[id_type]->m_entry->name);
 				ret = mapper_ret;
+				continue;
 			}
+			if (m[id_type]->arena)
+				arena_reset(m[id_type]->arena);
+			mapper_release(m[id_type]);
 		}
 	}
 
 	return ret;
 }
 
+enum pon_adapter_errno pa_mapper_stats_get(struct mapper **m,
+				       size_t size,
+				       const struct mapper_entry *m_entry,
+				       struct mapper_stats *stats)
+{
+	size_t i;
+
+	PA_DBG_PRINT("%s\n", __func__);
+
+	if (!m || !m_entry || !stats)
+		return PON_ADAPTER_ERROR;
+
+	/* missing mappers report empty statistics */
+	for (i = 0; i < size; i++)
+		mapper_stats_get(m[m_entry[i].type], &stats[i]);
+
+	return PON_ADAPTER_SUCCESS;
+}
+
 enum pon_adapter_errno pa_mapper_dump(struct mapper **m,
 				      size_t size,
 				      const struct mapper_entry *m_entry)
 {
-	enum pon_adapter_errno ret;
+	struct mapper_cursor c;
 	int32_t type;
-	uint32_t *id_list = NULL, id_size, idx;
-	uint32_t i, j;
+	uint32_t id, idx, num;
+	uint32_t i;
 
 	PA_DBG_PRINT("%s\n", __func__);
 
@@ -861,32 +3925,22 @@ enum pon_adapter_errno pa_mapper_dump(struct mapper **m,
 	for (i = 0; i < size; i++) {
 		type = m_entry[i].type;
 
-		if (id_list)
-			free(id_list);
-		id_list = NULL;
-
 		if (m[type] == NULL)
 			continue;
 
-		if (mapper_id_array_get(m[type], &id_list, &id_size) !=
-			PON_ADAPTER_SUCCESS)
-			continue;
-		if (!id_size)
-			continue;
-
-		for (j = 0; j < id_size; j++) {
-			ret = mapper_index_get(m[type], *(id_list + j), &idx);
-			if (ret != PON_ADAPTER_SUCCESS)
-				continue; /* ignore and try next index */
-
+		num = 0;
+		mapper_cursor_init(&c, 0, UINT32_MAX);
+		while (mapper_cursor_next(m[type], &c, &id, &idx) ==
+		       PON_ADAPTER_SUCCESS) {
 			printf("| 0x%02x %-45s | 0x%08x | 0x%08x\n",
-				type, m_entry[i].name, *(id_list + j), idx);
+				type, m_entry[i].name, id, idx);
+			num++;
 		}
+		if (!num)
+			continue;
+
 		printf("+----------------------------------------------------+------------+------------\n");
 	}
 
-	if (id_list)
-		free(id_list);
-
 	return PON_ADAPTER_SUCCESS;
 }
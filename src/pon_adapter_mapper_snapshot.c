@@ -0,0 +1,482 @@
+/******************************************************************************
+ *
+ *  Copyright (c) 2024 MaxLinear, Inc.
+ *
+ * For licensing information, see the file 'LICENSE' in the root folder of
+ * this software module.
+ *
+ ******************************************************************************/
+
+/**
+ * \file pon_adapter_mapper_snapshot.c
+ *
+ * Mapper set snapshot file handling.
+ *
+ * A snapshot file consists of a header, one descriptor per mapper entry and
+ * the (ID, index) pairs of all mappers, sorted by ID per mapper. All fields
+ * are 32 bit words in host byte order, so that the file can be mapped into
+ * memory and used in place.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pon_adapter_mapper.h"
+#include "pon_adapter_crc.h"
+#include "pon_adapter_debug.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+/** Snapshot magic number ("PAMS"), also detects foreign byte order */
+#define MAPPER_SNAPSHOT_MAGIC 0x50414d53
+/** Snapshot format version */
+#define MAPPER_SNAPSHOT_VERSION 1
+/** Number of pairs written at once */
+#define MAPPER_SNAPSHOT_CHUNK 256
+
+/** Snapshot file header */
+struct mapper_snapshot_hdr {
+	/** \ref MAPPER_SNAPSHOT_MAGIC */
+	uint32_t magic;
+	/** \ref MAPPER_SNAPSHOT_VERSION */
+	uint32_t version;
+	/** Number of mapper descriptors */
+	uint32_t entry_num;
+	/** Number of (ID, index) pairs of all mappers */
+	uint32_t pair_num;
+	/** CRC-32 of the descriptors and pairs, see \ref pa_omci_crc32 */
+	uint32_t crc;
+	/** Reserved, 0 */
+	uint32_t reserved;
+};
+
+/** Snapshot descriptor of a mapper */
+struct mapper_snapshot_entry {
+	/** Item type, see \ref mapper_entry */
+	int32_t type;
+	/** Key minimum values of the mapper entry */
+	uint32_t min_key[KEY_TYPE_NUM];
+	/** Key maximum values of the mapper entry */
+	uint32_t max_key[KEY_TYPE_NUM];
+	/** Number of pairs of the mapper */
+	uint32_t count;
+	/** Number of the first pair of the mapper */
+	uint32_t first;
+	/** Reserved, 0 */
+	uint32_t reserved;
+};
+
+/** Snapshot (ID, index) pair */
+struct mapper_snapshot_pair {
+	/** ID */
+	uint32_t id;
+	/** Index */
+	uint32_t idx;
+};
+
+/** Count the mappings of a mapper
+ *
+ * \param[in] m        Pointer to mapper, may be NULL
+ *
+ * \return Number of mappings
+ */
+static uint32_t snapshot_count(struct mapper *m)
+{
+	struct mapper_cursor c;
+	uint32_t num = 0;
+
+	if (!m)
+		return 0;
+
+	mapper_cursor_init(&c, 0, UINT32_MAX);
+	while (mapper_cursor_next(m, &c, NULL, NULL) == PON_ADAPTER_SUCCESS)
+		num++;
+
+	return num;
+}
+
+/** Write data to a snapshot file and update the CRC
+ *
+ * \param[in]     f        File
+ * \param[in]     data     Data
+ * \param[in]     size     Data size
+ * \param[in,out] crc      CRC
+ *
+ * \return
+ *    - PON_ADAPTER_SUCCESS Data was written
+ *    - PON_ADAPTER_ERROR   Write error
+ */
+static enum pon_adapter_errno snapshot_write(FILE *f,
+					     const void *data,
+					     size_t size,
+					     uint32_t *crc)
+{
+	if (size && fwrite(data, size, 1, f) != 1)
+		return PON_ADAPTER_ERROR;
+
+	*crc = pa_omci_crc32(*crc, data, size);
+
+	return PON_ADAPTER_SUCCESS;
+}
+
+/** Write the pairs of a mapper to a snapshot file
+ *
+ * \param[in]     f        File
+ * \param[in]     m        Pointer to mapper, may be NULL
+ * \param[in]     count    Number of pairs to write
+ * \param[in,out] crc      CRC
+ *
+ * \return
+ *    - PON_ADAPTER_SUCCESS Pairs were written
+ *    - PON_ADAPTER_ERROR   Write error or the mapper was modified
+ */
+static enum pon_adapter_errno snapshot_pairs_write(FILE *f,
+						   struct mapper *m,
+						   uint32_t count,
+						   uint32_t *crc)
+{
+	struct mapper_snapshot_pair pair[MAPPER_SNAPSHOT_CHUNK];
+	struct mapper_cursor c;
+	uint32_t n = 0, total = 0;
+
+	if (!m)
+		return PON_ADAPTER_SUCCESS;
+
+	mapper_cursor_init(&c, 0, UINT32_MAX);
+	while (mapper_cursor_next(m, &c, &pair[n].id, &pair[n].idx) ==
+	       PON_ADAPTER_SUCCESS) {
+		if (++total > count)
+			return PON_ADAPTER_ERROR;
+		if (++n < MAPPER_SNAPSHOT_CHUNK)
+			continue;
+		if (snapshot_write(f, pair, sizeof(pair), crc) !=
+		    PON_ADAPTER_SUCCESS)
+			return PON_ADAPTER_ERROR;
+		n = 0;
+	}
+
+	if (total != count)
+		return PON_ADAPTER_ERROR;
+
+	return snapshot_write(f, pair, n * sizeof(pair[0]), crc);
+}
+
+/** Write a snapshot file through to the storage
+ *
+ * \param[in] f        Snapshot file
+ *
+ * \return
+ *    - PON_ADAPTER_SUCCESS The file content is on the storage
+ *    - PON_ADAPTER_ERROR   Flushing the file failed
+ */
+static enum pon_adapter_errno snapshot_file_sync(FILE *f)
+{
+	if (fflush(f))
+		return PON_ADAPTER_ERROR;
+#ifndef _WIN32
+	if (fsync(fileno(f)))
+		return PON_ADAPTER_ERROR;
+#endif
+
+	return PON_ADAPTER_SUCCESS;
+}
+
+/** Write the directory entry of a renamed snapshot file to the storage
+ *
+ * \param[in] path     Snapshot file name
+ * \param[in] buf      Buffer for the directory name, strlen(path) + 1 bytes
+ *
+ * \return
+ *    - PON_ADAPTER_SUCCESS The directory entry is on the storage
+ *    - PON_ADAPTER_ERROR   Syncing the directory failed
+ */
+static enum pon_adapter_errno snapshot_dir_sync(const char *path, char *buf)
+{
+#ifndef _WIN32
+	const char *dir = ".";
+	char *sep;
+	int fd, err;
+
+	strcpy(buf, path);
+	sep = strrchr(buf, '/');
+	if (sep) {
+		/* keep the slash of the root directory */
+		sep[sep == buf] = '\0';
+		dir = buf;
+	}
+
+	fd = open(dir, O_RDONLY);
+	if (fd < 0)
+		return PON_ADAPTER_ERROR;
+	err = fsync(fd);
+	close(fd);
+	if (err)
+		return PON_ADAPTER_ERROR;
+#else
+	/* directories can't be synced through the C library */
+	(void)path;
+	(void)buf;
+#endif
+
+	return PON_ADAPTER_SUCCESS;
+}
+
+enum pon_adapter_errno pa_mapper_snapshot_save(struct mapper **m,
+					       size_t size,
+					       const struct mapper_entry *m_entry,
+					       const char *path)
+{
+	struct mapper_snapshot_hdr hdr;
+	struct mapper_snapshot_entry *e;
+	enum pon_adapter_errno ret = PON_ADAPTER_SUCCESS;
+	uint32_t first = 0, crc = 0xFFFFFFFF;
+	size_t i, len;
+	char *tmp;
+	FILE *f;
+
+	PA_DBG_PRINT("%s(%s)\n", __func__, path);
+
+	if (!m || !m_entry || !path || size > UINT32_MAX)
+		return PON_ADAPTER_ERROR;
+
+	e = calloc(size ? size : 1, sizeof(*e));
+	if (!e)
+		return PON_ADAPTER_ERR_NO_MEMORY;
+
+	for (i = 0; i < size; i++) {
+		e[i].type = m_entry[i].type;
+		memcpy(e[i].min_key, m_entry[i].min_key, sizeof(e[i].min_key));
+		memcpy(e[i].max_key, m_entry[i].max_key, sizeof(e[i].max_key));
+		e[i].count = snapshot_count(m[m_entry[i].type]);
+		e[i].first = first;
+		if (e[i].count > UINT32_MAX - first) {
+			free(e);
+			return PON_ADAPTER_ERROR;
+		}
+		first += e[i].count;
+	}
+
+	/* write a temporary file first, to keep the old snapshot intact */
+	len = strlen(path);
+	tmp = malloc(len + sizeof(".tmp"));
+	if (!tmp) {
+		free(e);
+		return PON_ADAPTER_ERR_NO_MEMORY;
+	}
+	memcpy(tmp, path, len);
+	memcpy(tmp + len, ".tmp", sizeof(".tmp"));
+
+	f = fopen(tmp, "wb");
+	if (!f) {
+		PA_DBG_PRINT("Can't create snapshot file %s\n", tmp);
+		free(tmp);
+		free(e);
+		return PON_ADAPTER_ERROR;
+	}
+
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.magic = MAPPER_SNAPSHOT_MAGIC;
+	hdr.version = MAPPER_SNAPSHOT_VERSION;
+	hdr.entry_num = (uint32_t)size;
+	hdr.pair_num = first;
+
+	/* the header is rewritten with the CRC at the end */
+	if (fwrite(&hdr, sizeof(hdr), 1, f) != 1)
+		ret = PON_ADAPTER_ERROR;
+	if (ret == PON_ADAPTER_SUCCESS)
+		ret = snapshot_write(f, e, size * sizeof(*e), &crc);
+	for (i = 0; i < size && ret == PON_ADAPTER_SUCCESS; i++)
+		ret = snapshot_pairs_write(f, m[m_entry[i].type], e[i].count,
+					   &crc);
+	if (ret == PON_ADAPTER_SUCCESS) {
+		hdr.crc = crc;
+		if (fseek(f, 0, SEEK_SET) ||
+		    fwrite(&hdr, sizeof(hdr), 1, f) != 1)
+			ret = PON_ADAPTER_ERROR;
+	}
+	/* the new content must be stored before it replaces the old one */
+	if (ret == PON_ADAPTER_SUCCESS)
+		ret = snapshot_file_sync(f);
+	if (fclose(f))
+		ret = PON_ADAPTER_ERROR;
+
+	if (ret == PON_ADAPTER_SUCCESS) {
+#ifdef _WIN32
+		/* rename does not replace existing files */
+		remove(path);
+#endif
+		if (rename(tmp, path))
+			ret = PON_ADAPTER_ERROR;
+		else
+			ret = snapshot_dir_sync(path, tmp);
+	}
+	if (ret != PON_ADAPTER_SUCCESS) {
+		PA_DBG_PRINT("Can't write snapshot file %s\n", path);
+		remove(tmp);
+	}
+
+	free(tmp);
+	free(e);
+
+	return ret;
+}
+
+/** Verify the content of a snapshot against the mapper set
+ *
+ * \param[in] m        Mapper set
+ * \param[in] size     Size of m_entry array
+ * \param[in] m_entry  Mapper entries
+ * \param[in] hdr      Snapshot header
+ * \param[in] e        Snapshot descriptors
+ * \param[in] pair     Snapshot pairs
+ *
+ * \return
+ *    - PON_ADAPTER_SUCCESS             Snapshot matches the mapper set
+ *    - PON_ADAPTER_ERR_CONFIG_MISMATCH Snapshot doesn't match
+ */
+static enum pon_adapter_errno
+snapshot_verify(struct mapper **m,
+		size_t size,
+		const struct mapper_entry *m_entry,
+		const struct mapper_snapshot_hdr *hdr,
+		const struct mapper_snapshot_entry *e,
+		const struct mapper_snapshot_pair *pair)
+{
+	enum mapper_key_type key_type;
+	uint32_t first = 0, j;
+	size_t i;
+
+	if (hdr->entry_num != size)
+		return PON_ADAPTER_ERR_CONFIG_MISMATCH;
+
+	for (i = 0; i < size; i++) {
+		if (e[i].type != m_entry[i].type ||
+		    memcmp(e[i].min_key, m_entry[i].min_key,
+			   sizeof(e[i].min_key)) ||
+		    memcmp(e[i].max_key, m_entry[i].max_key,
+			   sizeof(e[i].max_key)) ||
+		    e[i].first != first ||
+		    e[i].count > hdr->pair_num - first ||
+		    (e[i].count && !m[m_entry[i].type]))
+			return PON_ADAPTER_ERR_CONFIG_MISMATCH;
+
+		for (j = first; j < first + e[i].count; j++) {
+			/* strictly ascending IDs, so no ID is duplicated */
+			if (j > first && pair[j].id <= pair[j - 1].id)
+				return PON_ADAPTER_ERR_CONFIG_MISMATCH;
+			for (key_type = KEY_TYPE_ID; key_type < KEY_TYPE_NUM;
+			     key_type++) {
+				uint32_t key = key_type == KEY_TYPE_ID ?
+					pair[j].id : pair[j].idx;
+
+				if (key < e[i].min_key[key_type] ||
+				    key > e[i].max_key[key_type])
+					return PON_ADAPTER_ERR_CONFIG_MISMATCH;
+			}
+		}
+		first += e[i].count;
+	}
+
+	if (first != hdr->pair_num)
+		return PON_ADAPTER_ERR_CONFIG_MISMATCH;
+
+	return PON_ADAPTER_SUCCESS;
+}
+
+enum pon_adapter_errno pa_mapper_snapshot_load(struct mapper **m,
+					       size_t size,
+					       const struct mapper_entry *m_entry,
+					       const char *path)
+{
+	const struct mapper_snapshot_entry *e;
+	const struct mapper_snapshot_pair *pair;
+	struct mapper_snapshot_hdr hdr;
+	enum pon_adapter_errno ret = PON_ADAPTER_SUCCESS;
+	uint64_t body_size;
+	uint8_t *body;
+	uint32_t j;
+	size_t i;
+	FILE *f;
+	long file_size;
+
+	PA_DBG_PRINT("%s(%s)\n", __func__, path);
+
+	if (!m || !m_entry || !path)
+		return PON_ADAPTER_ERROR;
+
+	f = fopen(path, "rb");
+	if (!f)
+		return PON_ADAPTER_ERR_NOT_FOUND;
+
+	if (fread(&hdr, sizeof(hdr), 1, f) != 1 ||
+	    hdr.magic != MAPPER_SNAPSHOT_MAGIC ||
+	    hdr.version != MAPPER_SNAPSHOT_VERSION) {
+		PA_DBG_PRINT("Invalid snapshot file %s\n", path);
+		fclose(f);
+		return PON_ADAPTER_ERR_INVALID_VAL;
+	}
+
+	body_size = (uint64_t)hdr.entry_num * sizeof(*e) +
+		    (uint64_t)hdr.pair_num * sizeof(*pair);
+
+	if (fseek(f, 0, SEEK_END) || (file_size = ftell(f)) < 0 ||
+	    (uint64_t)file_size != sizeof(hdr) + body_size ||
+	    fseek(f, sizeof(hdr), SEEK_SET)) {
+		PA_DBG_PRINT("Invalid snapshot file size %s\n", path);
+		fclose(f);
+		return PON_ADAPTER_ERR_INVALID_VAL;
+	}
+
+	body = malloc(body_size ? (size_t)body_size : 1);
+	if (!body) {
+		fclose(f);
+		return PON_ADAPTER_ERR_NO_MEMORY;
+	}
+
+	if (body_size && fread(body, (size_t)body_size, 1, f) != 1)
+		ret = PON_ADAPTER_ERROR;
+	fclose(f);
+
+	if (ret == PON_ADAPTER_SUCCESS &&
+	    pa_omci_crc32(0xFFFFFFFF, body, (size_t)body_size) != hdr.crc) {
+		PA_DBG_PRINT("Snapshot file %s is corrupted\n", path);
+		ret = PON_ADAPTER_ERR_INVALID_VAL;
+	}
+
+	e = (const struct mapper_snapshot_entry *)body;
+	pair = (const struct mapper_snapshot_pair *)(e + hdr.entry_num);
+
+	if (ret == PON_ADAPTER_SUCCESS)
+		ret = snapshot_verify(m, size, m_entry, &hdr, e, pair);
+	if (ret != PON_ADAPTER_SUCCESS) {
+		free(body);
+		return ret;
+	}
+
+	/* replace the current mappings */
+	for (i = 0; i < size && ret == PON_ADAPTER_SUCCESS; i++) {
+		if (!m[m_entry[i].type])
+			continue;
+		ret = mapper_cleanup(m[m_entry[i].type]);
+		for (j = e[i].first; j < e[i].first + e[i].count &&
+		     ret == PON_ADAPTER_SUCCESS; j++)
+			ret = mapper_explicit_map(m[m_entry[i].type],
+						  pair[j].id, pair[j].idx);
+	}
+
+	/* duplicated indexes or not enough memory, don't keep a part */
+	if (ret != PON_ADAPTER_SUCCESS) {
+		PA_DBG_PRINT("Snapshot file %s can't be restored\n", path);
+		for (i = 0; i < size; i++)
+			if (m[m_entry[i].type])
+				mapper_cleanup(m[m_entry[i].type]);
+		ret = PON_ADAPTER_ERR_CONFIG_MISMATCH;
+	}
+
+	free(body);
+
+	return ret;
+}
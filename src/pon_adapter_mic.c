@@ -0,0 +1,661 @@
+/******************************************************************************
+ *
+ *  Copyright (c) 2024 MaxLinear, Inc.
+ *
+ * For licensing information, see the file 'LICENSE' in the root folder of
+ * this software module.
+ *
+ ******************************************************************************/
+
+/**
+ * \file pon_adapter_mic.c
+ *
+ * OMCI message integrity check, AES-CMAC (RFC 4493) with AES-128
+ * (FIPS-197).
+ *
+ * The key schedule is expanded in software once per OMCI-IK. Blocks are
+ * encrypted with the AES instructions of the CPU (AES-NI on x86, the ARMv8
+ * cryptography extension) if available, else with a table implementation.
+ */
+
+#include <string.h>
+#include "pon_adapter_mic.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <cpuid.h>
+#include <immintrin.h>
+#define AES_HW_X86 1
+#define AES_TARGET_HW __attribute__((target("aes,sse2")))
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#include <wmmintrin.h>
+#define AES_HW_X86 1
+#define AES_TARGET_HW
+#elif defined(__aarch64__) && defined(__linux__) && \
+	(defined(__ARM_FEATURE_CRYPTO) || defined(__ARM_FEATURE_AES))
+/* only if the compiler targets the crypto extension, the AES intrinsics
+ * are not available otherwise
+ */
+#include <arm_neon.h>
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#define AES_HW_ARM 1
+#define AES_TARGET_HW
+#endif
+
+#if defined(AES_HW_X86) || defined(AES_HW_ARM)
+#define AES_HW 1
+#else
+#define AES_HW 0
+#endif
+
+/** Number of AES-128 rounds */
+#define AES_ROUNDS 10
+
+/** AES block size */
+#define AES_BLOCK_LEN 16
+
+/** Number of messages processed interleaved by pa_omci_mic_batch() */
+#define MIC_BATCH_LANES 4
+
+/** AES S-box */
+static const uint8_t aes_sbox[256] = {
+	0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5,
+	0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+	0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0,
+	0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+	0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc,
+	0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+	0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a,
+	0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+	0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0,
+	0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+	0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b,
+	0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+	0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85,
+	0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+	0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5,
+	0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+	0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17,
+	0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+	0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88,
+	0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+	0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c,
+	0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+	0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9,
+	0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+	0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6,
+	0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+	0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e,
+	0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+	0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94,
+	0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+	0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68,
+	0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16
+};
+
+/** AES encryption table, SubBytes and MixColumns of one byte. The tables
+ *  for the other byte positions are rotations of it.
+ */
+static const uint32_t aes_te0[256] = {
+	0xc66363a5, 0xf87c7c84, 0xee777799, 0xf67b7b8d,
+	0xfff2f20d, 0xd66b6bbd, 0xde6f6fb1, 0x91c5c554,
+	0x60303050, 0x02010103, 0xce6767a9, 0x562b2b7d,
+	0xe7fefe19, 0xb5d7d762, 0x4dababe6, 0xec76769a,
+	0x8fcaca45, 0x1f82829d, 0x89c9c940, 0xfa7d7d87,
+	0xeffafa15, 0xb25959eb, 0x8e4747c9, 0xfbf0f00b,
+	0x41adadec, 0xb3d4d467, 0x5fa2a2fd, 0x45afafea,
+	0x239c9cbf, 0x53a4a4f7, 0xe4727296, 0x9bc0c05b,
+	0x75b7b7c2, 0xe1fdfd1c, 0x3d9393ae, 0x4c26266a,
+	0x6c36365a, 0x7e3f3f41, 0xf5f7f702, 0x83cccc4f,
+	0x6834345c, 0x51a5a5f4, 0xd1e5e534, 0xf9f1f108,
+	0xe2717193, 0xabd8d873, 0x62313153, 0x2a15153f,
+	0x0804040c, 0x95c7c752, 0x46232365, 0x9dc3c35e,
+	0x30181828, 0x379696a1, 0x0a05050f, 0x2f9a9ab5,
+	0x0e070709, 0x24121236, 0x1b80809b, 0xdfe2e23d,
+	0xcdebeb26, 0x4e272769, 0x7fb2b2cd, 0xea75759f,
+	0x1209091b, 0x1d83839e, 0x582c2c74, 0x341a1a2e,
+	0x361b1b2d, 0xdc6e6eb2, 0xb45a5aee, 0x5ba0a0fb,
+	0xa45252f6, 0x763b3b4d, 0xb7d6d661, 0x7db3b3ce,
+	0x5229297b, 0xdde3e33e, 0x5e2f2f71, 0x13848497,
+	0xa65353f5, 0xb9d1d168, 0x00000000, 0xc1eded2c,
+	0x40202060, 0xe3fcfc1f, 0x79b1b1c8, 0xb65b5bed,
+	0xd46a6abe, 0x8dcbcb46, 0x67bebed9, 0x7239394b,
+	0x944a4ade, 0x984c4cd4, 0xb05858e8, 0x85cfcf4a,
+	0xbbd0d06b, 0xc5efef2a, 0x4faaaae5, 0xedfbfb16,
+	0x864343c5, 0x9a4d4dd7, 0x66333355, 0x11858594,
+	0x8a4545cf, 0xe9f9f910, 0x04020206, 0xfe7f7f81,
+	0xa05050f0, 0x783c3c44, 0x259f9fba, 0x4ba8a8e3,
+	0xa25151f3, 0x5da3a3fe, 0x804040c0, 0x058f8f8a,
+	0x3f9292ad, 0x219d9dbc, 0x70383848, 0xf1f5f504,
+	0x63bcbcdf, 0x77b6b6c1, 0xafdada75, 0x42212163,
+	0x20101030, 0xe5ffff1a, 0xfdf3f30e, 0xbfd2d26d,
+	0x81cdcd4c, 0x180c0c14, 0x26131335, 0xc3ecec2f,
+	0xbe5f5fe1, 0x359797a2, 0x884444cc, 0x2e171739,
+	0x93c4c457, 0x55a7a7f2, 0xfc7e7e82, 0x7a3d3d47,
+	0xc86464ac, 0xba5d5de7, 0x3219192b, 0xe6737395,
+	0xc06060a0, 0x19818198, 0x9e4f4fd1, 0xa3dcdc7f,
+	0x44222266, 0x542a2a7e, 0x3b9090ab, 0x0b888883,
+	0x8c4646ca, 0xc7eeee29, 0x6bb8b8d3, 0x2814143c,
+	0xa7dede79, 0xbc5e5ee2, 0x160b0b1d, 0xaddbdb76,
+	0xdbe0e03b, 0x64323256, 0x743a3a4e, 0x140a0a1e,
+	0x924949db, 0x0c06060a, 0x4824246c, 0xb85c5ce4,
+	0x9fc2c25d, 0xbdd3d36e, 0x43acacef, 0xc46262a6,
+	0x399191a8, 0x319595a4, 0xd3e4e437, 0xf279798b,
+	0xd5e7e732, 0x8bc8c843, 0x6e373759, 0xda6d6db7,
+	0x018d8d8c, 0xb1d5d564, 0x9c4e4ed2, 0x49a9a9e0,
+	0xd86c6cb4, 0xac5656fa, 0xf3f4f407, 0xcfeaea25,
+	0xca6565af, 0xf47a7a8e, 0x47aeaee9, 0x10080818,
+	0x6fbabad5, 0xf0787888, 0x4a25256f, 0x5c2e2e72,
+	0x381c1c24, 0x57a6a6f1, 0x73b4b4c7, 0x97c6c651,
+	0xcbe8e823, 0xa1dddd7c, 0xe874749c, 0x3e1f1f21,
+	0x964b4bdd, 0x61bdbddc, 0x0d8b8b86, 0x0f8a8a85,
+	0xe0707090, 0x7c3e3e42, 0x71b5b5c4, 0xcc6666aa,
+	0x904848d8, 0x06030305, 0xf7f6f601, 0x1c0e0e12,
+	0xc26161a3, 0x6a35355f, 0xae5757f9, 0x69b9b9d0,
+	0x17868691, 0x99c1c158, 0x3a1d1d27, 0x279e9eb9,
+	0xd9e1e138, 0xebf8f813, 0x2b9898b3, 0x22111133,
+	0xd26969bb, 0xa9d9d970, 0x078e8e89, 0x339494a7,
+	0x2d9b9bb6, 0x3c1e1e22, 0x15878792, 0xc9e9e920,
+	0x87cece49, 0xaa5555ff, 0x50282878, 0xa5dfdf7a,
+	0x038c8c8f, 0x59a1a1f8, 0x09898980, 0x1a0d0d17,
+	0x65bfbfda, 0xd7e6e631, 0x844242c6, 0xd06868b8,
+	0x824141c3, 0x299999b0, 0x5a2d2d77, 0x1e0f0f11,
+	0x7bb0b0cb, 0xa85454fc, 0x6dbbbbd6, 0x2c16163a
+};
+
+static inline uint32_t get_be32(const uint8_t *p)
+{
+	return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 |
+	       (uint32_t)p[2] << 8 | (uint32_t)p[3];
+}
+
+static inline void put_be32(uint8_t *p, uint32_t v)
+{
+	p[0] = (uint8_t)(v >> 24);
+	p[1] = (uint8_t)(v >> 16);
+	p[2] = (uint8_t)(v >> 8);
+	p[3] = (uint8_t)v;
+}
+
+static inline uint32_t ror32(uint32_t v, unsigned int n)
+{
+	return (v >> n) | (v << (32 - n));
+}
+
+/** Expand an AES-128 key into the round keys (FIPS-197 5.2)
+ *
+ * \param[in]  key       Key
+ * \param[out] rk        Round keys
+ */
+static void aes_key_expand(const uint8_t *key, uint8_t rk[AES_ROUNDS + 1][16])
+{
+	uint32_t w[4 * (AES_ROUNDS + 1)], t, rcon = 0x01;
+	unsigned int i;
+
+	for (i = 0; i < 4; i++)
+		w[i] = get_be32(key + 4 * i);
+
+	for (i = 4; i < 4 * (AES_ROUNDS + 1); i++) {
+		t = w[i - 1];
+		if (i % 4 == 0) {
+			/* SubWord(RotWord(t)) ^ Rcon */
+			t = (uint32_t)aes_sbox[(t >> 16) & 0xff] << 24 |
+			    (uint32_t)aes_sbox[(t >> 8) & 0xff] << 16 |
+			    (uint32_t)aes_sbox[t & 0xff] << 8 |
+			    (uint32_t)aes_sbox[t >> 24];
+			t ^= rcon << 24;
+			rcon = (rcon << 1) ^ ((rcon & 0x80) ? 0x11b : 0);
+		}
+		w[i] = w[i - 4] ^ t;
+	}
+
+	for (i = 0; i < 4 * (AES_ROUNDS + 1); i++)
+		put_be32(&rk[i / 4][4 * (i % 4)], w[i]);
+}
+
+/** One output column of an inner AES round, from the input bytes on the
+ *  diagonal starting at column a
+ */
+static inline uint32_t aes_column(uint32_t a, uint32_t b, uint32_t c,
+				  uint32_t d)
+{
+	return aes_te0[a >> 24] ^ ror32(aes_te0[(b >> 16) & 0xff], 8) ^
+	       ror32(aes_te0[(c >> 8) & 0xff], 16) ^
+	       ror32(aes_te0[d & 0xff], 24);
+}
+
+/** One output column of the last AES round, without MixColumns */
+static inline uint32_t aes_column_last(uint32_t a, uint32_t b, uint32_t c,
+				       uint32_t d)
+{
+	return (uint32_t)aes_sbox[a >> 24] << 24 |
+	       (uint32_t)aes_sbox[(b >> 16) & 0xff] << 16 |
+	       (uint32_t)aes_sbox[(c >> 8) & 0xff] << 8 |
+	       (uint32_t)aes_sbox[d & 0xff];
+}
+
+/** Encrypt one block in software
+ *
+ * \param[in]  rk        Round keys
+ * \param[in]  in        Plain text
+ * \param[out] out       Cipher text, may be the same as in
+ */
+static void aes_encrypt_soft(const uint8_t rk[AES_ROUNDS + 1][16],
+			     const uint8_t *in, uint8_t *out)
+{
+	uint32_t s0, s1, s2, s3, t0, t1, t2, t3;
+	unsigned int r;
+
+	s0 = get_be32(in) ^ get_be32(rk[0]);
+	s1 = get_be32(in + 4) ^ get_be32(rk[0] + 4);
+	s2 = get_be32(in + 8) ^ get_be32(rk[0] + 8);
+	s3 = get_be32(in + 12) ^ get_be32(rk[0] + 12);
+
+	for (r = 1; r < AES_ROUNDS; r++) {
+		t0 = aes_column(s0, s1, s2, s3) ^ get_be32(rk[r]);
+		t1 = aes_column(s1, s2, s3, s0) ^ get_be32(rk[r] + 4);
+		t2 = aes_column(s2, s3, s0, s1) ^ get_be32(rk[r] + 8);
+		t3 = aes_column(s3, s0, s1, s2) ^ get_be32(rk[r] + 12);
+		s0 = t0;
+		s1 = t1;
+		s2 = t2;
+		s3 = t3;
+	}
+
+	put_be32(out, aes_column_last(s0, s1, s2, s3) ^
+		 get_be32(rk[AES_ROUNDS]));
+	put_be32(out + 4, aes_column_last(s1, s2, s3, s0) ^
+		 get_be32(rk[AES_ROUNDS] + 4));
+	put_be32(out + 8, aes_column_last(s2, s3, s0, s1) ^
+		 get_be32(rk[AES_ROUNDS] + 8));
+	put_be32(out + 12, aes_column_last(s3, s0, s1, s2) ^
+		 get_be32(rk[AES_ROUNDS] + 12));
+}
+
+/** CMAC input, an optional direction code followed by the data */
+struct cmac_input {
+	/** Data */
+	const uint8_t *data;
+	/** Data size */
+	size_t len;
+	/** Direction code, 0 for none */
+	uint8_t dir;
+};
+
+/** Number of CMAC blocks, at least one */
+static size_t cmac_block_num(const struct cmac_input *in)
+{
+	size_t total = in->len + (in->dir ? 1 : 0);
+
+	return total ? (total + AES_BLOCK_LEN - 1) / AES_BLOCK_LEN : 1;
+}
+
+/** Get a CMAC block, the last one padded and masked by a subkey
+ *
+ * \param[in]  ctx       MIC context
+ * \param[in]  in        CMAC input
+ * \param[in]  blk       Block number
+ * \param[in]  num       Number of blocks
+ * \param[out] out       Block
+ */
+static void cmac_block(const struct pa_omci_mic_ctx *ctx,
+		       const struct cmac_input *in, size_t blk, size_t num,
+		       uint8_t *out)
+{
+	size_t pre = in->dir ? 1 : 0, pos = blk * AES_BLOCK_LEN, rest, i;
+	const uint8_t *k;
+
+	rest = in->len + pre - pos;
+	if (rest > AES_BLOCK_LEN)
+		rest = AES_BLOCK_LEN;
+
+	if (pre && !pos) {
+		out[0] = in->dir;
+		memcpy(out + 1, in->data, rest - 1);
+	} else if (rest) {
+		memcpy(out, in->data + pos - pre, rest);
+	}
+
+	if (blk + 1 < num)
+		return;
+
+	if (rest == AES_BLOCK_LEN) {
+		k = ctx->k1;
+	} else {
+		out[rest] = 0x80;
+		memset(out + rest + 1, 0, AES_BLOCK_LEN - rest - 1);
+		k = ctx->k2;
+	}
+	for (i = 0; i < AES_BLOCK_LEN; i++)
+		out[i] ^= k[i];
+}
+
+/** Calculate an AES-CMAC in software */
+static void cmac_soft(const struct pa_omci_mic_ctx *ctx,
+		      const struct cmac_input *in, uint8_t *mac)
+{
+	uint8_t block[AES_BLOCK_LEN], x[AES_BLOCK_LEN] = { 0 };
+	size_t num = cmac_block_num(in), blk, i;
+
+	for (blk = 0; blk < num; blk++) {
+		cmac_block(ctx, in, blk, num, block);
+		for (i = 0; i < AES_BLOCK_LEN; i++)
+			x[i] ^= block[i];
+		aes_encrypt_soft(ctx->round_key, x, x);
+	}
+
+	memcpy(mac, x, AES_BLOCK_LEN);
+}
+
+/** Derive a CMAC subkey, multiplication by x in GF(2^128) */
+static void cmac_subkey(const uint8_t *in, uint8_t *out)
+{
+	uint8_t msb = in[0] & 0x80;
+	unsigned int i;
+
+	for (i = 0; i < AES_BLOCK_LEN - 1; i++)
+		out[i] = (uint8_t)(in[i] << 1 | in[i + 1] >> 7);
+	out[AES_BLOCK_LEN - 1] = (uint8_t)(in[AES_BLOCK_LEN - 1] << 1);
+	if (msb)
+		out[AES_BLOCK_LEN - 1] ^= 0x87;
+}
+
+#if defined(AES_HW_X86)
+typedef __m128i aes_block;
+
+#define aes_hw_load(p) _mm_loadu_si128((const __m128i *)(p))
+#define aes_hw_store(p, x) _mm_storeu_si128((__m128i *)(p), x)
+#define aes_hw_xor _mm_xor_si128
+#define aes_hw_zero _mm_setzero_si128
+/* AddRoundKey of key 0, rounds 1 to 9, last round with key 10 */
+#define aes_hw_start(x, rk) _mm_xor_si128(x, (rk)[0])
+#define aes_hw_round(x, rk, r) _mm_aesenc_si128(x, (rk)[r])
+#define aes_hw_end(x, rk) _mm_aesenclast_si128(x, (rk)[AES_ROUNDS])
+
+/** Check for the AES instructions
+ *
+ * \return true if AES-NI and SSE2 are supported
+ */
+static bool aes_hw_detect(void)
+{
+#if defined(_MSC_VER)
+	int info[4];
+
+	__cpuid(info, 1);
+
+	return (info[2] & (1 << 25)) && (info[3] & (1 << 26));
+#else
+	unsigned int eax, ebx, ecx, edx;
+
+	if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+		return false;
+
+	return (ecx & bit_AES) && (edx & bit_SSE2);
+#endif
+}
+#elif defined(AES_HW_ARM)
+typedef uint8x16_t aes_block;
+
+#define aes_hw_load vld1q_u8
+#define aes_hw_store vst1q_u8
+#define aes_hw_xor veorq_u8
+#define aes_hw_zero() vdupq_n_u8(0)
+/* AESE includes AddRoundKey before SubBytes, so round r uses key r - 1 */
+#define aes_hw_start(x, rk) (x)
+#define aes_hw_round(x, rk, r) vaesmcq_u8(vaeseq_u8(x, (rk)[(r) - 1]))
+#define aes_hw_end(x, rk) \
+	veorq_u8(vaeseq_u8(x, (rk)[AES_ROUNDS - 1]), (rk)[AES_ROUNDS])
+
+static bool aes_hw_detect(void)
+{
+	return (getauxval(AT_HWCAP) & HWCAP_AES) != 0;
+}
+#endif
+
+#if AES_HW == 1
+/** Encrypt one block with the AES instructions */
+AES_TARGET_HW
+static inline aes_block aes_hw_encrypt(aes_block x, const aes_block *rk)
+{
+	unsigned int r;
+
+	x = aes_hw_start(x, rk);
+	for (r = 1; r < AES_ROUNDS; r++)
+		x = aes_hw_round(x, rk, r);
+
+	return aes_hw_end(x, rk);
+}
+
+/** Load a CMAC block, inner blocks directly from the data */
+AES_TARGET_HW
+static inline aes_block cmac_hw_block(const struct pa_omci_mic_ctx *ctx,
+				      const struct cmac_input *in, size_t blk,
+				      size_t num, uint8_t *tmp)
+{
+	size_t pre = in->dir ? 1 : 0, pos = blk * AES_BLOCK_LEN;
+
+	if (blk + 1 < num && pos >= pre)
+		return aes_hw_load(in->data + pos - pre);
+
+	cmac_block(ctx, in, blk, num, tmp);
+
+	return aes_hw_load(tmp);
+}
+
+/** Calculate the AES-CMACs of up to MIC_BATCH_LANES inputs with the AES
+ *  instructions
+ *
+ * If all lanes are used, the blocks the inputs have in common are encrypted
+ * interleaved.
+ *
+ * \param[in]  ctx       MIC context
+ * \param[in]  in        CMAC inputs
+ * \param[in]  lanes     Number of inputs
+ * \param[out] mac       AES-CMACs
+ */
+AES_TARGET_HW
+static void cmac_hw(const struct pa_omci_mic_ctx *ctx,
+		    const struct cmac_input *in, unsigned int lanes,
+		    uint8_t mac[][AES_BLOCK_LEN])
+{
+	aes_block rk[AES_ROUNDS + 1], x[MIC_BATCH_LANES], y;
+	size_t num[MIC_BATCH_LANES], common = 0, blk;
+	uint8_t block[AES_BLOCK_LEN];
+	unsigned int l, r;
+
+	for (r = 0; r <= AES_ROUNDS; r++)
+		rk[r] = aes_hw_load(ctx->round_key[r]);
+
+	for (l = 0; l < lanes; l++) {
+		x[l] = aes_hw_zero();
+		num[l] = cmac_block_num(&in[l]);
+	}
+
+	if (lanes == MIC_BATCH_LANES) {
+		common = num[0];
+		for (l = 1; l < MIC_BATCH_LANES; l++)
+			if (num[l] < common)
+				common = num[l];
+	}
+
+	/* the CBC chains of the inputs are independent, so the rounds of
+	 * all lanes overlap in the AES unit
+	 */
+	for (blk = 0; blk < common; blk++) {
+		for (l = 0; l < MIC_BATCH_LANES; l++) {
+			x[l] = aes_hw_xor(x[l], cmac_hw_block(ctx, &in[l], blk,
+							      num[l], block));
+			x[l] = aes_hw_start(x[l], rk);
+		}
+		for (r = 1; r < AES_ROUNDS; r++)
+			for (l = 0; l < MIC_BATCH_LANES; l++)
+				x[l] = aes_hw_round(x[l], rk, r);
+		for (l = 0; l < MIC_BATCH_LANES; l++)
+			x[l] = aes_hw_end(x[l], rk);
+	}
+
+	for (l = 0; l < lanes; l++) {
+		y = x[l];
+		for (blk = common; blk < num[l]; blk++) {
+			y = aes_hw_xor(y, cmac_hw_block(ctx, &in[l], blk,
+							num[l], block));
+			y = aes_hw_encrypt(y, rk);
+		}
+		aes_hw_store(mac[l], y);
+	}
+}
+
+/** AES instruction support: -1 unknown, 0 no, 1 yes */
+static int aes_hw_state = -1;
+
+/** Check once if the AES instructions can be used
+ *
+ * \return true if \ref cmac_hw can be used
+ */
+static bool aes_hw_usable(void)
+{
+	int state;
+
+#if defined(__GNUC__)
+	state = __atomic_load_n(&aes_hw_state, __ATOMIC_RELAXED);
+	if (state < 0) {
+		state = aes_hw_detect() ? 1 : 0;
+		__atomic_store_n(&aes_hw_state, state, __ATOMIC_RELAXED);
+	}
+#else
+	/* concurrent first calls store the same value */
+	state = aes_hw_state;
+	if (state < 0) {
+		state = aes_hw_detect() ? 1 : 0;
+		aes_hw_state = state;
+	}
+#endif
+
+	return state == 1;
+}
+#endif
+
+/** Calculate the AES-CMACs of up to MIC_BATCH_LANES inputs */
+static void cmac_calc(const struct pa_omci_mic_ctx *ctx,
+		      const struct cmac_input *in, unsigned int lanes,
+		      uint8_t mac[][AES_BLOCK_LEN])
+{
+	unsigned int l;
+
+#if AES_HW == 1
+	if (aes_hw_usable()) {
+		cmac_hw(ctx, in, lanes, mac);
+		return;
+	}
+#endif
+	for (l = 0; l < lanes; l++)
+		cmac_soft(ctx, &in[l], mac[l]);
+}
+
+enum pon_adapter_errno pa_omci_mic_key_set(struct pa_omci_mic_ctx *ctx,
+					   const struct pa_omci_ik *ik)
+{
+	uint8_t l[AES_BLOCK_LEN] = { 0 };
+
+	if (!ctx || !ik)
+		return PON_ADAPTER_ERR_PTR_INVALID;
+
+	if (ctx->valid && !memcmp(ctx->ik.key, ik->key, sizeof(ik->key)))
+		return PON_ADAPTER_EUNCHANGED;
+
+	ctx->ik = *ik;
+	aes_key_expand(ik->key, ctx->round_key);
+	/* subkeys from the encrypted zero block (RFC 4493 2.3) */
+	aes_encrypt_soft(ctx->round_key, l, l);
+	cmac_subkey(l, ctx->k1);
+	cmac_subkey(ctx->k1, ctx->k2);
+	ctx->valid = true;
+
+	return PON_ADAPTER_SUCCESS;
+}
+
+enum pon_adapter_errno pa_omci_cmac(const struct pa_omci_mic_ctx *ctx,
+				    const uint8_t *data,
+				    size_t len,
+				    uint8_t mac[PA_OMCI_CMAC_LEN])
+{
+	uint8_t out[1][AES_BLOCK_LEN];
+	struct cmac_input in;
+
+	if (!ctx || (!data && len) || !mac)
+		return PON_ADAPTER_ERR_PTR_INVALID;
+	if (!ctx->valid)
+		return PON_ADAPTER_ERR_NOT_AVAIL;
+
+	in.data = data;
+	in.len = len;
+	in.dir = 0;
+	cmac_calc(ctx, &in, 1, out);
+	memcpy(mac, out[0], AES_BLOCK_LEN);
+
+	return PON_ADAPTER_SUCCESS;
+}
+
+enum pon_adapter_errno pa_omci_mic(const struct pa_omci_mic_ctx *ctx,
+				   enum pa_omci_mic_dir dir,
+				   const uint8_t *msg,
+				   size_t len,
+				   uint32_t *mic)
+{
+	return pa_omci_mic_batch(ctx, dir, &msg, &len, mic, 1);
+}
+
+enum pon_adapter_errno pa_omci_mic_check(const struct pa_omci_mic_ctx *ctx,
+					 enum pa_omci_mic_dir dir,
+					 const uint8_t *msg,
+					 size_t len,
+					 uint32_t mic)
+{
+	enum pon_adapter_errno ret;
+	uint32_t calc;
+
+	ret = pa_omci_mic(ctx, dir, msg, len, &calc);
+	if (ret != PON_ADAPTER_SUCCESS)
+		return ret;
+
+	return calc == mic ? PON_ADAPTER_SUCCESS : PON_ADAPTER_ERR_MIC;
+}
+
+enum pon_adapter_errno pa_omci_mic_batch(const struct pa_omci_mic_ctx *ctx,
+					 enum pa_omci_mic_dir dir,
+					 const uint8_t *msgs[],
+					 const size_t lens[],
+					 uint32_t mics[],
+					 size_t n)
+{
+	struct cmac_input in[MIC_BATCH_LANES];
+	uint8_t mac[MIC_BATCH_LANES][AES_BLOCK_LEN];
+	unsigned int l, lanes;
+	size_t i;
+
+	if (!ctx || (n && (!msgs || !lens || !mics)))
+		return PON_ADAPTER_ERR_PTR_INVALID;
+	if (!ctx->valid)
+		return PON_ADAPTER_ERR_NOT_AVAIL;
+	if (dir != PA_OMCI_MIC_DOWNSTREAM && dir != PA_OMCI_MIC_UPSTREAM)
+		return PON_ADAPTER_ERR_INVALID_VAL;
+	for (i = 0; i < n; i++)
+		if (!msgs[i] && lens[i])
+			return PON_ADAPTER_ERR_PTR_INVALID;
+
+	for (i = 0; i < n; i += lanes) {
+		lanes = n - i < MIC_BATCH_LANES ?
+			(unsigned int)(n - i) : MIC_BATCH_LANES;
+		for (l = 0; l < lanes; l++) {
+			in[l].data = msgs[i + l];
+			in[l].len = lens[i + l];
+			in[l].dir = (uint8_t)dir;
+		}
+		cmac_calc(ctx, in, lanes, mac);
+		for (l = 0; l < lanes; l++)
+			mics[i + l] = get_be32(mac[l]);
+	}
+
+	return PON_ADAPTER_SUCCESS;
+}
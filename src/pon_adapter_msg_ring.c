@@ -0,0 +1,307 @@
+/******************************************************************************
+ *
+ *  Copyright (c) 2024 MaxLinear, Inc.
+ *
+ * For licensing information, see the file 'LICENSE' in the root folder of
+ * this software module.
+ *
+ ******************************************************************************/
+
+/**
+ * \file pon_adapter_msg_ring.c
+ *
+ * Single producer, single consumer ring of OMCI messages.
+ *
+ * The producer and the consumer position are free running counters in
+ * separate cache lines, the slot index is the position modulo the number
+ * of slots. Each side keeps a copy of the position of the other side and
+ * reads the shared position only if the copy says the ring is full or
+ * empty, so the cache line of the other side is rarely transferred.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "pon_adapter_msg_ring.h"
+
+#if !defined(__GNUC__) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+/** Ring header identification, "OMRG" */
+#define MSG_RING_MAGIC 0x4f4d5247
+
+/** Cache line size assumed for the ring layout */
+#define MSG_RING_LINE 64
+
+/** Largest number of slots, keeps the position difference unambiguous */
+#define MSG_RING_SLOT_NUM_MAX 0x100000
+
+/** Ring header, followed by the slots */
+struct pa_msg_ring {
+	/* constant after initialization */
+
+	/** MSG_RING_MAGIC */
+	uint32_t magic;
+	/** Number of slots, a power of two */
+	uint32_t slot_num;
+	/** Offset to the start of the allocated memory plus one, 0 if the
+	 *  memory was provided by the caller
+	 */
+	uint32_t alloc_offset;
+	uint8_t reserved0[MSG_RING_LINE - 3 * sizeof(uint32_t)];
+
+	/* written by the producer */
+
+	/** Position of the next slot to fill */
+	uint32_t head;
+	/** Last read consumer position */
+	uint32_t tail_cache;
+	uint8_t reserved1[MSG_RING_LINE - 2 * sizeof(uint32_t)];
+
+	/* written by the consumer */
+
+	/** Position of the oldest slot not released */
+	uint32_t tail;
+	/** Last read producer position */
+	uint32_t head_cache;
+	uint8_t reserved2[MSG_RING_LINE - 2 * sizeof(uint32_t)];
+};
+
+/* the slots must keep the cache line alignment of the header */
+typedef char msg_ring_header_size_check
+	[sizeof(struct pa_msg_ring) % MSG_RING_LINE ? -1 : 1];
+typedef char msg_ring_slot_size_check
+	[sizeof(struct pa_msg_ring_slot) == PA_MSG_RING_SLOT_SIZE ? 1 : -1];
+
+/** Read a field written by the other side, later accesses of the slots
+ *  are not moved before the read (acquire)
+ *
+ * \param[in] p        Field
+ *
+ * \return Field value
+ */
+static inline uint32_t msg_ring_load(uint32_t *p)
+{
+#if defined(__GNUC__)
+	return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+	uint32_t val = *(volatile uint32_t *)p;
+
+	/* x86 does not reorder loads with later accesses, only the
+	 * compiler must not
+	 */
+	_ReadWriteBarrier();
+
+	return val;
+#elif defined(_MSC_VER)
+	/* an interlocked operation is a full barrier on every target */
+	return (uint32_t)_InterlockedOr((volatile long *)p, 0);
+#else
+#error "No atomic access for the OMCI message ring"
+#endif
+}
+
+/** Write a field read by the other side, earlier accesses of the slots
+ *  are not moved behind the write (release)
+ *
+ * \param[in] p        Field
+ * \param[in] val      New value
+ */
+static inline void msg_ring_store(uint32_t *p, uint32_t val)
+{
+#if defined(__GNUC__)
+	__atomic_store_n(p, val, __ATOMIC_RELEASE);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+	/* x86 does not reorder stores with earlier accesses */
+	_ReadWriteBarrier();
+	*(volatile uint32_t *)p = val;
+#elif defined(_MSC_VER)
+	(void)_InterlockedExchange((volatile long *)p, (long)val);
+#else
+#error "No atomic access for the OMCI message ring"
+#endif
+}
+
+static inline struct pa_msg_ring_slot *msg_ring_slot(struct pa_msg_ring *ring,
+						     uint32_t pos)
+{
+	return (struct pa_msg_ring_slot *)(ring + 1) +
+		(pos & (ring->slot_num - 1));
+}
+
+static bool msg_ring_slot_num_valid(uint32_t slot_num)
+{
+	return slot_num && slot_num <= MSG_RING_SLOT_NUM_MAX &&
+	       !(slot_num & (slot_num - 1));
+}
+
+static bool msg_ring_aligned(const void *mem)
+{
+	return !((size_t)mem % MSG_RING_LINE);
+}
+
+size_t pa_msg_ring_size(uint32_t slot_num)
+{
+	if (!msg_ring_slot_num_valid(slot_num))
+		return 0;
+
+	return sizeof(struct pa_msg_ring) +
+		(size_t)slot_num * sizeof(struct pa_msg_ring_slot);
+}
+
+enum pon_adapter_errno pa_msg_ring_init(void *mem, size_t size,
+					uint32_t slot_num,
+					struct pa_msg_ring **ring)
+{
+	struct pa_msg_ring *r = mem;
+
+	if (!mem || !ring || !msg_ring_aligned(mem))
+		return PON_ADAPTER_ERR_PTR_INVALID;
+	if (!msg_ring_slot_num_valid(slot_num))
+		return PON_ADAPTER_ERR_INVALID_VAL;
+	if (size < pa_msg_ring_size(slot_num))
+		return PON_ADAPTER_ERR_SIZE;
+
+	memset(r, 0, sizeof(*r));
+	r->slot_num = slot_num;
+	/* the magic marks the ring as usable for pa_msg_ring_attach() */
+	msg_ring_store(&r->magic, MSG_RING_MAGIC);
+
+	*ring = r;
+
+	return PON_ADAPTER_SUCCESS;
+}
+
+enum pon_adapter_errno pa_msg_ring_attach(void *mem, size_t size,
+					  struct pa_msg_ring **ring)
+{
+	struct pa_msg_ring *r = mem;
+
+	if (!mem || !ring || !msg_ring_aligned(mem))
+		return PON_ADAPTER_ERR_PTR_INVALID;
+	if (size < sizeof(*r) ||
+	    msg_ring_load(&r->magic) != MSG_RING_MAGIC ||
+	    !msg_ring_slot_num_valid(r->slot_num))
+		return PON_ADAPTER_ERR_NOT_FOUND;
+	if (size < pa_msg_ring_size(r->slot_num))
+		return PON_ADAPTER_ERR_SIZE;
+
+	*ring = r;
+
+	return PON_ADAPTER_SUCCESS;
+}
+
+enum pon_adapter_errno pa_msg_ring_create(uint32_t slot_num,
+					  struct pa_msg_ring **ring)
+{
+	enum pon_adapter_errno ret;
+	size_t size = pa_msg_ring_size(slot_num);
+	uint8_t *mem, *aligned;
+
+	if (!ring)
+		return PON_ADAPTER_ERR_PTR_INVALID;
+	if (!size)
+		return PON_ADAPTER_ERR_INVALID_VAL;
+
+	mem = malloc(size + MSG_RING_LINE - 1);
+	if (!mem)
+		return PON_ADAPTER_ERR_NO_MEMORY;
+
+	aligned = mem + (MSG_RING_LINE - (size_t)mem % MSG_RING_LINE) %
+		MSG_RING_LINE;
+	ret = pa_msg_ring_init(aligned, size, slot_num, ring);
+	if (ret != PON_ADAPTER_SUCCESS) {
+		free(mem);
+		return ret;
+	}
+	(*ring)->alloc_offset = (uint32_t)(aligned - mem) + 1;
+
+	return PON_ADAPTER_SUCCESS;
+}
+
+void pa_msg_ring_destroy(struct pa_msg_ring *ring)
+{
+	if (!ring || !ring->alloc_offset)
+		return;
+
+	ring->magic = 0;
+	free((uint8_t *)ring - (ring->alloc_offset - 1));
+}
+
+struct pa_msg_ring_slot *pa_msg_ring_slot_get(struct pa_msg_ring *ring)
+{
+	uint32_t head = ring->head;
+
+	if (head - ring->tail_cache == ring->slot_num) {
+		/* the slot is written after this, so acquire the release
+		 * of the consumer
+		 */
+		ring->tail_cache = msg_ring_load(&ring->tail);
+		if (head - ring->tail_cache == ring->slot_num)
+			return NULL;
+	}
+
+	return msg_ring_slot(ring, head);
+}
+
+void pa_msg_ring_slot_push(struct pa_msg_ring *ring)
+{
+	msg_ring_store(&ring->head, ring->head + 1);
+}
+
+enum pon_adapter_errno pa_msg_ring_put(struct pa_msg_ring *ring,
+				       const uint8_t *msg,
+				       uint16_t len,
+				       const uint32_t *crc)
+{
+	struct pa_msg_ring_slot *slot;
+
+	if (!ring || (!msg && len))
+		return PON_ADAPTER_ERR_PTR_INVALID;
+	if (len > PA_MSG_RING_MSG_MAX)
+		return PON_ADAPTER_ERR_SIZE;
+
+	slot = pa_msg_ring_slot_get(ring);
+	if (!slot)
+		return PON_ADAPTER_ERR_OMCI_MSG_FIFO_FULL;
+
+	if (len)
+		memcpy(slot->msg, msg, len);
+	slot->len = len;
+	slot->flags = crc ? PA_MSG_RING_SLOT_CRC : 0;
+	slot->crc = crc ? *crc : 0;
+	pa_msg_ring_slot_push(ring);
+
+	return PON_ADAPTER_SUCCESS;
+}
+
+uint32_t pa_msg_ring_poll(struct pa_msg_ring *ring,
+			  const struct pa_msg_ring_slot *slots[],
+			  uint32_t max)
+{
+	uint32_t tail = ring->tail, num, i;
+
+	num = ring->head_cache - tail;
+	if (num < max) {
+		ring->head_cache = msg_ring_load(&ring->head);
+		num = ring->head_cache - tail;
+	}
+	if (num > max)
+		num = max;
+
+	for (i = 0; i < num; i++)
+		slots[i] = msg_ring_slot(ring, tail + i);
+
+	return num;
+}
+
+void pa_msg_ring_release(struct pa_msg_ring *ring, uint32_t num)
+{
+	uint32_t tail = ring->tail;
+
+	if (num > ring->head_cache - tail)
+		num = ring->head_cache - tail;
+
+	/* the slots were read before, so release them to the producer */
+	msg_ring_store(&ring->tail, tail + num);
+}